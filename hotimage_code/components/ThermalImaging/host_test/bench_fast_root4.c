@@ -0,0 +1,61 @@
+#include "host_test.h"
+#include <math.h>
+
+// 四次方根的耗时 FastRoot4 / sqrtf(sqrtf()) / 双精度 sqrt(sqrt())
+// 主机有双精度 FPU, ESP32 的双精度 sqrt 是软件实现 这里的比例不代表 ESP32 上的比例
+#include "driver_MLX90640.c"
+
+#define BENCH_SIZE 4096
+
+static float inputs[BENCH_SIZE];
+
+static float root4Fast(float x)
+{
+    return FastRoot4(x);
+}
+
+static float root4Float(float x)
+{
+    return sqrtf(sqrtf(x));
+}
+
+static float root4Double(float x)
+{
+    return sqrt(sqrt(x));
+}
+
+static double benchRoot4(float (*func)(float), int rounds)
+{
+    float sum = 0;
+    uint64_t start = host_now_ns();
+
+    for (int n = 0; n < rounds; n++) {
+        for (int i = 0; i < BENCH_SIZE; i++) {
+            sum += func(inputs[i]);
+        }
+    }
+    host_keep(&sum);
+
+    return (double)(host_now_ns() - start) / rounds / BENCH_SIZE;
+}
+
+int main(int argc, char** argv)
+{
+    static paramsMLX90640 params;
+    int rounds = argc > 1 ? atoi(argv[1]) : 5000;
+
+    MLX90640_BuildCalibTable(&params);
+
+    // 温度计算中的实际输入 (To + 273.15)^4
+    for (int i = 0; i < BENCH_SIZE; i++) {
+        double kelvin = -40 + 340.0 * i / BENCH_SIZE + 273.15;
+        inputs[i] = kelvin * kelvin * kelvin * kelvin;
+    }
+
+    printf("%d x %d calls, ns per call\n", rounds, BENCH_SIZE);
+    printf("FastRoot4:          %6.2f\n", benchRoot4(root4Fast, rounds));
+    printf("sqrtf(sqrtf()):     %6.2f\n", benchRoot4(root4Float, rounds));
+    printf("sqrt(sqrt()) double %6.2f\n", benchRoot4(root4Double, rounds));
+
+    return 0;
+}
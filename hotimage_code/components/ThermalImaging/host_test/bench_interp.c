@@ -0,0 +1,121 @@
+#include "IDW.h"
+#include "host_test.h"
+#include "interp_fixture.h"
+#include <stdlib.h>
+
+// 各插值模式输出一幅 320x240 图像的耗时 按输出像素平均
+// 只比较同一台机器上的不同实现 ESP32 上浮点和整数运算的比例与主机不同
+
+#define DEST_WIDTH 320
+#define DEST_HEIGHT 240
+
+static int16_t src16[64 * 48];
+static float srcFloat[64 * 48];
+static int16_t dest[DEST_WIDTH * DEST_HEIGHT];
+static uint16_t frame[DEST_WIDTH * DEST_HEIGHT];
+static int16_t src32[32 * 24];
+static sIdwScaler scaler;
+static sIdwLinear linear;
+static sIdwBicubic bicubic;
+static sPaletteMap map;
+
+static void hqFloat(void)
+{
+    fixture_float_bilinear(srcFloat, 64, 48, dest, DEST_WIDTH, DEST_HEIGHT, 5);
+    host_keep(dest);
+}
+
+static void hqScaler(void)
+{
+    idwScaleRows(&scaler, src16, dest, 0, DEST_HEIGHT);
+    host_keep(dest);
+}
+
+static void hqScalerPalette(void)
+{
+    idwScalePaletteRows(&scaler, src16, frame, &map, 0, DEST_HEIGHT);
+    host_keep(frame);
+}
+
+static void linearLegacy(void)
+{
+    fixture_legacy_old_interpolate(src32, 32, 24, 10, dest);
+    host_keep(dest);
+}
+
+static void linearRows(void)
+{
+    idwLinearRows(&linear, src32, dest, 0, DEST_HEIGHT);
+    host_keep(dest);
+}
+
+static void linearPalette(void)
+{
+    idwLinearPaletteRows(&linear, src32, frame, &map, 0, DEST_HEIGHT);
+    host_keep(frame);
+}
+
+static void bicubicRows(void)
+{
+    idwBicubicRows(&bicubic, src32, dest, 0, DEST_HEIGHT);
+    host_keep(dest);
+}
+
+static void bicubicPalette(void)
+{
+    idwBicubicPaletteRows(&bicubic, src32, frame, &map, 0, DEST_HEIGHT);
+    host_keep(frame);
+}
+
+// 高质量模式 render_task 中的完整过程: 高斯模糊放大 2 倍 再缩放到屏幕
+static void hqGaussScalerPalette(void)
+{
+    idwGauss(src32, 32, 24, 2, src16);
+    idwScalePaletteRows(&scaler, src16, frame, &map, 0, DEST_HEIGHT);
+    host_keep(frame);
+}
+
+static double benchFrame(void (*func)(void), int iterations)
+{
+    uint64_t start;
+
+    func(); // 预热
+    start = host_now_ns();
+    for (int n = 0; n < iterations; n++) {
+        func();
+    }
+
+    return (double)(host_now_ns() - start) / iterations / (DEST_WIDTH * DEST_HEIGHT);
+}
+
+int main(int argc, char** argv)
+{
+    int iterations = argc > 1 ? atoi(argv[1]) : 200;
+
+    fixture_smooth_image(src16, 64, 48, 1);
+    fixture_smooth_image(src32, 32, 24, 1);
+    for (int i = 0; i < 64 * 48; i++) {
+        srcFloat[i] = src16[i];
+    }
+    if (idwScalerInit(&scaler, 64, 48, DEST_WIDTH, DEST_HEIGHT) || idwLinearInit(&linear, 32, 24, 10) || idwBicubicInit(&bicubic, 32, 24, 10) || palette_setMap(&map, Iron, 0, 1000)) {
+        return 1;
+    }
+
+    printf("%d frames per run, ns per output pixel\n", iterations);
+    printf("HQ 64x48 -> 320x240\n");
+    printf("  fixture_float_bilinear (float):   %8.2f\n", benchFrame(hqFloat, iterations));
+    printf("  idwScaleRows (Q8):                %8.2f\n", benchFrame(hqScaler, iterations));
+    printf("  idwScalePaletteRows (Q8 + LUT):   %8.2f\n", benchFrame(hqScalerPalette, iterations));
+    printf("  idwGauss x2 + idwScalePaletteRows: %7.2f\n", benchFrame(hqGaussScalerPalette, iterations));
+    printf("LINEAR 32x24 x10\n");
+    printf("  idwOldInterpolate (division):     %8.2f\n", benchFrame(linearLegacy, iterations));
+    printf("  idwLinearRows:                    %8.2f\n", benchFrame(linearRows, iterations));
+    printf("  idwLinearPaletteRows (+ LUT):     %8.2f\n", benchFrame(linearPalette, iterations));
+    printf("BICUBIC 32x24 x10\n");
+    printf("  idwBicubicRows (Q12):             %8.2f\n", benchFrame(bicubicRows, iterations));
+    printf("  idwBicubicPaletteRows (+ LUT):    %8.2f\n", benchFrame(bicubicPalette, iterations));
+
+    idwScalerFree(&scaler);
+
+    return 0;
+}
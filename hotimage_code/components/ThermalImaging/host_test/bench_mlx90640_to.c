@@ -0,0 +1,54 @@
+#include "host_test.h"
+#include "mlx90640_fixture.h"
+#include <stdlib.h>
+
+// 温度计算每个子页的耗时 原版 (遍历 768 个像素) / 按子页像素表 / 预计算校准表
+// 分别以两种温度计算内核编译 CalculateToFast 的差别只在四次方根
+// 只比较同一台机器上的不同实现 ESP32 没有双精度 FPU, 绝对耗时和比例都与主机不同
+
+typedef void (*tCalcFunc)(uint16_t* frameData, const paramsMLX90640* params, const MLX90640_FrameContext* ctx, float* result);
+
+static uint16_t frames[2][834];
+static MLX90640_FrameContext contexts[2];
+static sFixtureFrame conds[2];
+
+static void legacyCalc(uint16_t* frameData, const paramsMLX90640* params, const MLX90640_FrameContext* ctx, float* result)
+{
+    fixture_legacy_calculate_to(frameData, params, ctx->emissivity, ctx->tr, result);
+}
+
+static double benchCalc(tCalcFunc func, const paramsMLX90640* params, int iterations)
+{
+    float result[768];
+    uint64_t start = host_now_ns();
+
+    for (int n = 0; n < iterations; n++) {
+        func(frames[n & 1], params, &contexts[n & 1], result);
+        host_keep(result);
+    }
+
+    return (double)(host_now_ns() - start) / iterations;
+}
+
+int main(int argc, char** argv)
+{
+    static paramsMLX90640 params;
+    int iterations = argc > 1 ? atoi(argv[1]) : 20000;
+
+    fixture_params(&params);
+    for (int subPage = 0; subPage < 2; subPage++) {
+        sFixtureFrame cond = { FIXTURE_MODE_CHESS, subPage, 25.0f, 3.3f, 1.0f, 0.95f, 17.0f };
+
+        conds[subPage] = cond;
+        fixture_frame(&params, &cond, frames[subPage]);
+        fixture_context(&params, &cond, frames[subPage], &contexts[subPage]);
+    }
+
+    printf("%d subpages per run, ns per subpage\n", iterations);
+    printf("legacy CalculateTo (768 pixel scan): %10.0f\n", benchCalc(legacyCalc, &params, iterations));
+    printf("CalculateTo (subpage pixel list):    %10.0f\n", benchCalc(MLX90640_CalculateTo, &params, iterations));
+    printf("CalculateToFast (calib table):       %10.0f\n", benchCalc(MLX90640_CalculateToFast, &params, iterations));
+    printf("GetImage (subpage pixel list):       %10.0f\n", benchCalc(MLX90640_GetImage, &params, iterations));
+
+    return 0;
+}
@@ -0,0 +1,78 @@
+#include "host_idf.h"
+#include "MLX90640_I2C_Driver.h"
+#include "iic.h"
+#include <time.h>
+
+// 主机测试用的 ESP-IDF 替身实现 总线操作全部失败 测试只调用纯计算的函数
+
+int64_t esp_timer_get_time(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void esp_rom_delay_us(uint32_t us)
+{
+    struct timespec ts = { us / 1000000, (long)(us % 1000000) * 1000 };
+
+    nanosleep(&ts, NULL);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    esp_rom_delay_us(ticks * portTICK_PERIOD_MS * 1000);
+}
+
+BaseType_t xPortGetCoreID(void)
+{
+    return 0;
+}
+
+void* heap_caps_malloc(size_t size, uint32_t caps)
+{
+    (void)caps;
+    return malloc(size);
+}
+
+void* heap_caps_calloc(size_t n, size_t size, uint32_t caps)
+{
+    (void)caps;
+    return calloc(n, size);
+}
+
+void heap_caps_free(void* ptr)
+{
+    free(ptr);
+}
+
+void i2c_bus_open_idle_window(int64_t endUs)
+{
+    (void)endUs;
+}
+
+esp_err_t i2c_general_reset()
+{
+    return ESP_FAIL;
+}
+
+int MLX90640_I2CRead(uint8_t slaveAddr, uint16_t startAddress, uint16_t nMemAddressRead, uint16_t* data)
+{
+    return -1;
+}
+
+int MLX90640_I2CReadRaw(uint8_t slaveAddr, uint16_t startAddress, uint16_t nMemAddressRead, uint16_t* data)
+{
+    return -1;
+}
+
+int MLX90640_I2CWrite(uint8_t slaveAddr, uint16_t writeAddress, uint16_t data)
+{
+    return -1;
+}
+
+int MLX90640_I2CWritePolicy(uint8_t slaveAddr, uint16_t writeAddress, uint16_t data, eMLX90640WritePolicy policy)
+{
+    return -1;
+}
@@ -0,0 +1,54 @@
+#ifndef _HOST_TEST_H_
+#define _HOST_TEST_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+// 主机测试的断言和计时 失败时打印位置并计数 main 返回失败次数
+
+static int hostTestFailures = 0;
+
+#define CHECK(cond)                                                              \
+    do {                                                                         \
+        if (!(cond)) {                                                           \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            hostTestFailures++;                                                  \
+        }                                                                        \
+    } while (0)
+
+#define CHECK_MSG(cond, fmt, ...)                                                    \
+    do {                                                                             \
+        if (!(cond)) {                                                               \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed: " fmt "\n", __FILE__, __LINE__, \
+                #cond, ##__VA_ARGS__);                                               \
+            hostTestFailures++;                                                      \
+        }                                                                            \
+    } while (0)
+
+static inline int host_test_result(const char* name)
+{
+    if (hostTestFailures) {
+        printf("%s: %d check(s) failed\n", name, hostTestFailures);
+        return 1;
+    }
+    printf("%s: ok\n", name);
+    return 0;
+}
+
+// 单调时钟 纳秒
+static inline uint64_t host_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+// 防止基准测试的结果被优化掉
+static inline void host_keep(const void* p)
+{
+    __asm__ volatile("" : : "g"(p) : "memory");
+}
+
+#endif /* _HOST_TEST_H_ */
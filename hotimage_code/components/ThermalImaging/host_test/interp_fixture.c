@@ -0,0 +1,153 @@
+#include "interp_fixture.h"
+#include <math.h>
+
+uint32_t fixture_rand(uint32_t* pSeed)
+{
+    // xorshift32 种子不能为 0
+    uint32_t x = *pSeed ? *pSeed : 0x9E3779B9u;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *pSeed = x;
+
+    return x;
+}
+
+void fixture_smooth_image(int16_t* pImage, uint16_t width, uint16_t height, uint32_t seed)
+{
+    const float background = 200.0f + (fixture_rand(&seed) % 200);
+    const float hotX = (fixture_rand(&seed) % 100) / 100.0f * width;
+    const float hotY = (fixture_rand(&seed) % 100) / 100.0f * height;
+    const float coldX = (fixture_rand(&seed) % 100) / 100.0f * width;
+    const float coldY = (fixture_rand(&seed) % 100) / 100.0f * height;
+    const float phase = (fixture_rand(&seed) % 628) / 100.0f;
+
+    // 按源像素计算 热点 sigma 3 个像素 缩小图像不会变得更陡
+    for (uint16_t y = 0; y < height; y++) {
+        for (uint16_t x = 0; x < width; x++) {
+            float dh = ((x - hotX) * (x - hotX) + (y - hotY) * (y - hotY)) / (2 * 3.0f * 3.0f);
+            float dc = ((x - coldX) * (x - coldX) + (y - coldY) * (y - coldY)) / (2 * 4.0f * 4.0f);
+            float v = background + 8.0f * x - 5.0f * y
+                + 200.0f * sinf(x * 0.3f + phase) * cosf(y * 0.25f)
+                + 400.0f * expf(-dh) - 300.0f * expf(-dc);
+
+            pImage[y * width + x] = (int16_t)lroundf(v);
+        }
+    }
+}
+
+void fixture_random_image(int16_t* pImage, uint16_t width, uint16_t height, uint32_t seed, int16_t minValue, int16_t maxValue)
+{
+    const uint32_t span = (uint32_t)(maxValue - minValue) + 1;
+
+    for (uint32_t i = 0; i < (uint32_t)width * height; i++) {
+        pImage[i] = (int16_t)(minValue + (int32_t)(fixture_rand(&seed) % span));
+    }
+}
+
+void fixture_legacy_old_interpolate(const int16_t* pSrcImage, uint16_t srcWidth, uint16_t srcHeight, uint16_t scale, int16_t* pHDImageOut)
+{
+    const uint16_t scaleWidth = srcWidth * scale;
+
+    // 计算分布到每行的次数
+    const uint16_t distributedX = scaleWidth - ((srcWidth - 1) * scale) - 1;
+    const uint16_t distributedY = (srcHeight * scale) - ((srcHeight - 1) * scale) - 1;
+
+    // 先插值每行的数据
+    int32_t offsetY = 0;
+    uint16_t _newSrcWidth = srcWidth - 1;
+    for (uint16_t _h = 0; _h < srcHeight; _h++) {
+        uint16_t baseS = _h * srcWidth;
+
+        uint32_t offsetX = 0;
+        if (_h == (srcHeight - 1)) {
+            offsetX = (srcHeight * scale) * scaleWidth - scaleWidth;
+        } else {
+            offsetX = (_h * scale * scaleWidth) + offsetY;
+        }
+
+        for (uint16_t _w = 0; _w < _newSrcWidth; _w++) {
+            int16_t tempStart = pSrcImage[baseS + _w];
+            int16_t tempEnd = pSrcImage[baseS + _w + 1];
+
+            int16_t _newScale = scale;
+            if (_w <= distributedX) {
+                _newScale++;
+            }
+
+            for (uint16_t _s = 0; _s < _newScale; _s++) {
+                pHDImageOut[offsetX + _s] = (tempStart * (_newScale - _s) + tempEnd * _s) / _newScale;
+            }
+            offsetX += _newScale;
+        }
+
+        if (_h < distributedY) {
+            offsetY += scaleWidth;
+        }
+    }
+
+    // 插值2行之间的数据 按列处理
+    uint16_t _newScale;
+    uint16_t _newSrcHeight = srcHeight - 1;
+    int32_t _s = 0, _n = 0;
+
+    for (uint16_t _w = 0; _w < scaleWidth; _w++) {
+        _s = _n = _w;
+
+        for (uint16_t _h = 0; _h < _newSrcHeight; _h++) {
+            _s = _n;
+
+            if (_h < distributedY) {
+                _n += scaleWidth * scale + scaleWidth;
+                _newScale = scale + 1;
+            } else {
+                _n += scaleWidth * scale;
+                _newScale = scale;
+            }
+
+            int16_t tempStart = pHDImageOut[_s];
+            int16_t tempEnd = pHDImageOut[_n];
+
+            for (uint16_t _scale = 1; _scale < _newScale; _scale++) {
+                uint32_t Idx = _s + _scale * scaleWidth;
+                pHDImageOut[Idx] = tempStart * (_newScale - _scale) / _newScale + tempEnd * _scale / _newScale;
+            }
+        }
+    }
+}
+
+// 获取指定像素的值 超出右边 下边时取边缘像素
+static float float_bilinear_get_point(const float* p, uint8_t width, uint8_t height, int8_t x, int8_t y)
+{
+    if (x >= width) {
+        x = width - 1;
+    }
+
+    if (y >= height) {
+        y = height - 1;
+    }
+    return p[y * width + x];
+}
+
+void fixture_float_bilinear(const float* pSrc, uint8_t srcWidth, uint8_t srcHeight, int16_t* pDest, uint16_t destWidth, uint16_t destHeight, uint8_t upScaleFactor)
+{
+    const float mu = 1.f / upScaleFactor;
+
+    for (uint16_t yIdx = 0; yIdx < destHeight; yIdx++) {
+        for (uint16_t xIdx = 0; xIdx < destWidth; xIdx++) {
+            float x = xIdx * mu;
+            float y = yIdx * mu;
+            float fracX = x - (int)x;
+            float fracY = y - (int)y;
+            float p0 = float_bilinear_get_point(pSrc, srcWidth, srcHeight, (int8_t)x + 0, (int8_t)y + 0);
+            float p1 = float_bilinear_get_point(pSrc, srcWidth, srcHeight, (int8_t)x + 1, (int8_t)y + 0);
+            float p2 = float_bilinear_get_point(pSrc, srcWidth, srcHeight, (int8_t)x + 0, (int8_t)y + 1);
+            float p3 = float_bilinear_get_point(pSrc, srcWidth, srcHeight, (int8_t)x + 1, (int8_t)y + 1);
+            float xx = p1 * fracX + p0 * (1.f - fracX);
+            float xy = p3 * fracX + p2 * (1.f - fracX);
+
+            pDest[yIdx * destWidth + xIdx] = (int16_t)(xy * fracY + xx * (1.f - fracY));
+        }
+    }
+}
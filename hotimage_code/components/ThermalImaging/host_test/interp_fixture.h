@@ -0,0 +1,23 @@
+#ifndef _INTERP_FIXTURE_H_
+#define _INTERP_FIXTURE_H_
+
+#include <stdint.h>
+
+// 插值测试用的合成图像 温度值放大 10 倍 (和 render_task 的 TEMP_SCALE 相同)
+
+// 确定的伪随机数 同一个种子每次得到相同的序列
+uint32_t fixture_rand(uint32_t* pSeed);
+
+// 平滑的热图像 背景 + 渐变 + 两个热点 相邻像素相差不超过约 200
+void fixture_smooth_image(int16_t* pImage, uint16_t width, uint16_t height, uint32_t seed);
+
+// 每个像素独立的随机值 minValue ~ maxValue
+void fixture_random_image(int16_t* pImage, uint16_t width, uint16_t height, uint32_t seed, int16_t minValue, int16_t maxValue);
+
+// 原来逐像素做除法的 idwOldInterpolate 作为比较基准 不写入的像素保持原值
+void fixture_legacy_old_interpolate(const int16_t* pSrcImage, uint16_t srcWidth, uint16_t srcHeight, uint16_t scale, int16_t* pHDImageOut);
+
+// 原来浮点计算的 idwBilinear (高质量模式的双线性插值) 作为比较基准 坐标 = 输出坐标 / upScaleFactor
+void fixture_float_bilinear(const float* pSrc, uint8_t srcWidth, uint8_t srcHeight, int16_t* pDest, uint16_t destWidth, uint16_t destHeight, uint8_t upScaleFactor);
+
+#endif /* _INTERP_FIXTURE_H_ */
@@ -0,0 +1,327 @@
+/**
+ * @copyright (C) 2017 Melexis N.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include "mlx90640_fixture.h"
+#include <math.h>
+#include <string.h>
+
+#define FIXTURE_PTAT 1711 // 固定的 PTAT 读数 外壳温度由 ptatArt 调节
+
+/**
+ * @brief 生成校准参数
+ *
+ * @param params
+ */
+void fixture_params(paramsMLX90640* params)
+{
+    memset(params, 0, sizeof(*params));
+
+    params->kVdd = -3200;
+    params->vdd25 = -12544;
+    params->KvPTAT = 0.002197f;
+    params->KtPTAT = 42.25f;
+    params->vPTAT25 = 12273;
+    params->alphaPTAT = 9;
+    params->gainEE = 5580;
+    params->tgc = 0.25f;
+    params->cpKv = 0.375f;
+    params->cpKta = 0.004577f;
+    params->resolutionEE = 2;
+    params->calibrationModeEE = 0x80;
+    params->KsTa = -0.002f;
+    params->ksTo[0] = -0.00084f;
+    params->ksTo[1] = -0.00078f;
+    params->ksTo[2] = -0.00081f;
+    params->ksTo[3] = -0.00072f;
+    params->ksTo[4] = -0.0002f;
+    params->ct[0] = -40;
+    params->ct[1] = 0;
+    params->ct[2] = 160;
+    params->ct[3] = 320;
+    params->ct[4] = 400;
+    params->alphaScale = 12;
+    params->ktaScale = 14;
+    params->kvScale = 3;
+    params->cpAlpha[0] = 4.07e-9f;
+    params->cpAlpha[1] = 4.12e-9f;
+    params->cpOffset[0] = -69;
+    params->cpOffset[1] = -65;
+    params->ilChessC[0] = 0.5625f;
+    params->ilChessC[1] = 2.5f;
+    params->ilChessC[2] = -0.75f;
+
+    // alpha 约 1.2e-7 offset kta kv 按行列有梯度 再加上每个像素的偏差
+    for (int i = 0; i < 768; i++) {
+        int row = i / 32;
+        int col = i % 32;
+        int noise = (i * 37 + 11) % 17 - 8;
+
+        params->alpha[i] = 34133 + (row - 12) * 180 + (col - 16) * 90 + noise * 40;
+        params->offset[i] = -60 + row - col / 2 + noise;
+        params->kta[i] = 87 + noise * 3;
+        params->kv[i] = 3 + (i & 3);
+    }
+
+    MLX90640_BuildCalibTable(params);
+}
+
+/**
+ * @brief 像素的目标温度
+ *
+ * @param pixelNumber
+ * @return float
+ */
+float fixture_target(int pixelNumber)
+{
+    return -40 + 340.0f * ((pixelNumber * 97) % 768) / 767;
+}
+
+/**
+ * @brief 写入辅助数据 (电压 外壳温度 增益 补偿像素 控制寄存器 子页)
+ *
+ * @param params
+ * @param cond
+ * @param frameData
+ */
+static void fixtureAux(const paramsMLX90640* params, const sFixtureFrame* cond, uint16_t* frameData)
+{
+    double ptatArt;
+
+    frameData[832] = 0x0800 | (cond->mode ? 0x1000 : 0); // 分辨率 2 与 resolutionEE 相同
+    frameData[833] = cond->subPage;
+
+    frameData[810] = (uint16_t)(int16_t)lround(params->vdd25 + params->kVdd * (cond->vdd - 3.3));
+
+    // 反算 CalcTa: ptatArt = ptat / (ptat * alphaPTAT + ptatArtRaw) * 2^18
+    ptatArt = ((cond->ta - 25) * params->KtPTAT + params->vPTAT25) * (1 + params->KvPTAT * (cond->vdd - 3.3));
+    frameData[800] = FIXTURE_PTAT;
+    frameData[768] = (uint16_t)(int16_t)lround(FIXTURE_PTAT * 262144.0 / ptatArt - FIXTURE_PTAT * params->alphaPTAT);
+
+    frameData[778] = (uint16_t)(int16_t)lround(params->gainEE / cond->gain);
+    frameData[776] = (uint16_t)(int16_t)-60;
+    frameData[808] = (uint16_t)(int16_t)-58;
+}
+
+/**
+ * @brief 计算帧参数
+ *
+ * @param params
+ * @param cond
+ * @param frameData
+ * @param ctx
+ */
+void fixture_context(const paramsMLX90640* params, const sFixtureFrame* cond, uint16_t* frameData, MLX90640_FrameContext* ctx)
+{
+    memset(ctx, 0, sizeof(*ctx));
+    MLX90640_UpdateFrameContext(frameData, params, ctx);
+    MLX90640_UpdateFrameTaTr(ctx, cond->emissivity, cond->tr);
+}
+
+/**
+ * @brief 按目标温度反算一帧原始数据 两个子页的像素都填写
+ *
+ * @param params
+ * @param cond
+ * @param frameData 834 个字
+ */
+void fixture_frame(const paramsMLX90640* params, const sFixtureFrame* cond, uint16_t* frameData)
+{
+    MLX90640_FrameContext ctx;
+    double alphaCorrR[4];
+    double alphaScale;
+
+    memset(frameData, 0, 834 * sizeof(uint16_t));
+    fixtureAux(params, cond, frameData);
+    fixture_context(params, cond, frameData, &ctx);
+
+    alphaScale = pow(2, params->alphaScale);
+    alphaCorrR[0] = 1 / (1 + params->ksTo[0] * 40);
+    alphaCorrR[1] = 1;
+    alphaCorrR[2] = (1 + params->ksTo[1] * params->ct[2]);
+    alphaCorrR[3] = alphaCorrR[2] * (1 + params->ksTo[2] * (params->ct[3] - params->ct[2]));
+
+    for (int i = 0; i < 768; i++) {
+        int ilPattern = i / 32 - (i / 64) * 2;
+        int conversionPattern = ((i + 2) / 4 - (i + 3) / 4 + (i + 1) / 4 - i / 4) * (1 - 2 * ilPattern);
+        double to = fixture_target(i);
+        double kelvin = to + 273.15;
+        double alphaCompensated;
+        double irData;
+        int range;
+        long raw;
+
+        range = to < params->ct[1] ? 0 : to < params->ct[2] ? 1 : to < params->ct[3] ? 2 : 3;
+
+        // 按 MLX90640_CalculateTo 的第二次计算倒推
+        alphaCompensated = SCALEALPHA * alphaScale / params->alpha[i] * (1 + params->KsTa * (ctx.ta - 25));
+        irData = alphaCompensated * alphaCorrR[range] * (1 + params->ksTo[range] * (to - params->ct[range]));
+        irData = irData * (kelvin * kelvin * kelvin * kelvin - ctx.taTr);
+
+        irData = irData * cond->emissivity;
+        irData = irData + params->tgc * ctx.irDataCP[cond->subPage];
+        if (ctx.mode != params->calibrationModeEE) {
+            irData = irData - (params->ilChessC[2] * (2 * ilPattern - 1) - params->ilChessC[1] * conversionPattern);
+        }
+        irData = irData + params->offset[i] * (1 + params->kta[i] / pow(2, params->ktaScale) * (ctx.ta - 25)) * (1 + params->kv[i] / pow(2, params->kvScale) * (ctx.vdd - 3.3));
+
+        raw = lround(irData / ctx.gain);
+        if (raw > 32767) {
+            raw = 32767;
+        } else if (raw < -32768) {
+            raw = -32768;
+        }
+
+        frameData[i] = (uint16_t)(int16_t)raw;
+        frameData[i] = MLX90640_PIXEL(frameData, i); // 传感器字节序
+    }
+}
+
+/**
+ * @brief 原版 MLX90640_CalculateTo 只改为按传感器字节序读取像素
+ *
+ * @param frameData
+ * @param params
+ * @param emissivity
+ * @param tr
+ * @param result
+ */
+void fixture_legacy_calculate_to(uint16_t* frameData, const paramsMLX90640* params, float emissivity, float tr, float* result)
+{
+    float vdd;
+    float ta;
+    float ta4;
+    float tr4;
+    float taTr;
+    float gain;
+    float irDataCP[2];
+    float irData;
+    float alphaCompensated;
+    uint8_t mode;
+    int8_t ilPattern;
+    int8_t chessPattern;
+    int8_t pattern;
+    int8_t conversionPattern;
+    float Sx;
+    float To;
+    float alphaCorrR[4];
+    int8_t range;
+    uint16_t subPage;
+    float ktaScale;
+    float kvScale;
+    float alphaScale;
+    float kta;
+    float kv;
+
+    subPage = frameData[833]; // 得到当前的子页
+    vdd = MLX90640_GetVdd(frameData, params);
+    ta = MLX90640_GetTa(frameData, params);
+
+    ta4 = (ta + 273.15);
+    ta4 = ta4 * ta4;
+    ta4 = ta4 * ta4;
+    tr4 = (tr + 273.15);
+    tr4 = tr4 * tr4;
+    tr4 = tr4 * tr4;
+    taTr = tr4 - (tr4 - ta4) / emissivity;
+
+    ktaScale = pow(2, (double)params->ktaScale);
+    kvScale = pow(2, (double)params->kvScale);
+    alphaScale = pow(2, (double)params->alphaScale);
+
+    alphaCorrR[0] = 1 / (1 + params->ksTo[0] * 40);
+    alphaCorrR[1] = 1;
+    alphaCorrR[2] = (1 + params->ksTo[1] * params->ct[2]);
+    alphaCorrR[3] = alphaCorrR[2] * (1 + params->ksTo[2] * (params->ct[3] - params->ct[2]));
+
+    //------------------------- Gain calculation -----------------------------------
+    gain = frameData[778];
+    if (gain > 32767) {
+        gain = gain - 65536;
+    }
+
+    gain = params->gainEE / gain;
+
+    //------------------------- To calculation -------------------------------------
+    mode = (frameData[832] & 0x1000) >> 5;
+
+    irDataCP[0] = frameData[776];
+    irDataCP[1] = frameData[808];
+    for (int i = 0; i < 2; i++) {
+        if (irDataCP[i] > 32767) {
+            irDataCP[i] = irDataCP[i] - 65536;
+        }
+        irDataCP[i] = irDataCP[i] * gain;
+    }
+    irDataCP[0] = irDataCP[0] - params->cpOffset[0] * (1 + params->cpKta * (ta - 25)) * (1 + params->cpKv * (vdd - 3.3));
+    if (mode == params->calibrationModeEE) {
+        irDataCP[1] = irDataCP[1] - params->cpOffset[1] * (1 + params->cpKta * (ta - 25)) * (1 + params->cpKv * (vdd - 3.3));
+    } else {
+        irDataCP[1] = irDataCP[1] - (params->cpOffset[1] + params->ilChessC[0]) * (1 + params->cpKta * (ta - 25)) * (1 + params->cpKv * (vdd - 3.3));
+    }
+
+    for (int pixelNumber = 0; pixelNumber < 768; pixelNumber++) {
+        ilPattern = pixelNumber / 32 - (pixelNumber / 64) * 2;
+        chessPattern = ilPattern ^ (pixelNumber - (pixelNumber / 2) * 2);
+        conversionPattern = ((pixelNumber + 2) / 4 - (pixelNumber + 3) / 4 + (pixelNumber + 1) / 4 - pixelNumber / 4) * (1 - 2 * ilPattern);
+
+        if (mode == 0) {
+            pattern = ilPattern;
+        } else {
+            pattern = chessPattern;
+        }
+
+        if (pattern == frameData[833]) {
+            irData = MLX90640_PIXEL(frameData, pixelNumber);
+            if (irData > 32767) {
+                irData = irData - 65536;
+            }
+            irData = irData * gain;
+
+            kta = params->kta[pixelNumber] / ktaScale;
+            kv = params->kv[pixelNumber] / kvScale;
+            irData = irData - params->offset[pixelNumber] * (1 + kta * (ta - 25)) * (1 + kv * (vdd - 3.3));
+
+            if (mode != params->calibrationModeEE) {
+                irData = irData + params->ilChessC[2] * (2 * ilPattern - 1) - params->ilChessC[1] * conversionPattern;
+            }
+
+            irData = irData - params->tgc * irDataCP[subPage];
+            irData = irData / emissivity;
+
+            alphaCompensated = SCALEALPHA * alphaScale / params->alpha[pixelNumber];
+            alphaCompensated = alphaCompensated * (1 + params->KsTa * (ta - 25));
+
+            Sx = alphaCompensated * alphaCompensated * alphaCompensated * (irData + alphaCompensated * taTr);
+            Sx = sqrt(sqrt(Sx)) * params->ksTo[1];
+
+            To = sqrt(sqrt(irData / (alphaCompensated * (1 - params->ksTo[1] * 273.15) + Sx) + taTr)) - 273.15;
+
+            if (To < params->ct[1]) {
+                range = 0;
+            } else if (To < params->ct[2]) {
+                range = 1;
+            } else if (To < params->ct[3]) {
+                range = 2;
+            } else {
+                range = 3;
+            }
+
+            To = sqrt(sqrt(irData / (alphaCompensated * alphaCorrR[range] * (1 + params->ksTo[range] * (To - params->ct[range]))) + taTr)) - 273.15;
+
+            result[pixelNumber] = To;
+        }
+    }
+}
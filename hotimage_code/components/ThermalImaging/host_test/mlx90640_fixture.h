@@ -0,0 +1,39 @@
+#ifndef _MLX90640_FIXTURE_H_
+#define _MLX90640_FIXTURE_H_
+
+#include "driver_MLX90640.h"
+
+// 合成的传感器数据 没有实际设备时用于比较温度计算的各个实现
+// 参数取数据手册中的典型值 每个像素加上确定的偏差
+
+#define FIXTURE_MODE_INTERLEAVED 0
+#define FIXTURE_MODE_CHESS 0x80
+
+// 一帧的工作条件
+typedef struct
+{
+    uint8_t mode; // FIXTURE_MODE_INTERLEAVED / FIXTURE_MODE_CHESS
+    uint8_t subPage;
+    float ta; // 外壳温度
+    float vdd; // 供电电压
+    float gain; // 增益寄存器相对 gainEE 的比例
+    float emissivity;
+    float tr; // 反射温度
+} sFixtureFrame;
+
+// 生成校准参数 并调用 MLX90640_BuildCalibTable
+void fixture_params(paramsMLX90640* params);
+
+// 像素的目标温度 -40~300℃ 打乱分布在 768 个像素上
+float fixture_target(int pixelNumber);
+
+// 按目标温度反算原始数据 生成一帧 (像素为传感器的大端字节序)
+void fixture_frame(const paramsMLX90640* params, const sFixtureFrame* cond, uint16_t* frameData);
+
+// 计算帧参数 emissivity/tr 取 cond 中的值
+void fixture_context(const paramsMLX90640* params, const sFixtureFrame* cond, uint16_t* frameData, MLX90640_FrameContext* ctx);
+
+// 原版 Melexis 算法 (遍历全部 768 个像素 每个像素计算图案和缩放) 作为比较基准
+void fixture_legacy_calculate_to(uint16_t* frameData, const paramsMLX90640* params, float emissivity, float tr, float* result);
+
+#endif /* _MLX90640_FIXTURE_H_ */
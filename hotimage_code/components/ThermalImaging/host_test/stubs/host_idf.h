@@ -0,0 +1,66 @@
+#ifndef _HOST_IDF_H_
+#define _HOST_IDF_H_
+
+// 主机测试用的 ESP-IDF 替身 只声明被测模块用到的部分
+// 实现在 host_idf.c
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sdkconfig.h"
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_NO_MEM 0x101
+#define ESP_ERR_INVALID_ARG 0x102
+#define ESP_ERR_TIMEOUT 0x107
+
+#define ESP_LOGE(tag, fmt, ...) fprintf(stderr, "E %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) fprintf(stderr, "W %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) printf("I %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGD(tag, fmt, ...) ((void)(tag))
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+
+// FreeRTOS
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef void* TaskHandle_t;
+
+#define portTICK_PERIOD_MS 10
+#define portMAX_DELAY 0xffffffffu
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms) / portTICK_PERIOD_MS)
+
+void vTaskDelay(TickType_t ticks);
+BaseType_t xPortGetCoreID(void);
+
+// esp_timer / rom
+int64_t esp_timer_get_time(void);
+void esp_rom_delay_us(uint32_t us);
+
+// heap_caps
+#define MALLOC_CAP_8BIT (1 << 2)
+#define MALLOC_CAP_DMA (1 << 3)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+
+void* heap_caps_malloc(size_t size, uint32_t caps);
+void* heap_caps_calloc(size_t n, size_t size, uint32_t caps);
+void heap_caps_free(void* ptr);
+
+// i2c 只需要类型 总线操作由 host_idf.c 中的假驱动返回失败
+typedef int i2c_port_t;
+typedef int i2c_mode_t;
+typedef int i2c_ack_type_t;
+#define I2C_MASTER_WRITE 0
+#define I2C_MASTER_READ 1
+
+#endif /* _HOST_IDF_H_ */
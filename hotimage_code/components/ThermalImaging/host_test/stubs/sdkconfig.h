@@ -0,0 +1,16 @@
+#pragma once
+
+// 主机测试的配置 对应 Kconfig 的默认值
+// 温度计算内核 (CONFIG_MLX90640_TO_KERNEL_FLOAT/DOUBLE) 由 CMakeLists.txt 按测试分别定义
+
+#define CONFIG_ESP32_IIC_NUM 0
+#define CONFIG_ESP32_IIC_MLX90640 1
+
+#define CONFIG_THERMAL_PROFILER 1
+#define CONFIG_THERMAL_PROFILER_OVERLAY 1
+#define CONFIG_THERMAL_PROFILER_DUMP_PERIOD 10
+
+#define CONFIG_THERMAL_AUTORANGE_ATTACK 50
+#define CONFIG_THERMAL_AUTORANGE_RELEASE 10
+#define CONFIG_THERMAL_AUTORANGE_DEADBAND 5
+#define CONFIG_THERMAL_AUTORANGE_PERCENTILE 0
@@ -0,0 +1,172 @@
+#include "autorange.h"
+#include "host_test.h"
+#include "interp_fixture.h"
+#include <math.h>
+#include <stdlib.h>
+
+// 自动缩放 死区内的噪声不重新缩放 向外扩展快 向内收缩慢 分位数去掉两端的异常点
+
+static uint32_t updates = 0;
+static uint32_t changes = 0;
+
+// 更新并统计返回 1 的次数 和控制器自己的计数比较
+static uint8_t update(sAutoRange* pRange, float minT, float maxT)
+{
+    uint8_t changed = autorange_update(pRange, minT, maxT);
+
+    updates++;
+    changes += changed;
+    CHECK(pRange->frames == updates);
+    CHECK(pRange->rescales == changes);
+    return changed;
+}
+
+static float noise(uint32_t* pSeed, float amplitude)
+{
+    return ((int32_t)(fixture_rand(pSeed) % 2001) - 1000) / 1000.0f * amplitude;
+}
+
+static int compare_float(const void* a, const void* b)
+{
+    float fa = *(const float*)a, fb = *(const float*)b;
+
+    return (fa > fb) - (fa < fb);
+}
+
+// 排序后取第 k 小和第 k 大 k = 像素数 * n%
+static void ref_percentile(const float* pImage, uint16_t stride, uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint8_t percentile, float* pMin, float* pMax)
+{
+    static float sorted[32 * 24];
+    uint32_t count = 0;
+
+    for (uint16_t row = 0; row < height; row++) {
+        for (uint16_t col = 0; col < width; col++) {
+            sorted[count++] = pImage[(y + row) * stride + x + col];
+        }
+    }
+    qsort(sorted, count, sizeof(float), compare_float);
+
+    uint32_t k = count * percentile / 100;
+    *pMin = sorted[k];
+    *pMax = sorted[count - 1 - k];
+}
+
+int main(void)
+{
+    const sAutoRangeConfig config = { 0.5f, 0.1f, 0.5f, 0 };
+    sAutoRange range;
+    uint32_t seed = 12345;
+
+    // 参数限制
+    {
+        const sAutoRangeConfig bad = { 0, 1.5f, -1, 50 };
+
+        autorange_init(&range, &bad);
+        CHECK(range.cfg.attack == 1);
+        CHECK(range.cfg.release == 1);
+        CHECK(range.cfg.deadband == 0);
+        CHECK(range.cfg.percentile == 10);
+        CHECK(range.frames == 0 && range.rescales == 0);
+    }
+
+    // 第一帧直接使用输入的范围
+    autorange_init(&range, &config);
+    CHECK(1 == update(&range, 20, 35));
+    CHECK(range.outMin == 20 && range.outMax == 35);
+
+    // 噪声小于死区 不重新缩放
+    for (int n = 0; n < 1000; n++) {
+        CHECK(0 == update(&range, 20 + noise(&seed, 0.3f), 35 + noise(&seed, 0.3f)));
+    }
+    CHECK(range.rescales == 1);
+    CHECK(range.outMin == 20 && range.outMax == 35);
+
+    // 没有死区时同样的噪声几乎每帧都重新缩放
+    {
+        const sAutoRangeConfig noDeadband = { 0.5f, 0.1f, 0, 0 };
+        sAutoRange raw;
+
+        autorange_init(&raw, &noDeadband);
+        for (int n = 0; n < 1000; n++) {
+            autorange_update(&raw, 20 + noise(&seed, 0.3f), 35 + noise(&seed, 0.3f));
+        }
+        CHECK_MSG(raw.rescales > 900, "rescales %u", raw.rescales);
+    }
+
+    // 向外扩展 每帧跟上目标的 attack
+    float expected = range.smoothMax;
+    for (int n = 0; n < 8; n++) {
+        update(&range, 20, 60);
+        expected += (60 - expected) * config.attack;
+        CHECK_MSG(fabsf(range.smoothMax - expected) < 1e-3f, "attack frame %d: %f expected %f", n, range.smoothMax, expected);
+        CHECK(fabsf(range.outMax - range.smoothMax) <= config.deadband);
+    }
+    CHECK(range.outMax > 59.5f);
+
+    // 向内收缩 每帧只跟上 release 8 帧后还远离目标
+    expected = range.smoothMax;
+    for (int n = 0; n < 8; n++) {
+        update(&range, 20, 35);
+        expected += (35 - expected) * config.release;
+        CHECK_MSG(fabsf(range.smoothMax - expected) < 1e-3f, "release frame %d: %f expected %f", n, range.smoothMax, expected);
+    }
+    CHECK(range.outMax > 45);
+
+    // 最小温度方向相反 变低是向外扩展
+    float lastMin = range.smoothMin;
+    update(&range, 0, 35);
+    CHECK(fabsf(range.smoothMin - (lastMin + (0 - lastMin) * config.attack)) < 1e-3f);
+    CHECK(range.outMin == range.smoothMin);
+    lastMin = range.smoothMin;
+    update(&range, 20, 35);
+    CHECK(fabsf(range.smoothMin - (lastMin + (20 - lastMin) * config.release)) < 1e-3f);
+
+    // 重置后直接使用输入的范围
+    autorange_reset(&range);
+    CHECK(1 == update(&range, -10, 100));
+    CHECK(range.outMin == -10 && range.outMax == 100);
+    CHECK(range.smoothMin == -10 && range.smoothMax == 100);
+    CHECK(0 == update(&range, -10.2f, 100.3f));
+
+    // 分位数 和排序的结果比较 包括视口 (stride 大于宽度)
+    {
+        static float image[32 * 24];
+        static const struct
+        {
+            uint16_t x, y, width, height;
+        } views[] = {
+            { 0, 0, 32, 24 },
+            { 8, 6, 16, 12 }, // 数字变焦 2x
+            { 12, 9, 8, 6 }, // 数字变焦 4x
+            { 31, 0, 1, 24 },
+        };
+
+        for (uint32_t trial = 0; trial < 20; trial++) {
+            for (int i = 0; i < 32 * 24; i++) {
+                image[i] = 20 + noise(&seed, 10);
+            }
+            // 几个热点和冷点 (例如烙铁头 冰块)
+            for (int i = 0; i < 5; i++) {
+                image[fixture_rand(&seed) % (32 * 24)] = 500 + i;
+                image[fixture_rand(&seed) % (32 * 24)] = -40 - i;
+            }
+
+            for (size_t v = 0; v < sizeof(views) / sizeof(views[0]); v++) {
+                for (uint8_t pct = 0; pct <= 10; pct++) {
+                    float minT = NAN, maxT = NAN, refMin, refMax;
+
+                    autorange_percentile(image, 32, views[v].x, views[v].y, views[v].width, views[v].height, pct, &minT, &maxT);
+                    ref_percentile(image, 32, views[v].x, views[v].y, views[v].width, views[v].height, pct, &refMin, &refMax);
+                    CHECK_MSG(minT == refMin && maxT == refMax, "view %zu %u%%: %f~%f expected %f~%f", v, pct, minT, maxT, refMin, refMax);
+                }
+            }
+
+            // 整幅 1% 去掉最多 7 个异常点
+            float minT, maxT;
+            autorange_percentile(image, 32, 0, 0, 32, 24, 1, &minT, &maxT);
+            CHECK(minT > 9.9f && maxT < 30.1f);
+        }
+    }
+
+    return host_test_result("test_autorange");
+}
@@ -0,0 +1,218 @@
+#include "IDW.h"
+#include "host_test.h"
+#include "interp_fixture.h"
+#include <math.h>
+#include <string.h>
+
+// idwBicubicRows (定点 Catmull-Rom 整数倍放大) 与浮点计算比较
+// 按像素中心对齐 边缘取最近的源像素
+
+#define MAX_DEST (320 * 240)
+
+static const struct
+{
+    uint16_t srcWidth;
+    uint16_t srcHeight;
+    uint16_t scale;
+} sizes[] = {
+    { 32, 24, 10 }, // 双三次插值模式 不缩放
+    { 16, 12, 20 }, // 数字变焦 2x
+    { 8, 6, 40 }, // 数字变焦 4x
+    { 32, 24, 1 },
+    { 32, 24, 3 },
+    { 7, 5, 9 },
+    { 2, 2, 7 },
+    { 128, 3, 2 },
+};
+
+// Catmull-Rom 权重 t = 插值点到第二个源像素的距离
+static void ref_weights(double t, double* w)
+{
+    w[0] = (-t * t * t + 2 * t * t - t) * 0.5;
+    w[1] = (3 * t * t * t - 5 * t * t + 2) * 0.5;
+    w[2] = (-3 * t * t * t + 4 * t * t + t) * 0.5;
+    w[3] = (t * t * t - t * t) * 0.5;
+}
+
+// 输出坐标 i 对应的 4 个源像素中第一个的位置和权重
+static int ref_taps(uint16_t i, uint16_t scale, double* w)
+{
+    double u = (i + 0.5) / scale - 0.5;
+    double first = floor(u);
+
+    ref_weights(u - first, w);
+    return (int)first - 1;
+}
+
+static int clampi(int v, int size)
+{
+    return v < 0 ? 0 : (v >= size ? size - 1 : v);
+}
+
+// 浮点 Catmull-Rom pWx/pWy 为 NULL 时用精确权重 否则用给定的 (定点表的) 权重
+static double ref_pixel(const int16_t* pSrc, uint16_t srcWidth, uint16_t srcHeight, uint16_t scale, uint16_t x, uint16_t y, const double* pWx, const double* pWy)
+{
+    double wx[4], wy[4];
+    int x0 = ref_taps(x, scale, wx);
+    int y0 = ref_taps(y, scale, wy);
+    double sum = 0;
+
+    if (pWx) {
+        memcpy(wx, pWx, sizeof(wx));
+        memcpy(wy, pWy, sizeof(wy));
+    }
+    for (int j = 0; j < 4; j++) {
+        const int16_t* pRow = pSrc + clampi(y0 + j, srcHeight) * srcWidth;
+        double row = 0;
+
+        for (int i = 0; i < 4; i++) {
+            row += pRow[clampi(x0 + i, srcWidth)] * wx[i];
+        }
+        sum += row * wy[j];
+    }
+
+    return sum;
+}
+
+static void phase_weights(const sIdwBicubic* pBicubic, uint16_t i, double* w)
+{
+    const sIdwBicubicPhase* pPhase = &pBicubic->phase[i % pBicubic->scale];
+
+    for (int k = 0; k < 4; k++) {
+        w[k] = (double)pPhase->weight[k] / IDW_BICUBIC_ONE;
+    }
+}
+
+int main(void)
+{
+    static int16_t src[128 * 24];
+    static int16_t full[MAX_DEST];
+    static int16_t band[MAX_DEST];
+    static uint16_t frame[MAX_DEST];
+    sIdwBicubic bicubic;
+    sPaletteMap map;
+    double maxExactErr = 0;
+
+    CHECK(0 == palette_setMap(&map, BlueRed, 0, 1000));
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        const uint16_t sw = sizes[s].srcWidth, sh = sizes[s].srcHeight, scale = sizes[s].scale;
+        const uint16_t dw = sw * scale, dh = sh * scale;
+
+        CHECK(0 == idwBicubicInit(&bicubic, sw, sh, scale));
+
+        // 权重表 每个相位的权重之和为 1 和精确的权重相差不超过四舍五入加上补偿的误差
+        for (uint16_t p = 0; p < scale; p++) {
+            double w[4];
+            int32_t sum = 0;
+            int first = ref_taps(p, scale, w);
+
+            CHECK_MSG(bicubic.phase[p].offset == first + 2, "x%u phase %u offset %u", scale, p, bicubic.phase[p].offset);
+            for (int k = 0; k < 4; k++) {
+                sum += bicubic.phase[p].weight[k];
+                CHECK_MSG(fabs(bicubic.phase[p].weight[k] - w[k] * IDW_BICUBIC_ONE) <= 2.0, "x%u phase %u weight %d", scale, p, k);
+            }
+            CHECK(sum == IDW_BICUBIC_ONE);
+        }
+
+        for (uint32_t seed = 1; seed <= 4; seed++) {
+            if (seed <= 2) {
+                fixture_smooth_image(src, sw, sh, seed);
+            } else {
+                fixture_random_image(src, sw, sh, seed, -400, 3000);
+            }
+            idwBicubicRows(&bicubic, src, full, 0, dh);
+
+            for (uint16_t y = 0; y < dh; y++) {
+                for (uint16_t x = 0; x < dw; x++) {
+                    double wx[4], wy[4];
+                    const int16_t out = full[y * dw + x];
+
+                    // 用定点表的权重 只有垂直方向保留 2 位小数和最后四舍五入的误差
+                    phase_weights(&bicubic, x, wx);
+                    phase_weights(&bicubic, y, wy);
+                    double ref = ref_pixel(src, sw, sh, scale, x, y, wx, wy);
+                    CHECK_MSG(fabs(out - ref) <= 0.75, "%ux%u x%u seed %u (%u, %u): %d ref %.3f", sw, sh, scale, seed, x, y, out, ref);
+
+                    // 平滑图像和精确的 Catmull-Rom 相差不超过 1
+                    if (seed <= 2) {
+                        double exact = ref_pixel(src, sw, sh, scale, x, y, NULL, NULL);
+
+                        maxExactErr = fmax(maxExactErr, fabs(out - exact));
+                        CHECK_MSG(fabs(out - exact) <= 1.0, "%ux%u x%u seed %u (%u, %u): %d exact %.3f", sw, sh, scale, seed, x, y, out, exact);
+                    }
+                }
+            }
+
+            // 奇数倍放大时每个源像素中心有一个输出像素 结果就是源像素
+            if (scale & 1) {
+                for (uint16_t sy = 0; sy < sh; sy++) {
+                    for (uint16_t sx = 0; sx < sw; sx++) {
+                        int16_t out = full[(sy * scale + scale / 2) * dw + sx * scale + scale / 2];
+
+                        CHECK_MSG(out == src[sy * sw + sx], "%ux%u x%u source (%u, %u): %d expected %d", sw, sh, scale, sx, sy, out, src[sy * sw + sx]);
+                    }
+                }
+            }
+
+            // 分段计算和整幅计算完全相同
+            for (uint16_t start = 0; start < dh;) {
+                uint16_t end = start + 1 + (start * 3 + seed) % 29;
+
+                if (end > dh) {
+                    end = dh;
+                }
+                idwBicubicRows(&bicubic, src, band, start, end);
+                CHECK_MSG(0 == memcmp(band, full + start * dw, (end - start) * dw * sizeof(int16_t)), "%ux%u x%u rows %u~%u", sw, sh, scale, start, end);
+                start = end;
+            }
+
+            // 伪彩色输出 = 插值结果查表 水平镜像
+            idwBicubicPaletteRows(&bicubic, src, frame, &map, 0, dh);
+            for (uint32_t y = 0, bad = 0; y < dh && !bad; y++) {
+                for (uint32_t x = 0; x < dw && !bad; x++) {
+                    bad = frame[y * dw + dw - 1 - x] != palette_color(&map, full[y * dw + x]);
+                    CHECK_MSG(!bad, "%ux%u x%u palette (%u, %u)", sw, sh, scale, x, y);
+                }
+            }
+        }
+    }
+    printf("max error against exact Catmull-Rom on smooth images %.3f\n", maxExactErr);
+
+    // 平坦区域不偏色 线性渐变离边缘 2 个源像素以外不变形
+    CHECK(0 == idwBicubicInit(&bicubic, 32, 24, 10));
+    for (int level = -32768; level <= 32767; level += 4369) {
+        for (int i = 0; i < 32 * 24; i++) {
+            src[i] = level;
+        }
+        idwBicubicRows(&bicubic, src, full, 0, 240);
+        for (int i = 0, bad = 0; i < 320 * 240 && !bad; i++) {
+            bad = full[i] != level;
+            CHECK_MSG(!bad, "flat %d pixel %d: %d", level, i, full[i]);
+        }
+    }
+
+    for (int y = 0; y < 24; y++) {
+        for (int x = 0; x < 32; x++) {
+            src[y * 32 + x] = 100 + 37 * x - 23 * y;
+        }
+    }
+    idwBicubicRows(&bicubic, src, full, 0, 240);
+    for (int y = 20; y < 220; y++) {
+        for (int x = 20; x < 300; x++) {
+            double u = (x + 0.5) / 10 - 0.5, v = (y + 0.5) / 10 - 0.5;
+            double expected = 100 + 37 * u - 23 * v;
+
+            CHECK_MSG(fabs(full[y * 320 + x] - expected) <= 0.75, "ramp (%d, %d): %d expected %.3f", x, y, full[y * 320 + x], expected);
+        }
+    }
+
+    // 参数错误
+    CHECK(-1 == idwBicubicInit(&bicubic, 1, 24, 10));
+    CHECK(-1 == idwBicubicInit(&bicubic, IDW_SCALER_MAX_SRC + 1, 24, 1));
+    CHECK(-1 == idwBicubicInit(&bicubic, 32, 1, 10));
+    CHECK(-1 == idwBicubicInit(&bicubic, 32, 24, 0));
+    CHECK(-1 == idwBicubicInit(&bicubic, 32, 24, IDW_BICUBIC_MAX_SCALE + 1));
+
+    return host_test_result("test_bicubic");
+}
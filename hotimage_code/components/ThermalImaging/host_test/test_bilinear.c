@@ -0,0 +1,168 @@
+#include "IDW.h"
+#include "host_test.h"
+#include "interp_fixture.h"
+#include <math.h>
+#include <string.h>
+
+// idwScaleRows (定点双线性缩放) 与同样坐标映射的浮点计算比较
+// 权重 Q8 的误差每个方向不超过 1/512, 和浮点结果相差不超过 0.5 + 4 个源像素的差 * 2 / 512
+// 平滑图像上取整后相差不超过 1
+
+#define MAX_DEST (320 * 240)
+
+static const struct
+{
+    uint16_t srcWidth;
+    uint16_t srcHeight;
+    uint16_t destWidth;
+    uint16_t destHeight;
+} sizes[] = {
+    { 64, 48, 320, 240 }, // 高质量模式 高斯模糊后放大到屏幕
+    { 32, 24, 240, 180 },
+    { 24, 32, 100, 77 },
+    { 2, 2, 7, 5 },
+    { 64, 48, 40, 30 }, // 缩小
+    { 128, 3, 320, 9 },
+};
+
+// 和 scaler_build_table 相同的映射 浮点权重
+static void ref_coord(uint16_t i, uint16_t srcSize, uint16_t destSize, uint16_t* pIdx, double* pWeight)
+{
+    uint32_t pos = (uint32_t)i * srcSize;
+
+    *pIdx = pos / destSize;
+    *pWeight = (double)(pos % destSize) / destSize;
+    if (*pIdx >= srcSize - 1) {
+        *pIdx = srcSize - 2;
+        *pWeight = 1.0;
+    }
+}
+
+static double ref_pixel(const int16_t* pSrc, uint16_t srcWidth, uint16_t srcHeight, uint16_t destWidth, uint16_t destHeight, uint16_t x, uint16_t y, double* pBound)
+{
+    uint16_t ix, iy;
+    double wx, wy;
+
+    ref_coord(x, srcWidth, destWidth, &ix, &wx);
+    ref_coord(y, srcHeight, destHeight, &iy, &wy);
+
+    const int16_t* p = pSrc + iy * srcWidth + ix;
+    double top = p[0] + (p[1] - p[0]) * wx;
+    double bottom = p[srcWidth] + (p[srcWidth + 1] - p[srcWidth]) * wx;
+    int16_t lo = p[0], hi = p[0];
+
+    for (int k = 1; k < 4; k++) {
+        int16_t v = p[(k >> 1) * srcWidth + (k & 1)];
+
+        lo = v < lo ? v : lo;
+        hi = v > hi ? v : hi;
+    }
+    *pBound = 0.5 + (hi - lo) * 2.0 / (IDW_SCALER_ONE * 2) + 1e-9;
+
+    return top + (bottom - top) * wy;
+}
+
+int main(void)
+{
+    static int16_t src[128 * 48];
+    static int16_t full[MAX_DEST];
+    static int16_t band[MAX_DEST];
+    static uint16_t frame[MAX_DEST];
+    sIdwScaler scaler;
+    sPaletteMap map;
+
+    CHECK(0 == palette_setMap(&map, Iron, 0, 1000));
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        const uint16_t sw = sizes[s].srcWidth, sh = sizes[s].srcHeight;
+        const uint16_t dw = sizes[s].destWidth, dh = sizes[s].destHeight;
+        int maxErr = 0;
+
+        CHECK(0 == idwScalerInit(&scaler, sw, sh, dw, dh));
+
+        for (uint32_t seed = 1; seed <= 4; seed++) {
+            fixture_smooth_image(src, sw, sh, seed * 7919u);
+            idwScaleRows(&scaler, src, full, 0, dh);
+
+            for (uint16_t y = 0; y < dh; y++) {
+                for (uint16_t x = 0; x < dw; x++) {
+                    double bound;
+                    double ref = ref_pixel(src, sw, sh, dw, dh, x, y, &bound);
+                    int err = abs(full[y * dw + x] - (int)lround(ref));
+
+                    if (err > maxErr) {
+                        maxErr = err;
+                    }
+                    CHECK_MSG(err <= 1, "%ux%u->%ux%u (%u, %u): %d ref %.3f", sw, sh, dw, dh, x, y, full[y * dw + x], ref);
+                    CHECK_MSG(fabs(full[y * dw + x] - ref) <= bound, "%ux%u->%ux%u (%u, %u): %d ref %.3f bound %.3f", sw, sh, dw, dh, x, y, full[y * dw + x], ref, bound);
+
+                    // 落在源像素上的输出不插值
+                    if (0 == ((uint32_t)x * sw) % dw && 0 == ((uint32_t)y * sh) % dh) {
+                        uint16_t sx = (uint32_t)x * sw / dw, sy = (uint32_t)y * sh / dh;
+
+                        CHECK_MSG(full[y * dw + x] == src[sy * sw + sx], "%ux%u->%ux%u (%u, %u) source pixel", sw, sh, dw, dh, x, y);
+                    }
+                }
+            }
+
+            // 左上角是第一个源像素 放大时右下角是最后一个源像素
+            CHECK(full[0] == src[0]);
+            if (dw >= sw && dh >= sh && (uint32_t)(dw - 1) * sw / dw >= sw - 1u && (uint32_t)(dh - 1) * sh / dh >= sh - 1u) {
+                CHECK(full[dw * dh - 1] == src[sw * sh - 1]);
+            }
+
+            // 分段计算和整幅计算完全相同 段的长度不整齐
+            for (uint16_t start = 0; start < dh;) {
+                uint16_t end = start + 1 + (start * 7 + seed) % 23;
+
+                if (end > dh) {
+                    end = dh;
+                }
+                idwScaleRows(&scaler, src, band, start, end);
+                CHECK_MSG(0 == memcmp(band, full + start * dw, (end - start) * dw * sizeof(int16_t)), "%ux%u->%ux%u rows %u~%u", sw, sh, dw, dh, start, end);
+                start = end;
+            }
+
+            // 伪彩色输出 = 插值结果查表 水平镜像
+            idwScalePaletteRows(&scaler, src, frame, &map, 0, dh);
+            for (uint32_t y = 0, bad = 0; y < dh && !bad; y++) {
+                for (uint32_t x = 0; x < dw && !bad; x++) {
+                    bad = frame[y * dw + dw - 1 - x] != palette_color(&map, full[y * dw + x]);
+                    CHECK_MSG(!bad, "%ux%u->%ux%u palette (%u, %u)", sw, sh, dw, dh, x, y);
+                }
+            }
+        }
+
+        printf("%ux%u -> %ux%u max error %d\n", sw, sh, dw, dh, maxErr);
+        idwScalerFree(&scaler);
+        CHECK(NULL == scaler.pXIdx);
+    }
+
+    // 平坦区域不偏色 包括负值
+    {
+        const int16_t levels[] = { -400, -1, 0, 1, 255, 3000, 32767, -32768 };
+
+        CHECK(0 == idwScalerInit(&scaler, 32, 24, 320, 240));
+        for (size_t l = 0; l < sizeof(levels) / sizeof(levels[0]); l++) {
+            for (int i = 0; i < 32 * 24; i++) {
+                src[i] = levels[l];
+            }
+            idwScaleRows(&scaler, src, full, 0, 240);
+            for (int i = 0, bad = 0; i < 320 * 240 && !bad; i++) {
+                bad = full[i] != levels[l];
+                CHECK_MSG(!bad, "flat %d pixel %d: %d", levels[l], i, full[i]);
+            }
+        }
+        idwScalerFree(&scaler);
+    }
+
+    // 参数错误
+    CHECK(-1 == idwScalerInit(&scaler, 1, 24, 320, 240));
+    CHECK(-1 == idwScalerInit(&scaler, IDW_SCALER_MAX_SRC + 1, 24, 320, 240));
+    CHECK(-1 == idwScalerInit(&scaler, 32, 1, 320, 240));
+    CHECK(-1 == idwScalerInit(&scaler, 32, 24, 0, 240));
+    CHECK(-1 == idwScalerInit(&scaler, 32, 24, 320, 0));
+    CHECK(NULL == scaler.pXIdx);
+
+    return host_test_result("test_bilinear");
+}
@@ -0,0 +1,205 @@
+#include "host_test.h"
+
+// 采集调度 WaitDataReady 是 driver_MLX90640.c 内部的 static 函数 直接包含源文件测试
+// 时钟 延时和状态寄存器换成模拟的传感器 休眠和查询只推进模拟时间
+#define esp_timer_get_time sim_timer_get_time
+#define esp_rom_delay_us sim_delay_us
+#define vTaskDelay sim_task_delay
+#define MLX90640_I2CRead sim_i2c_read
+#include "driver_MLX90640.c"
+
+#define SUBPAGE_US 62500 // 16Hz
+#define I2C_POLL_US 60 // 读一次状态寄存器的总线时间
+#define FRAME_READ_US 5000 // 读取一个子页
+#define PROCESS_US 25000 // 计算温度和显示
+#define WARMUP_FRAMES 20 // 第一次同步按节拍查询 之后几帧才收敛到预计时刻
+
+static int64_t simNowUs = 1000000;
+static int64_t sensorStartUs = 0; // 第 0 个子页就绪的时间
+static int64_t sensorStopUs = INT64_MAX; // 之后不再产生新的子页
+static uint32_t sensorPeriodUs = SUBPAGE_US; // 传感器实际的子页周期 和设置的周期有偏差
+static int64_t clearedUs = 0; // 上次读取子页后清除就绪标志的时间
+static int sensorI2CError = 0;
+
+int64_t sim_timer_get_time(void)
+{
+    return simNowUs;
+}
+
+void sim_delay_us(uint32_t us)
+{
+    simNowUs += us;
+}
+
+void sim_task_delay(TickType_t ticks)
+{
+    simNowUs += (int64_t)ticks * portTICK_PERIOD_MS * 1000;
+}
+
+// 最近一个已经就绪的子页的就绪时间 还没有子页时返回 INT64_MIN
+static int64_t sensor_last_ready(int64_t nowUs)
+{
+    int64_t k;
+
+    if (nowUs > sensorStopUs) {
+        nowUs = sensorStopUs;
+    }
+    if (nowUs < sensorStartUs) {
+        return INT64_MIN;
+    }
+    k = (nowUs - sensorStartUs) / sensorPeriodUs;
+    return sensorStartUs + k * sensorPeriodUs;
+}
+
+int sim_i2c_read(uint8_t slaveAddr, uint16_t startAddress, uint16_t nMemAddressRead, uint16_t* data)
+{
+    simNowUs += I2C_POLL_US;
+    if (sensorI2CError) {
+        return -1;
+    }
+    for (uint16_t i = 0; i < nMemAddressRead; i++) {
+        data[i] = 0;
+    }
+    if (startAddress == 0x8000 && sensor_last_ready(simNowUs) > clearedUs) {
+        data[0] = 0x0008;
+    }
+
+    return 0;
+}
+
+// 传感器从现在开始按给定周期产生子页
+static void sensor_start(uint32_t periodUs)
+{
+    sensorPeriodUs = periodUs;
+    sensorStartUs = simNowUs + periodUs / 3;
+    sensorStopUs = INT64_MAX;
+    clearedUs = simNowUs;
+}
+
+// 读取子页并清除就绪标志 然后处理 processUs
+static void consume(int64_t processUs)
+{
+    simNowUs += FRAME_READ_US;
+    clearedUs = simNowUs;
+    simNowUs += processUs;
+}
+
+typedef struct
+{
+    uint32_t frames;
+    uint32_t maxPolls;
+    uint32_t totalPolls;
+    int64_t maxLatencyUs; // 子页就绪到等待返回
+    int64_t maxAnchorErrUs; // 记录的就绪时间和实际就绪时间之差
+} sWaitStats;
+
+// 等待 frames 个子页 预热之后统计查询次数和延迟
+static void run(uint32_t frames, int64_t processUs, sWaitStats* pStats)
+{
+    uint16_t status;
+
+    memset(pStats, 0, sizeof(*pStats));
+    for (uint32_t n = 0; n < frames; n++) {
+        int64_t readyUs;
+        int error = WaitDataReady(0x33, &status);
+
+        CHECK_MSG(error == 0, "frame %u: error %d", n, error);
+        readyUs = sensor_last_ready(simNowUs);
+        if (n >= WARMUP_FRAMES) {
+            const int64_t latencyUs = simNowUs - readyUs;
+            const int64_t anchorErrUs = llabs(MLX90640_GetLastReadyTime() - readyUs);
+
+            pStats->frames++;
+            pStats->totalPolls += MLX90640_GetLastPollCount();
+            if (MLX90640_GetLastPollCount() > pStats->maxPolls) {
+                pStats->maxPolls = MLX90640_GetLastPollCount();
+            }
+            if (latencyUs > pStats->maxLatencyUs) {
+                pStats->maxLatencyUs = latencyUs;
+            }
+            if (anchorErrUs > pStats->maxAnchorErrUs) {
+                pStats->maxAnchorErrUs = anchorErrUs;
+            }
+        }
+        consume(processUs);
+    }
+}
+
+static void print_stats(const char* name, const sWaitStats* pStats)
+{
+    printf("%-16s polls avg %.2f max %u, latency max %lld us, ready time error max %lld us\n", name,
+        (double)pStats->totalPolls / pStats->frames, pStats->maxPolls, (long long)pStats->maxLatencyUs, (long long)pStats->maxAnchorErrUs);
+}
+
+int main(void)
+{
+    sWaitStats stats;
+    uint16_t status;
+
+    // 不设置周期 一直查询 作为比较
+    MLX90640_SetSubPagePeriod(0);
+    sensor_start(SUBPAGE_US);
+    run(200, PROCESS_US, &stats);
+    print_stats("unpaced", &stats);
+    CHECK(stats.maxPolls > 4);
+
+    // 周期准确 醒来后几次查询就绪 记录的就绪时间按周期累加 1000 个子页后不漂移
+    MLX90640_SetSubPagePeriod(SUBPAGE_US);
+    sensor_start(SUBPAGE_US);
+    run(1000, PROCESS_US, &stats);
+    print_stats("paced", &stats);
+    CHECK_MSG(stats.maxPolls <= 4, "polls %u", stats.maxPolls);
+    CHECK_MSG(stats.maxLatencyUs <= READY_GUARD_US, "latency %lld", (long long)stats.maxLatencyUs);
+    CHECK_MSG(stats.maxAnchorErrUs <= READY_GUARD_US, "ready time error %lld", (long long)stats.maxAnchorErrUs);
+
+    // 传感器比设置的周期快 1% 第一次查询已经就绪时重新同步
+    MLX90640_SetSubPagePeriod(SUBPAGE_US);
+    sensor_start(SUBPAGE_US * 99 / 100);
+    run(1000, PROCESS_US, &stats);
+    print_stats("sensor 1% fast", &stats);
+    CHECK_MSG(stats.maxPolls <= 4, "polls %u", stats.maxPolls);
+    CHECK_MSG(stats.maxLatencyUs <= 2 * READY_GUARD_US, "latency %lld", (long long)stats.maxLatencyUs);
+
+    // 传感器比设置的周期慢 1% 晚于预计时刻 READY_GUARD_US 以上时重新同步
+    MLX90640_SetSubPagePeriod(SUBPAGE_US);
+    sensor_start(SUBPAGE_US * 101 / 100);
+    run(1000, PROCESS_US, &stats);
+    print_stats("sensor 1% slow", &stats);
+    CHECK_MSG(stats.maxPolls <= 6, "polls %u", stats.maxPolls);
+    CHECK_MSG(stats.maxLatencyUs <= 2 * READY_GUARD_US, "latency %lld", (long long)stats.maxLatencyUs);
+
+    // 一个子页处理太久 错过两个子页 跳到最近的子页 不重新同步
+    MLX90640_SetSubPagePeriod(SUBPAGE_US);
+    sensor_start(SUBPAGE_US);
+    run(WARMUP_FRAMES + 10, PROCESS_US, &stats);
+    simNowUs += SUBPAGE_US * 5 / 2;
+    CHECK(0 == WaitDataReady(0x33, &status));
+    CHECK(1 == MLX90640_GetLastPollCount());
+    CHECK_MSG(llabs(MLX90640_GetLastReadyTime() - sensor_last_ready(simNowUs)) <= READY_GUARD_US, "missed: ready %lld sensor %lld",
+        (long long)MLX90640_GetLastReadyTime(), (long long)sensor_last_ready(simNowUs));
+    consume(PROCESS_US);
+    run(WARMUP_FRAMES + 100, PROCESS_US, &stats);
+    CHECK_MSG(stats.maxLatencyUs <= READY_GUARD_US, "after missed latency %lld", (long long)stats.maxLatencyUs);
+
+    // 传感器停止 超过子页周期加 POLL_TIMEOUT_US 后返回 -10 恢复后重新同步
+    sensorStopUs = simNowUs;
+    {
+        const int64_t startUs = simNowUs;
+
+        CHECK(-10 == WaitDataReady(0x33, &status));
+        CHECK_MSG(simNowUs - startUs <= 2 * SUBPAGE_US + POLL_TIMEOUT_US + POLL_TICK_US, "timeout after %lld us", (long long)(simNowUs - startUs));
+        CHECK(simNowUs - startUs > POLL_TIMEOUT_US);
+    }
+    CHECK(0 == expectedReadyUs);
+    sensor_start(SUBPAGE_US);
+    run(WARMUP_FRAMES + 100, PROCESS_US, &stats);
+    CHECK_MSG(stats.maxLatencyUs <= READY_GUARD_US, "after timeout latency %lld", (long long)stats.maxLatencyUs);
+
+    // 总线错误直接返回
+    sensorI2CError = 1;
+    CHECK(-1 == WaitDataReady(0x33, &status));
+    CHECK(1 == MLX90640_GetLastPollCount());
+    sensorI2CError = 0;
+
+    return host_test_result("test_data_ready");
+}
@@ -0,0 +1,85 @@
+#include "host_test.h"
+#include <float.h>
+#include <math.h>
+
+// FastRoot4 是 driver_MLX90640.c 内部的 static 函数 直接包含源文件测试
+#include "driver_MLX90640.c"
+
+#define ROOT4_MAX_REL_ERROR 7e-7 // FastRoot4 注释中的相对误差
+#define TO_MAX_ERROR 0.001 // Kconfig 中 -40~300℃ 的温度误差
+
+/**
+ * @brief 相对误差
+ *
+ * @param x
+ * @return double
+ */
+static double root4RelError(float x)
+{
+    double ref = sqrt(sqrt((double)x));
+
+    return fabs(FastRoot4(x) - ref) / ref;
+}
+
+int main(void)
+{
+    static paramsMLX90640 params;
+    union {
+        float f;
+        uint32_t u;
+    } v;
+    double maxRel = 0;
+    double maxStrideRel = 0;
+    double maxToErr = 0;
+
+    // 生成 invRoot4Seed
+    MLX90640_BuildCalibTable(&params);
+
+    // x 乘以 2^4q 时初值和两次牛顿迭代的每一步都只差 2^q, 误差只取决于指数低 2 位和尾数
+    // 遍历 [1, 16) 内的全部单精度数就覆盖了所有规格化数
+    for (v.f = 1.0f; v.f < 16.0f; v.u++) {
+        double rel = root4RelError(v.f);
+
+        if (rel > maxRel) {
+            maxRel = rel;
+        }
+    }
+    CHECK_MSG(maxRel < ROOT4_MAX_REL_ERROR, "max relative error %.3g", maxRel);
+
+    // 其它指数 按步长抽查 包括两端
+    for (uint64_t u = 0x00800000; u < 0x7f800000; u += 97) {
+        v.u = (uint32_t)u;
+        double rel = root4RelError(v.f);
+
+        if (rel > maxStrideRel) {
+            maxStrideRel = rel;
+        }
+    }
+    v.f = FLT_MAX;
+    maxStrideRel = fmax(maxStrideRel, root4RelError(v.f));
+    v.f = FLT_MIN;
+    maxStrideRel = fmax(maxStrideRel, root4RelError(v.f));
+    CHECK_MSG(maxStrideRel < ROOT4_MAX_REL_ERROR, "max relative error %.3g", maxStrideRel);
+
+    // 非正数 非规格化数 无穷大 与 sqrtf 相同
+    CHECK(FastRoot4(0.0f) == 0.0f);
+    CHECK(FastRoot4(FLT_MIN / 4) == sqrtf(sqrtf(FLT_MIN / 4)));
+    CHECK(isinf(FastRoot4(INFINITY)));
+    CHECK(isnan(FastRoot4(-1.0f)));
+
+    // 温度 x = (To + 273.15)^4 每 0.001℃ 一点
+    for (int i = -40000; i <= 300000; i++) {
+        double kelvin = i / 1000.0 + 273.15;
+        float x = (float)(kelvin * kelvin * kelvin * kelvin);
+        double err = fabs((FastRoot4(x) - MLX90640_KELVIN) - (sqrt(sqrt((double)x)) - 273.15));
+
+        if (err > maxToErr) {
+            maxToErr = err;
+        }
+    }
+    CHECK_MSG(maxToErr < TO_MAX_ERROR, "max To error %.3g", maxToErr);
+
+    printf("FastRoot4 max relative error: [1,16) exhaustive %.3g, all exponents stride 97 %.3g, To -40~300C %.3g C\n", maxRel, maxStrideRel, maxToErr);
+
+    return host_test_result("test_fast_root4");
+}
@@ -0,0 +1,286 @@
+#include "host_test.h"
+#include "framering.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <string.h>
+
+// 帧环形缓存 单线程检查帧号和丢帧统计 多线程压力测试检查读者不会读到不完整的帧
+// framering.c 以 memcpy=framering_test_memcpy 编译 读者复制到一半时可以插入生产者的动作 确定地制造覆盖
+// 压力测试中读者复制时分段让出 CPU, 单核主机上也能和生产者交错
+
+#define STRESS_FRAMES 20000
+#define STRESS_READERS 3
+#define FRAME_WORDS 2048
+#define COPY_CHUNK 1024 // 读者每复制这么多字节让出一次 CPU
+#define PRODUCER_YIELDS 4 // 生产者每帧之间让出 CPU 的次数 模拟帧间隔
+
+typedef struct
+{
+    uint32_t frameNo;
+    uint32_t words[FRAME_WORDS]; // words[i] = frameNo * 2654435761 + i
+} sTestFrame;
+
+static sFrameRing stressRing;
+static atomic_int stressDone;
+
+static void (*copyHook)(void); // 读者复制到一半时调用一次
+
+void* framering_test_memcpy(void* dest, const void* src, size_t n)
+{
+    if (copyHook) {
+        void (*hook)(void) = copyHook;
+
+        copyHook = NULL;
+        memcpy(dest, src, n / 2);
+        hook();
+        memcpy((uint8_t*)dest + n / 2, (const uint8_t*)src + n / 2, n - n / 2);
+        return dest;
+    }
+
+    for (size_t i = 0; i < n; i += COPY_CHUNK) {
+        memcpy((uint8_t*)dest + i, (const uint8_t*)src + i, n - i < COPY_CHUNK ? n - i : COPY_CHUNK);
+        sched_yield();
+    }
+    return dest;
+}
+
+static void fillFrame(sTestFrame* pFrame, uint32_t frameNo)
+{
+    pFrame->frameNo = frameNo;
+    for (int i = 0; i < FRAME_WORDS; i++) {
+        pFrame->words[i] = frameNo * 2654435761u + i;
+    }
+}
+
+static int frameValid(const sTestFrame* pFrame)
+{
+    for (int i = 0; i < FRAME_WORDS; i++) {
+        if (pFrame->words[i] != pFrame->frameNo * 2654435761u + i) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void* producerThread(void* arg)
+{
+    for (uint32_t n = 1; n <= STRESS_FRAMES; n++) {
+        fillFrame(framering_writeBegin(&stressRing), n);
+        framering_publish(&stressRing);
+        for (int i = 0; i < PRODUCER_YIELDS; i++) {
+            sched_yield();
+        }
+    }
+    atomic_store(&stressDone, 1);
+
+    return NULL;
+}
+
+typedef struct
+{
+    int index;
+    uint32_t reads;
+    uint32_t consumed; // 主要消费者处理的不同帧数
+    uint32_t torn; // 数据不完整
+    uint32_t mismatched; // 返回的帧号与数据不符
+    uint32_t backwards; // 帧号倒退
+    uint32_t partialBad; // 部分读取的数据不符
+} sReaderResult;
+
+static void* readerThread(void* arg)
+{
+    sReaderResult* pResult = arg;
+    static _Thread_local sTestFrame frame;
+    uint32_t lastFrameNo = 0;
+    uint32_t lastConsumed = 0;
+    uint32_t part[16];
+
+    while (!atomic_load(&stressDone)) {
+        uint32_t frameNo;
+
+        if (framering_read(&stressRing, &frame, 0, sizeof(frame), &frameNo)) {
+            continue;
+        }
+        pResult->reads++;
+        if (!frameValid(&frame)) {
+            pResult->torn++;
+        }
+        if (frame.frameNo != frameNo) {
+            pResult->mismatched++;
+        }
+        if (frameNo < lastFrameNo) {
+            pResult->backwards++;
+        }
+        lastFrameNo = frameNo;
+
+        // 第一个读者作为主要消费者
+        if (0 == pResult->index && frameNo != lastConsumed) {
+            framering_consumed(&stressRing, frameNo);
+            lastConsumed = frameNo;
+            pResult->consumed++;
+        }
+
+        // 只读一部分 (GetThermoData 的用法)
+        size_t offset = offsetof(sTestFrame, words) + (frameNo % (FRAME_WORDS - 16)) * sizeof(uint32_t);
+        if (0 == framering_read(&stressRing, part, offset, sizeof(part), &frameNo)) {
+            for (int i = 0; i < 16; i++) {
+                // 两次读取之间可能发布了新帧 按第二次的帧号检查
+                if (part[i] != frameNo * 2654435761u + (uint32_t)(offset - offsetof(sTestFrame, words)) / sizeof(uint32_t) + i) {
+                    pResult->partialBad++;
+                    break;
+                }
+            }
+        }
+    }
+
+    return NULL;
+}
+
+static void testSingleThread(void)
+{
+    static sFrameRing ring;
+    sTestFrame frame;
+    uint32_t frameNo = 0;
+
+    CHECK(1 == framering_read(&ring, &frame, 0, sizeof(frame), &frameNo));
+    CHECK(0 == framering_init(&ring, sizeof(sTestFrame)));
+    CHECK(1 == framering_read(&ring, &frame, 0, sizeof(frame), &frameNo));
+
+    // 写入期间读者仍然得到上一帧
+    fillFrame(framering_writeBegin(&ring), 1);
+    CHECK(1 == framering_read(&ring, &frame, 0, sizeof(frame), &frameNo));
+    framering_publish(&ring);
+    CHECK(0 == framering_read(&ring, &frame, 0, sizeof(frame), &frameNo));
+    CHECK(1 == frameNo && 1 == frame.frameNo && frameValid(&frame));
+
+    sTestFrame* pNext = framering_writeBegin(&ring);
+    fillFrame(pNext, 2);
+    CHECK(0 == framering_read(&ring, &frame, 0, sizeof(frame), &frameNo));
+    CHECK(1 == frameNo && 1 == frame.frameNo);
+    framering_consumed(&ring, 1);
+    framering_publish(&ring);
+    CHECK(0 == framering_getDroppedFrames(&ring));
+
+    // 帧 2 没有被处理就发布了帧 3
+    fillFrame(framering_writeBegin(&ring), 3);
+    framering_publish(&ring);
+    CHECK(1 == framering_getDroppedFrames(&ring));
+    CHECK(0 == framering_read(&ring, &frame, 0, sizeof(frame), &frameNo));
+    CHECK(3 == frameNo && 3 == frame.frameNo && frameValid(&frame));
+
+    // 槽循环使用
+    for (uint32_t n = 4; n < 4 + 2 * FRAMERING_SLOTS; n++) {
+        framering_consumed(&ring, n - 1);
+        fillFrame(framering_writeBegin(&ring), n);
+        framering_publish(&ring);
+        CHECK(0 == framering_read(&ring, &frame, 0, sizeof(frame), &frameNo));
+        CHECK(n == frameNo && n == frame.frameNo && frameValid(&frame));
+    }
+    CHECK(1 == framering_getDroppedFrames(&ring));
+    CHECK(0 == framering_getReadRetries(&ring));
+}
+
+static sFrameRing overlapRing;
+static uint32_t overlapFrameNo; // 生产者最后写入的帧号
+static int overlapPublishes; // 复制期间发布的帧数
+
+static void publishDuringCopy(void)
+{
+    for (int i = 0; i < overlapPublishes; i++) {
+        overlapFrameNo++;
+        fillFrame(framering_writeBegin(&overlapRing), overlapFrameNo);
+        framering_publish(&overlapRing);
+    }
+}
+
+static void beginDuringCopy(void)
+{
+    publishDuringCopy();
+    overlapFrameNo++;
+    fillFrame(framering_writeBegin(&overlapRing), overlapFrameNo); // 不发布 槽保持写入状态
+}
+
+static void testOverlap(void)
+{
+    sTestFrame frame;
+    uint32_t frameNo;
+    uint32_t retries;
+
+    CHECK(0 == framering_init(&overlapRing, sizeof(sTestFrame)));
+    overlapFrameNo = 1;
+    fillFrame(framering_writeBegin(&overlapRing), overlapFrameNo);
+    framering_publish(&overlapRing);
+
+    // 复制期间发布的帧数少于 FRAMERING_SLOTS 时 读者的槽没有被覆盖 不重试
+    for (int publishes = 0; publishes < FRAMERING_SLOTS; publishes++) {
+        uint32_t expected = overlapFrameNo;
+
+        retries = framering_getReadRetries(&overlapRing);
+        overlapPublishes = publishes;
+        copyHook = publishDuringCopy;
+        CHECK(0 == framering_read(&overlapRing, &frame, 0, sizeof(frame), &frameNo));
+        CHECK(expected == frameNo && expected == frame.frameNo && frameValid(&frame));
+        CHECK(retries == framering_getReadRetries(&overlapRing));
+    }
+
+    // 槽被覆盖 读者丢弃不完整的数据 重新读取最新帧
+    retries = framering_getReadRetries(&overlapRing);
+    overlapPublishes = FRAMERING_SLOTS;
+    copyHook = publishDuringCopy;
+    CHECK(0 == framering_read(&overlapRing, &frame, 0, sizeof(frame), &frameNo));
+    CHECK(overlapFrameNo == frameNo && overlapFrameNo == frame.frameNo && frameValid(&frame));
+    CHECK(retries + 1 == framering_getReadRetries(&overlapRing));
+
+    // 槽正在被写入 (序号为奇数) 同样重新读取
+    retries = framering_getReadRetries(&overlapRing);
+    overlapPublishes = FRAMERING_SLOTS - 1;
+    copyHook = beginDuringCopy;
+    CHECK(0 == framering_read(&overlapRing, &frame, 0, sizeof(frame), &frameNo));
+    CHECK(overlapFrameNo - 1 == frameNo && overlapFrameNo - 1 == frame.frameNo && frameValid(&frame));
+    CHECK(retries + 1 == framering_getReadRetries(&overlapRing));
+}
+
+static void testStress(void)
+{
+    pthread_t producer;
+    pthread_t readers[STRESS_READERS];
+    sReaderResult results[STRESS_READERS];
+    uint32_t reads = 0;
+
+    CHECK(0 == framering_init(&stressRing, sizeof(sTestFrame)));
+
+    for (int i = 0; i < STRESS_READERS; i++) {
+        memset(&results[i], 0, sizeof(results[i]));
+        results[i].index = i;
+        pthread_create(&readers[i], NULL, readerThread, &results[i]);
+    }
+    pthread_create(&producer, NULL, producerThread, NULL);
+
+    pthread_join(producer, NULL);
+    for (int i = 0; i < STRESS_READERS; i++) {
+        pthread_join(readers[i], NULL);
+        CHECK_MSG(0 == results[i].torn, "reader %d: %u torn frames", i, results[i].torn);
+        CHECK_MSG(0 == results[i].mismatched, "reader %d: %u frame numbers mismatched", i, results[i].mismatched);
+        CHECK_MSG(0 == results[i].backwards, "reader %d: frame number went backwards %u times", i, results[i].backwards);
+        CHECK_MSG(0 == results[i].partialBad, "reader %d: %u bad partial reads", i, results[i].partialBad);
+        reads += results[i].reads;
+    }
+    CHECK(reads > 0);
+
+    // 帧 n 只有在发布帧 n + 1 时已被处理才不算丢帧
+    CHECK(framering_getDroppedFrames(&stressRing) <= STRESS_FRAMES - 1);
+    CHECK(framering_getDroppedFrames(&stressRing) >= STRESS_FRAMES - 1 - results[0].consumed);
+
+    printf("%d frames, %u reads by %d readers, %u dropped, %u retries\n", STRESS_FRAMES, reads, STRESS_READERS,
+        framering_getDroppedFrames(&stressRing), framering_getReadRetries(&stressRing));
+}
+
+int main(void)
+{
+    testSingleThread();
+    testOverlap();
+    testStress();
+
+    return host_test_result("test_framering");
+}
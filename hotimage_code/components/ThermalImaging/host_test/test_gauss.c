@@ -0,0 +1,166 @@
+#include "IDW.h"
+#include "host_test.h"
+#include "interp_fixture.h"
+#include <math.h>
+#include <string.h>
+
+// idwGaussRows (最近邻放大 + 定点 3x3 高斯模糊) 与浮点计算比较
+// 一维核 [a, b, a] 由 3x3 核的角和中心算出 不使用定点表
+
+#define MAX_SRC (64 * 48)
+#define MAX_DEST (64 * 3 * 48 * 3)
+
+static const struct
+{
+    uint16_t srcWidth;
+    uint16_t srcHeight;
+} sizes[] = {
+    { 32, 24 }, // 高质量模式 不缩放
+    { 16, 12 }, // 数字变焦 2x
+    { 8, 6 }, // 数字变焦 4x
+    { IDW_GAUSS_MAX_WIDTH, 5 },
+    { 5, 3 },
+    { 1, 4 },
+};
+
+// Gauss.c 注释中的 3x3 核 角 边 中心
+static const double kernels[GAUSS_SIGMA_COUNT][3] = {
+    { 0.024879, 0.107973, 0.468592 },
+    { 0.077847, 0.123317, 0.195346 },
+    { 0.102059, 0.115349, 0.130371 },
+};
+
+static int clampi(int v, int size)
+{
+    return v < 0 ? 0 : (v >= size ? size - 1 : v);
+}
+
+// 放大后的网格上 (ox, oy) 处的源像素 最近邻
+static double upscaled(const int16_t* pSrc, uint16_t w, uint16_t h, uint16_t scale, int ox, int oy)
+{
+    return pSrc[clampi(oy, h * scale) / scale * w + clampi(ox, w * scale) / scale];
+}
+
+// 浮点高斯模糊 边缘按行 列分别取最近的像素
+static double ref_pixel(const int16_t* pSrc, uint16_t w, uint16_t h, uint16_t scale, eGaussSigma sigma, int ox, int oy)
+{
+    const double a0 = sqrt(kernels[sigma][0]), b0 = sqrt(kernels[sigma][2]);
+    const double a = a0 / (2 * a0 + b0), b = b0 / (2 * a0 + b0);
+    const double taps[3] = { a, b, a };
+    double sum = 0;
+
+    for (int j = 0; j < 3; j++) {
+        for (int i = 0; i < 3; i++) {
+            sum += taps[j] * taps[i] * upscaled(pSrc, w, h, scale, ox + i - 1, oy + j - 1);
+        }
+    }
+
+    return sum;
+}
+
+int main(void)
+{
+    static int16_t src[MAX_SRC];
+    static int16_t full[MAX_DEST];
+    static int16_t band[MAX_DEST];
+    double maxErr = 0;
+
+    for (int sigma = 0; sigma < GAUSS_SIGMA_COUNT; sigma++) {
+        idwGaussSetSigma(sigma);
+
+        for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+            const uint16_t sw = sizes[s].srcWidth, sh = sizes[s].srcHeight;
+
+            for (uint16_t scale = 1; scale <= 3; scale++) {
+                const uint16_t dw = sw * scale, dh = sh * scale;
+
+                // 平坦图像不偏色 包括 int16 的两端 (水平方向的累加不溢出)
+                for (int level = -32768; level <= 32767; level += 4369) {
+                    for (int i = 0; i < sw * sh; i++) {
+                        src[i] = level;
+                    }
+                    idwGauss(src, sw, sh, scale, full);
+                    for (int i = 0, bad = 0; i < dw * dh && !bad; i++) {
+                        bad = full[i] != level;
+                        CHECK_MSG(!bad, "sigma %d %ux%u x%u flat %d pixel %d: %d", sigma, sw, sh, scale, level, i, full[i]);
+                    }
+                }
+
+                for (uint32_t seed = 1; seed <= 4; seed++) {
+                    double tolerance = 1.0;
+
+                    if (seed <= 2) {
+                        fixture_smooth_image(src, sw, sh, seed);
+                    } else if (seed == 3) {
+                        fixture_random_image(src, sw, sh, seed, -400, 3000);
+                    } else {
+                        // 全范围 Q13 水平权重的误差不超过 1/16384, 乘以左右和中间的差 最大 2 * 65535
+                        fixture_random_image(src, sw, sh, seed, INT16_MIN, INT16_MAX);
+                        tolerance = 1.0 + 2 * 65535.0 / 16384;
+                    }
+                    idwGauss(src, sw, sh, scale, full);
+
+                    for (int y = 0; y < dh; y++) {
+                        for (int x = 0; x < dw; x++) {
+                            const double ref = ref_pixel(src, sw, sh, scale, sigma, x, y);
+                            const int16_t out = full[y * dw + x];
+
+                            if (seed <= 3) {
+                                maxErr = fmax(maxErr, fabs(out - ref));
+                            }
+                            CHECK_MSG(fabs(out - ref) <= tolerance, "sigma %d %ux%u x%u seed %u (%d, %d): %d ref %.3f", sigma, sw, sh, scale, seed, x, y, out, ref);
+                        }
+                    }
+
+                    // 分段计算和整幅计算完全相同
+                    for (uint16_t start = 0; start < dh;) {
+                        uint16_t end = start + 1 + (start * 3 + seed) % 7;
+
+                        if (end > dh) {
+                            end = dh;
+                        }
+                        memset(band, 0, sizeof(band));
+                        idwGaussRows(src, sw, sh, scale, band, start, end);
+                        CHECK_MSG(0 == memcmp(band + start * dw, full + start * dw, (end - start) * dw * sizeof(int16_t)), "sigma %d %ux%u x%u rows %u~%u", sigma, sw, sh, scale, start, end);
+                        start = end;
+                    }
+                }
+
+                // 左右边缘不取到相邻行: 每行最后一个像素 (在内存中紧挨下一行的第一个像素) 是热点
+                if (sw >= 3) {
+                    memset(src, 0, sw * sh * sizeof(int16_t));
+                    for (int y = 0; y < sh; y++) {
+                        src[y * sw + sw - 1] = 3000;
+                    }
+                    idwGauss(src, sw, sh, scale, full);
+                    for (int y = 0; y < dh; y++) {
+                        CHECK_MSG(0 == full[y * dw], "sigma %d %ux%u x%u left edge row %d: %d", sigma, sw, sh, scale, y, full[y * dw]);
+                    }
+
+                    memset(src, 0, sw * sh * sizeof(int16_t));
+                    for (int y = 0; y < sh; y++) {
+                        src[y * sw] = 3000;
+                    }
+                    idwGauss(src, sw, sh, scale, full);
+                    for (int y = 0; y < dh; y++) {
+                        CHECK_MSG(0 == full[y * dw + dw - 1], "sigma %d %ux%u x%u right edge row %d: %d", sigma, sw, sh, scale, y, full[y * dw + dw - 1]);
+                    }
+                }
+            }
+        }
+    }
+    printf("max error against double Gaussian on -40~300C images %.3f\n", maxErr);
+
+    // 无效的 Sigma 不改变设置 超过最大宽度时不写入
+    idwGaussSetSigma(GAUSS_SIGMA_0_5);
+    idwGaussSetSigma(GAUSS_SIGMA_COUNT);
+    fixture_smooth_image(src, 16, 12, 1);
+    idwGauss(src, 16, 12, 2, full);
+    CHECK(fabs(full[5 * 32 + 7] - ref_pixel(src, 16, 12, 2, GAUSS_SIGMA_0_5, 7, 5)) <= 1.0);
+
+    memset(full, 0x5A, sizeof(full));
+    idwGauss(src, IDW_GAUSS_MAX_WIDTH + 1, 2, 1, full);
+    CHECK(full[0] == 0x5A5A);
+
+    return host_test_result("test_gauss");
+}
@@ -0,0 +1,156 @@
+#include "IDW.h"
+#include "host_test.h"
+#include "interp_fixture.h"
+#include <string.h>
+
+// 线性插值模式 分段计算的 idwLinearRows 与按分配方法直接做除法的结果
+// 以及原来逐像素做除法的 idwOldInterpolate 逐位比较
+
+#define MAX_DEST (320 * 240)
+#define FILL_VALUE ((int16_t)0x5A5A) // 原来的实现在部分尺寸下有不写入的像素 先填固定值
+
+static const struct
+{
+    uint16_t srcWidth;
+    uint16_t srcHeight;
+    uint16_t scale;
+} sizes[] = {
+    { 32, 24, 10 }, // 线性插值模式 不缩放
+    { 16, 12, 20 }, // 数字变焦 2x
+    { 8, 6, 40 }, // 数字变焦 4x
+    { 32, 24, 1 },
+    { 32, 24, 5 },
+    { 64, 48, 5 },
+    { 5, 3, 9 },
+    { 3, 40, 7 },
+    { 2, 2, 7 },
+};
+
+// 按 idwLinearInit 注释中的分配方法 直接用除法计算 不使用分段表
+static void spec_interpolate(const int16_t* pSrc, uint16_t srcWidth, uint16_t srcHeight, uint16_t scale, int16_t* pDest)
+{
+    const uint16_t destWidth = srcWidth * scale;
+    static int16_t rows[IDW_LINEAR_MAX_SRC][IDW_LINEAR_MAX_WIDTH];
+    uint16_t keyRow[IDW_LINEAR_MAX_SRC];
+
+    // 水平 srcWidth * scale 列分给 srcWidth - 1 段
+    for (uint16_t h = 0; h < srcHeight; h++) {
+        uint16_t x = 0;
+
+        for (uint16_t w = 0; w < srcWidth - 1; w++) {
+            const int32_t n = scale + scale / (srcWidth - 1) + (w < scale % (srcWidth - 1));
+            const int16_t a = pSrc[h * srcWidth + w], b = pSrc[h * srcWidth + w + 1];
+
+            for (int32_t s = 0; s < n; s++) {
+                rows[h][x++] = (a * (n - s) + b * s) / n;
+            }
+        }
+        CHECK(x == destWidth);
+    }
+
+    // 垂直 第一行到最后一行之间 srcHeight * scale - 1 行分给 srcHeight - 1 段
+    keyRow[0] = 0;
+    for (uint16_t h = 0; h < srcHeight - 1; h++) {
+        keyRow[h + 1] = keyRow[h] + scale + (scale - 1) / (srcHeight - 1) + (h < (scale - 1) % (srcHeight - 1));
+    }
+    CHECK(keyRow[srcHeight - 1] == srcHeight * scale - 1);
+
+    for (uint16_t h = 0; h < srcHeight - 1; h++) {
+        const int32_t n = keyRow[h + 1] - keyRow[h];
+
+        for (int32_t s = 0; s <= n; s++) {
+            int16_t* pOut = pDest + (keyRow[h] + s) * destWidth;
+
+            for (uint16_t x = 0; x < destWidth; x++) {
+                pOut[x] = rows[h][x] * (n - s) / n + rows[h + 1][x] * s / n;
+            }
+        }
+    }
+}
+
+// 原来的实现只在每段分到的列数 行数不超过 scale + 1 时写满整幅图像
+static int legacy_fills_frame(uint16_t srcWidth, uint16_t srcHeight, uint16_t scale)
+{
+    return scale <= srcWidth - 1 && scale <= srcHeight;
+}
+
+static void fill(int16_t* p, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        p[i] = FILL_VALUE;
+    }
+}
+
+int main(void)
+{
+    static int16_t src[64 * 48];
+    static int16_t legacy[MAX_DEST];
+    static int16_t spec[MAX_DEST];
+    static int16_t rows[MAX_DEST];
+    static int16_t band[MAX_DEST];
+    static uint16_t frame[MAX_DEST];
+    sIdwLinear linear;
+    sPaletteMap map;
+
+    CHECK(0 == palette_setMap(&map, Rainbow, -200, 800));
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        const uint16_t sw = sizes[s].srcWidth, sh = sizes[s].srcHeight, scale = sizes[s].scale;
+        const uint16_t dw = sw * scale, dh = sh * scale;
+        const uint32_t count = (uint32_t)dw * dh;
+
+        CHECK(0 == idwLinearInit(&linear, sw, sh, scale));
+
+        for (uint32_t seed = 1; seed <= 6; seed++) {
+            // 平滑图像 常用温度范围的随机值 全范围的随机值
+            if (seed <= 2) {
+                fixture_smooth_image(src, sw, sh, seed);
+            } else if (seed <= 4) {
+                fixture_random_image(src, sw, sh, seed, -400, 3000);
+            } else {
+                fixture_random_image(src, sw, sh, seed, INT16_MIN, INT16_MAX);
+            }
+
+            fill(legacy, count);
+            fixture_legacy_old_interpolate(src, sw, sh, scale, legacy);
+
+            spec_interpolate(src, sw, sh, scale, spec);
+            idwLinearRows(&linear, src, rows, 0, dh);
+            CHECK_MSG(0 == memcmp(spec, rows, count * sizeof(int16_t)), "%ux%u x%u seed %u: idwLinearRows", sw, sh, scale, seed);
+            if (legacy_fills_frame(sw, sh, scale)) {
+                CHECK_MSG(0 == memcmp(legacy, rows, count * sizeof(int16_t)), "%ux%u x%u seed %u: idwLinearRows legacy", sw, sh, scale, seed);
+            }
+
+            // 分段计算和整幅计算完全相同 段的起点可以在两个源行之间
+            for (uint16_t start = 0; start < dh;) {
+                uint16_t end = start + 1 + (start * 5 + seed) % 31;
+
+                if (end > dh) {
+                    end = dh;
+                }
+                idwLinearRows(&linear, src, band, start, end);
+                CHECK_MSG(0 == memcmp(band, rows + start * dw, (end - start) * dw * sizeof(int16_t)), "%ux%u x%u rows %u~%u", sw, sh, scale, start, end);
+                start = end;
+            }
+
+            // 伪彩色输出 = 插值结果查表 水平镜像
+            idwLinearPaletteRows(&linear, src, frame, &map, 0, dh);
+            for (uint32_t y = 0, bad = 0; y < dh && !bad; y++) {
+                for (uint32_t x = 0; x < dw && !bad; x++) {
+                    bad = frame[y * dw + dw - 1 - x] != palette_color(&map, rows[y * dw + x]);
+                    CHECK_MSG(!bad, "%ux%u x%u palette (%u, %u)", sw, sh, scale, x, y);
+                }
+            }
+        }
+    }
+
+    // 参数错误
+    CHECK(-1 == idwLinearInit(&linear, 1, 24, 10));
+    CHECK(-1 == idwLinearInit(&linear, 32, 1, 10));
+    CHECK(-1 == idwLinearInit(&linear, IDW_LINEAR_MAX_SRC + 1, 24, 1));
+    CHECK(-1 == idwLinearInit(&linear, 32, 24, 0));
+    CHECK(-1 == idwLinearInit(&linear, 32, 24, IDW_LINEAR_MAX_WIDTH / 32 + 1));
+    CHECK(-1 == idwLinearInit(&linear, 2, 2, 130)); // 每段超过 127 列
+
+    return host_test_result("test_linear");
+}
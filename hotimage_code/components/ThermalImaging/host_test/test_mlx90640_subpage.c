@@ -0,0 +1,80 @@
+#include "host_test.h"
+#include "mlx90640_fixture.h"
+#include <math.h>
+
+// 每个子页只计算该子页更新的 384 个像素 与原版按图案筛选的像素一致 两个子页合起来覆盖全部像素
+
+typedef void (*tCalcFunc)(uint16_t* frameData, const paramsMLX90640* params, const MLX90640_FrameContext* ctx, float* result);
+
+static const struct
+{
+    const char* name;
+    tCalcFunc func;
+} calcFuncs[] = {
+    { "CalculateTo", MLX90640_CalculateTo },
+    { "CalculateToFast", MLX90640_CalculateToFast },
+    { "GetImage", MLX90640_GetImage },
+};
+
+/**
+ * @brief 原版的子页判断
+ *
+ * @param pixelNumber
+ * @param mode
+ * @return int
+ */
+static int legacySubPage(int pixelNumber, uint8_t mode)
+{
+    int ilPattern = pixelNumber / 32 - (pixelNumber / 64) * 2;
+    int chessPattern = ilPattern ^ (pixelNumber - (pixelNumber / 2) * 2);
+
+    return mode == 0 ? ilPattern : chessPattern;
+}
+
+int main(void)
+{
+    static paramsMLX90640 params;
+    uint16_t frameData[834];
+    MLX90640_FrameContext ctx;
+    float result[768];
+
+    fixture_params(&params);
+
+    for (int mode = 0; mode < 2; mode++) {
+        for (size_t f = 0; f < sizeof(calcFuncs) / sizeof(calcFuncs[0]); f++) {
+            uint8_t covered[768] = { 0 };
+
+            for (int subPage = 0; subPage < 2; subPage++) {
+                sFixtureFrame cond = { mode ? FIXTURE_MODE_CHESS : FIXTURE_MODE_INTERLEAVED, subPage, 25.0f, 3.3f, 1.0f, 0.95f, 17.0f };
+                int count = 0;
+
+                fixture_frame(&params, &cond, frameData);
+                fixture_context(&params, &cond, frameData, &ctx);
+                CHECK(ctx.subPage == subPage);
+                CHECK(ctx.mode == cond.mode);
+
+                for (int i = 0; i < 768; i++) {
+                    result[i] = NAN;
+                }
+                calcFuncs[f].func(frameData, &params, &ctx, result);
+
+                for (int i = 0; i < 768; i++) {
+                    int written = !isnan(result[i]);
+
+                    CHECK_MSG(written == (legacySubPage(i, cond.mode) == subPage), "%s mode %d subpage %d pixel %d", calcFuncs[f].name, mode, subPage, i);
+                    if (written) {
+                        count++;
+                        covered[i]++;
+                    }
+                }
+                CHECK_MSG(count == 384, "%s mode %d subpage %d: %d pixels", calcFuncs[f].name, mode, subPage, count);
+            }
+
+            for (int i = 0; i < 768; i++) {
+                CHECK_MSG(covered[i] == 1, "%s mode %d pixel %d written %d times", calcFuncs[f].name, mode, i, covered[i]);
+            }
+        }
+    }
+
+    return host_test_result("test_mlx90640_subpage");
+}
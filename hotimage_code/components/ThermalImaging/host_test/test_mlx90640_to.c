@@ -0,0 +1,100 @@
+#include "host_test.h"
+#include "mlx90640_fixture.h"
+#include <math.h>
+
+// MLX90640_CalculateTo / MLX90640_CalculateToFast 与原版 Melexis 算法比较
+// 分别以 CONFIG_MLX90640_TO_KERNEL_FLOAT 和 CONFIG_MLX90640_TO_KERNEL_DOUBLE 编译
+
+#define FAST_MAX_ERROR 0.01f // CalculateToFast 相对原版的误差
+#define REF_MAX_ERROR 0.001f // CalculateTo 与原版只是计算顺序不同
+#define TARGET_MAX_ERROR 0.5f // 只用来检查测试数据本身 数据按原版的第二次计算反算, 原版第二次计算的分段由第一次的估计值决定, 高温段相差约 0.4℃
+
+static const sFixtureFrame conditions[] = {
+    { FIXTURE_MODE_CHESS, 0, 25.0f, 3.30f, 1.00f, 0.95f, 17.0f },
+    { FIXTURE_MODE_CHESS, 1, 25.0f, 3.30f, 1.00f, 0.95f, 17.0f },
+    { FIXTURE_MODE_INTERLEAVED, 0, 25.0f, 3.30f, 1.00f, 0.95f, 17.0f },
+    { FIXTURE_MODE_INTERLEAVED, 1, 25.0f, 3.30f, 1.00f, 0.95f, 17.0f },
+    { FIXTURE_MODE_CHESS, 0, 45.0f, 3.25f, 1.03f, 0.70f, 37.0f },
+    { FIXTURE_MODE_CHESS, 1, -10.0f, 3.35f, 0.97f, 1.00f, -18.0f },
+    { FIXTURE_MODE_INTERLEAVED, 0, 60.0f, 3.28f, 1.01f, 0.50f, 20.0f },
+    { FIXTURE_MODE_INTERLEAVED, 1, 5.0f, 3.32f, 0.99f, 0.85f, -3.0f },
+};
+
+// 原版算法在第一个工况 (棋盘模式 子页 0) 下的结果 测试数据或原版算法改变时才需要更新
+static const struct
+{
+    uint16_t pixel;
+    float to;
+} golden[] = {
+    { 0, -39.9630f },
+    { 33, 17.2140f },
+    { 101, 217.4413f },
+    { 390, 47.7475f },
+    { 501, 54.4265f },
+    { 767, 257.2563f },
+};
+
+int main(void)
+{
+    static paramsMLX90640 params;
+    uint16_t frameData[834];
+    MLX90640_FrameContext ctx;
+    float legacy[768];
+    float ref[768];
+    float fast[768];
+    float maxFastErr = 0;
+    float maxRefErr = 0;
+    float minTo = 1000;
+    float maxTo = -1000;
+
+    fixture_params(&params);
+
+    for (size_t c = 0; c < sizeof(conditions) / sizeof(conditions[0]); c++) {
+        const sFixtureFrame* cond = &conditions[c];
+        int count = 0;
+
+        fixture_frame(&params, cond, frameData);
+        fixture_context(&params, cond, frameData, &ctx);
+        CHECK(fabsf(ctx.ta - cond->ta) < 0.05f);
+        CHECK(fabsf(ctx.vdd - cond->vdd) < 0.001f);
+
+        for (int i = 0; i < 768; i++) {
+            legacy[i] = ref[i] = fast[i] = NAN;
+        }
+        fixture_legacy_calculate_to(frameData, &params, cond->emissivity, cond->tr, legacy);
+        MLX90640_CalculateTo(frameData, &params, &ctx, ref);
+        MLX90640_CalculateToFast(frameData, &params, &ctx, fast);
+
+        for (int i = 0; i < 768; i++) {
+            if (isnan(legacy[i])) {
+                continue;
+            }
+            count++;
+
+            CHECK_MSG(fabsf(legacy[i] - fixture_target(i)) < TARGET_MAX_ERROR, "cond %zu pixel %d: %f target %f", c, i, legacy[i], fixture_target(i));
+            CHECK_MSG(fabsf(ref[i] - legacy[i]) < REF_MAX_ERROR, "cond %zu pixel %d: %f legacy %f", c, i, ref[i], legacy[i]);
+            CHECK_MSG(fabsf(fast[i] - legacy[i]) < FAST_MAX_ERROR, "cond %zu pixel %d: %f legacy %f", c, i, fast[i], legacy[i]);
+
+            maxRefErr = fmaxf(maxRefErr, fabsf(ref[i] - legacy[i]));
+            maxFastErr = fmaxf(maxFastErr, fabsf(fast[i] - legacy[i]));
+            minTo = fminf(minTo, legacy[i]);
+            maxTo = fmaxf(maxTo, legacy[i]);
+        }
+        CHECK(count == 384);
+
+        if (c == 0) {
+            for (size_t g = 0; g < sizeof(golden) / sizeof(golden[0]); g++) {
+                float to = legacy[golden[g].pixel];
+                CHECK_MSG(fabsf(to - golden[g].to) < 0.0005f, "golden pixel %u: %.4f expected %.4f", golden[g].pixel, to, golden[g].to);
+            }
+        }
+    }
+
+    // 测试数据需要覆盖 -40~300℃
+    CHECK(minTo < -39.5f);
+    CHECK(maxTo > 299.5f);
+
+    printf("To range %.2f ~ %.2f, max error CalculateTo %.6f, CalculateToFast %.6f\n", minTo, maxTo, maxRefErr, maxFastErr);
+
+    return host_test_result("test_mlx90640_to");
+}
@@ -0,0 +1,126 @@
+#include "dispcolor.h"
+#include "host_test.h"
+#include "palette.h"
+
+// 查表伪彩色只生成一次 值 -> 下标 的定点比例覆盖整个查表 超出范围取两端的颜色
+// 直方图均衡的映射 均匀的图像接近线性 大面积背景分到更多颜色
+
+static const struct
+{
+    int16_t minValue;
+    int16_t maxValue;
+} ranges[] = {
+    { 200, 350 }, // 20~35℃ (放大 10 倍)
+    { -400, 3000 }, // 传感器的全部范围
+    { 0, 1 },
+    { 0, 1023 },
+    { 0, 1024 },
+    { -32768, -1 },
+    { 0, 32767 },
+    { 500, 500 }, // 最大 = 最小 按范围 1 处理
+};
+
+int main(void)
+{
+    static tRGBcolor colors[PALETTE_LUT_SIZE];
+    const uint16_t* luts[COLOR_MAX];
+    sPaletteMap map;
+
+    // 每种伪彩色第一次调用时生成 之后返回同一个表 内容是 getPalette 的颜色 高字节在前
+    for (int p = 0; p < COLOR_MAX; p++) {
+        luts[p] = palette_getLut(p);
+        CHECK(NULL != luts[p]);
+        CHECK(luts[p] == palette_getLut(p));
+        for (int q = 0; q < p; q++) {
+            CHECK(luts[p] != luts[q]);
+        }
+
+        getPalette(p, PALETTE_LUT_SIZE, colors);
+        for (int i = 0, bad = 0; i < PALETTE_LUT_SIZE && !bad; i++) {
+            uint16_t color = RGB565(colors[i].r, colors[i].g, colors[i].b);
+
+            bad = luts[p][i] != (uint16_t)((color >> 8) | (color << 8));
+            CHECK_MSG(!bad, "palette %d color %d", p, i);
+        }
+    }
+    CHECK(luts[Iron] == palette_getLut(COLOR_MAX)); // 无效的类型用 Iron
+
+    for (int p = 0; p < COLOR_MAX; p++) {
+        for (size_t r = 0; r < sizeof(ranges) / sizeof(ranges[0]); r++) {
+            const int32_t minValue = ranges[r].minValue, maxValue = ranges[r].maxValue;
+            const int32_t range = maxValue > minValue ? maxValue - minValue : 1;
+            int32_t lastIdx = 0;
+
+            CHECK(0 == palette_setMap(&map, p, minValue, maxValue));
+            CHECK(map.pLut == luts[p]);
+
+            // 两端和超出范围
+            CHECK(palette_color(&map, minValue) == luts[p][0]);
+            CHECK_MSG(palette_color(&map, minValue + range) == luts[p][PALETTE_LUT_SIZE - 1], "palette %d %d~%d max", p, minValue, maxValue);
+            CHECK(palette_color(&map, minValue - 1) == luts[p][0]);
+            CHECK(palette_color(&map, INT16_MIN) == luts[p][0]);
+            CHECK(palette_color(&map, minValue + range + 1) == luts[p][PALETTE_LUT_SIZE - 1]);
+            CHECK(palette_color(&map, INT16_MAX) == luts[p][PALETTE_LUT_SIZE - 1]);
+
+            // 下标随值单调增加 和精确的比例相差不超过 1 个颜色
+            for (int32_t v = minValue, bad = 0; v <= minValue + range && !bad; v++) {
+                int32_t idx = ((v - map.offset) * map.scale) >> PALETTE_INDEX_SHIFT;
+                int32_t exact = (v - minValue) * (PALETTE_LUT_SIZE - 1) / range;
+
+                bad = idx < lastIdx || idx > PALETTE_LUT_SIZE - 1 || idx < exact || idx > exact + 1 || palette_color(&map, v) != luts[p][idx];
+                CHECK_MSG(!bad, "palette %d %d~%d value %d index %d exact %d", p, minValue, maxValue, v, idx, exact);
+                lastIdx = idx;
+            }
+        }
+    }
+
+    // 直方图均衡
+    {
+        static int16_t image[32 * 24];
+        static uint16_t eqLut[PALETTE_EQ_LUT_SIZE];
+        sPaletteMap linearMap;
+
+        CHECK(-1 == palette_setEqualizedMap(&map, eqLut, Iron, 0, 1000, image, 32, 0, 24));
+        CHECK(-1 == palette_setEqualizedMap(&map, eqLut, Iron, 0, 1000, image, 32, 32, 0));
+
+        // 每格的像素数相同 累计分布是直线 均衡后的查表就是均匀取样的原查表
+        for (int i = 0; i < 32 * 24; i++) {
+            image[i] = (i % PALETTE_HIST_BINS) * 1024 / PALETTE_HIST_BINS;
+        }
+        CHECK(0 == palette_setEqualizedMap(&map, eqLut, Rainbow, 0, 1023, image, 32, 32, 24));
+        CHECK(map.pLut == eqLut);
+        for (int j = 0; j < PALETTE_EQ_LUT_SIZE; j++) {
+            int idx = (j * 2 + 1) * (PALETTE_LUT_SIZE - 1) / (PALETTE_EQ_LUT_SIZE * 2);
+            int near = 0;
+
+            for (int k = idx - 1; k <= idx + 1; k++) {
+                near |= k >= 0 && k < PALETTE_LUT_SIZE && eqLut[j] == luts[Rainbow][k];
+            }
+            CHECK_MSG(near, "uniform eq color %d", j);
+        }
+        CHECK(palette_color(&map, -100) == eqLut[0]);
+        CHECK(palette_color(&map, 2000) == eqLut[PALETTE_EQ_LUT_SIZE - 1]);
+
+        // 95% 的背景 20~30℃ 一个 300℃ 的小目标: 线性映射时背景只用到伪彩色最前面的一小段
+        // 比较背景最亮的颜色在伪彩色中的位置 均衡后的颜色按第一个相同的颜色找回下标
+        for (int i = 0; i < 32 * 24; i++) {
+            image[i] = (i % 20 == 0) ? 3000 : 200 + (i * 7) % 101;
+        }
+        CHECK(0 == palette_setMap(&linearMap, Iron, 200, 3000));
+        CHECK(0 == palette_setEqualizedMap(&map, eqLut, Iron, 200, 3000, image, 32, 32, 24));
+        {
+            const int32_t linearIdx = ((300 - linearMap.offset) * linearMap.scale) >> PALETTE_INDEX_SHIFT;
+            const uint16_t color = palette_color(&map, 300);
+            int eqIdx = 0;
+
+            while (eqIdx < PALETTE_LUT_SIZE - 1 && luts[Iron][eqIdx] != color) {
+                eqIdx++;
+            }
+            printf("background top color: linear %d, equalized %d of %d\n", linearIdx, eqIdx, PALETTE_LUT_SIZE);
+            CHECK_MSG(eqIdx > linearIdx * 4, "background top color eq %d linear %d", eqIdx, linearIdx);
+        }
+        CHECK(palette_color(&map, 3000) == eqLut[PALETTE_EQ_LUT_SIZE - 1]);
+    }
+
+    return host_test_result("test_palette");
+}
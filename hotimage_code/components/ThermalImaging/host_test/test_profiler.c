@@ -0,0 +1,118 @@
+#include "host_test.h"
+#include "esp_timer.h"
+#include "profiler.h"
+#include <stdlib.h>
+#include <string.h>
+
+// 用假时钟驱动 profiler 检查各阶段的 最小 平均 p99 最大 耗时
+
+static int64_t fakeUs;
+
+static int64_t fakeClock(void)
+{
+    return fakeUs;
+}
+
+/**
+ * @brief 清零并记录样本 耗时由假时钟经过 PROFILER_BEGIN/PROFILER_END 产生
+ *
+ * @param stage
+ * @param us
+ * @param count
+ */
+static void recordSamples(eProfilerStage stage, uint32_t us, int count)
+{
+    for (int i = 0; i < count; i++) {
+        PROFILER_BEGIN(stage);
+        fakeUs += us;
+        PROFILER_END(stage);
+    }
+}
+
+static void testBeginEnd(void)
+{
+    sProfilerStats stats;
+
+    recordSamples(PROF_TO_CALC, 1500, 1);
+    profiler_get_stats(PROF_TO_CALC, &stats);
+    CHECK(1 == stats.count);
+    CHECK(1500 == stats.minUs && 1500 == stats.avgUs && 1500 == stats.maxUs && 1500 == stats.p99Us);
+
+    // 没有样本的阶段全部为 0
+    profiler_get_stats(PROF_OVERLAY, &stats);
+    CHECK(0 == stats.count && 0 == stats.maxUs && 0 == stats.p99Us);
+
+    // 计时跨过 32 位回绕
+    fakeUs = 0xffffff00;
+    recordSamples(PROF_I2C_READ, 0x200, 1);
+    profiler_get_stats(PROF_I2C_READ, &stats);
+    CHECK(1 == stats.count && 0x200 == stats.maxUs);
+}
+
+static void testDistribution(void)
+{
+    sProfilerStats stats;
+
+    // 1% 的样本很慢 p99 仍在快样本的直方图格内
+    recordSamples(PROF_INTERP, 100, 990);
+    recordSamples(PROF_INTERP, 5000, 10);
+    profiler_get_stats(PROF_INTERP, &stats);
+    CHECK(1000 == stats.count);
+    CHECK(100 == stats.minUs && 5000 == stats.maxUs);
+    CHECK((990 * 100 + 10 * 5000) / 1000 == stats.avgUs);
+    CHECK_MSG(stats.p99Us >= 100 && stats.p99Us <= 125, "p99 %u", stats.p99Us);
+
+    // 再多一个慢样本 p99 落到慢样本 不超过最大值
+    recordSamples(PROF_INTERP, 5000, 1);
+    profiler_get_stats(PROF_INTERP, &stats);
+    CHECK_MSG(stats.p99Us >= 4000 && stats.p99Us <= 5000, "p99 %u", stats.p99Us);
+
+    // 直方图分辨率 1/4 倍频程: p99 是样本所在格的上限
+    for (uint32_t us = 1; us < 4000000; us = us * 9 / 8 + 1) {
+        profiler_reset();
+        recordSamples(PROF_PALETTE, us, 99);
+        recordSamples(PROF_PALETTE, us * 10, 1);
+        profiler_get_stats(PROF_PALETTE, &stats);
+        CHECK(100 == stats.count);
+        CHECK_MSG(stats.p99Us >= us && stats.p99Us <= us + us / 4, "us %u p99 %u", us, stats.p99Us);
+    }
+}
+
+static void testReset(void)
+{
+    sProfilerStats stats;
+
+    recordSamples(PROF_SPI_FLUSH, 300, 5);
+    profiler_reset();
+
+    // 清零由写者在下次记录时执行
+    profiler_get_stats(PROF_SPI_FLUSH, &stats);
+    CHECK(5 == stats.count);
+
+    recordSamples(PROF_SPI_FLUSH, 700, 1);
+    profiler_get_stats(PROF_SPI_FLUSH, &stats);
+    CHECK(1 == stats.count && 700 == stats.minUs && 700 == stats.maxUs);
+}
+
+static void testDefaultClock(void)
+{
+    profiler_set_clock(NULL);
+    CHECK(llabs((int64_t)profiler_now() - (int64_t)(uint32_t)esp_timer_get_time()) < 100000);
+    profiler_set_clock(fakeClock);
+}
+
+int main(void)
+{
+    profiler_set_clock(fakeClock);
+
+    testBeginEnd();
+    testDistribution();
+    testReset();
+    testDefaultClock();
+
+    CHECK(0 == strcmp("to calc", profiler_stage_name(PROF_TO_CALC)));
+    CHECK(0 == strcmp("?", profiler_stage_name(PROF_STAGE_COUNT)));
+    profiler_dump();
+
+    return host_test_result("test_profiler");
+}
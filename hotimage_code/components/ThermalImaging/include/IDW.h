@@ -1,14 +1,87 @@
 #ifndef __IDW_H
 #define __IDW_H
 
+#include "palette.h"
 #include <math.h>
 #include <stdint.h>
 #include <stdlib.h>
 
-void idwBilinear(const float* pSrcGaussBuf, uint8_t src_gauss_width, uint8_t src_gauss_height, int16_t* pDest, uint16_t dest_width, uint16_t dest_height, uint8_t upScaleFactor);
-void idwOldInterpolate(int16_t* pSrcImage, uint16_t srcWidth, uint16_t srcHeight, uint16_t scale, int16_t* pHDImageOut);
+// 高斯模糊 Sigma
+typedef enum {
+    GAUSS_SIGMA_0_5 = 0,
+    GAUSS_SIGMA_1_0,
+    GAUSS_SIGMA_2_0,
+    GAUSS_SIGMA_COUNT
+} eGaussSigma;
 
-void idwGauss(int16_t* pSrc, uint16_t w, uint16_t h, uint16_t scale, float* pDest);
-// void idwGaussInt(int16_t* pSrc, uint16_t w, uint16_t h, uint16_t scale, float* pDest);
+#define IDW_GAUSS_MAX_WIDTH 64 // 高斯模糊输入最大宽度 每行的临时数据放在栈上
+
+#define IDW_LINEAR_MAX_WIDTH 320 // 线性插值输出最大宽度 每列的增量计算状态放在栈上
+#define IDW_LINEAR_MAX_SRC 64 // 分段线性插值 源图像最大宽度 高度
+
+// 分段线性插值表 (线性插值模式) 可以按输出行分段计算
+typedef struct
+{
+    uint16_t srcWidth;
+    uint16_t srcHeight;
+    uint16_t scale;
+    uint8_t colCount[IDW_LINEAR_MAX_SRC]; // 每两个相邻源像素之间的输出列数 (包含左边的源像素)
+    uint16_t keyRow[IDW_LINEAR_MAX_SRC]; // 每个源行所在的输出行
+} sIdwLinear;
+
+// 定点双线性缩放 权重 Q8
+#define IDW_SCALER_SHIFT 8
+#define IDW_SCALER_ONE (1 << IDW_SCALER_SHIFT)
+#define IDW_SCALER_MAX_SRC 128 // 源图像最大宽度 每行的临时数据放在栈上
+
+// 定点双线性缩放表 源坐标和权重按列 按行预先计算
+typedef struct
+{
+    uint16_t srcWidth;
+    uint16_t srcHeight;
+    uint16_t destWidth;
+    uint16_t destHeight;
+    uint16_t* pXIdx; // 每列的左边源像素
+    uint16_t* pXWeight; // 每列右边源像素的权重 Q8
+    uint16_t* pYIdx; // 每行的上边源像素行
+    uint16_t* pYWeight; // 每行下边源像素行的权重 Q8
+} sIdwScaler;
+
+// 定点双三次 (Catmull-Rom) 整数倍放大 权重 Q12
+#define IDW_BICUBIC_SHIFT 12
+#define IDW_BICUBIC_ONE (1 << IDW_BICUBIC_SHIFT)
+#define IDW_BICUBIC_MAX_SCALE 40 // 最大放大倍数 (数字变焦 4x 时 40 倍)
+
+// 输出像素在源像素内的一个相位
+typedef struct
+{
+    uint8_t offset; // 4 个源像素中的第一个 相对本源像素 -2 的偏移
+    int16_t weight[4]; // 4 个源像素的权重 Q12
+} sIdwBicubicPhase;
+
+// 双三次插值权重表 每个相位 4 个权重
+typedef struct
+{
+    uint16_t srcWidth;
+    uint16_t srcHeight;
+    uint16_t scale;
+    sIdwBicubicPhase phase[IDW_BICUBIC_MAX_SCALE];
+} sIdwBicubic;
+
+int idwScalerInit(sIdwScaler* pScaler, uint16_t srcWidth, uint16_t srcHeight, uint16_t destWidth, uint16_t destHeight);
+void idwScalerFree(sIdwScaler* pScaler);
+void idwScaleRows(const sIdwScaler* pScaler, const int16_t* pSrc, int16_t* pDest, uint16_t rowStart, uint16_t rowEnd);
+void idwScalePaletteRows(const sIdwScaler* pScaler, const int16_t* pSrc, uint16_t* pFrame, const sPaletteMap* pMap, uint16_t rowStart, uint16_t rowEnd);
+int idwLinearInit(sIdwLinear* pLinear, uint16_t srcWidth, uint16_t srcHeight, uint16_t scale);
+void idwLinearRows(const sIdwLinear* pLinear, const int16_t* pSrc, int16_t* pDest, uint16_t rowStart, uint16_t rowEnd);
+void idwLinearPaletteRows(const sIdwLinear* pLinear, const int16_t* pSrc, uint16_t* pFrame, const sPaletteMap* pMap, uint16_t rowStart, uint16_t rowEnd);
+
+int idwBicubicInit(sIdwBicubic* pBicubic, uint16_t srcWidth, uint16_t srcHeight, uint16_t scale);
+void idwBicubicRows(const sIdwBicubic* pBicubic, const int16_t* pSrc, int16_t* pDest, uint16_t rowStart, uint16_t rowEnd);
+void idwBicubicPaletteRows(const sIdwBicubic* pBicubic, const int16_t* pSrc, uint16_t* pFrame, const sPaletteMap* pMap, uint16_t rowStart, uint16_t rowEnd);
+
+void idwGaussSetSigma(eGaussSigma sigma);
+void idwGauss(const int16_t* pSrc, uint16_t w, uint16_t h, uint16_t scale, int16_t* pDest);
+void idwGaussRows(const int16_t* pSrc, uint16_t w, uint16_t h, uint16_t scale, int16_t* pDest, uint16_t rowStart, uint16_t rowEnd);
 
 #endif
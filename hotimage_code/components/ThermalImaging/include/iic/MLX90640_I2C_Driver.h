@@ -3,7 +3,25 @@
 
 #include <stdint.h>
 
+// 写寄存器的校验策略
+typedef enum {
+    MLX90640_WRITE_VERIFY = 0, // 写入后读回校验 用于配置寄存器
+    MLX90640_WRITE_NO_VERIFY = 1, // 只写不校验 用于状态寄存器应答等高频写入
+} eMLX90640WritePolicy;
+
+// I2C 调用计数
+typedef struct
+{
+    uint32_t reads; // 读调用次数 (不含写入校验的读回)
+    uint32_t writes; // 写调用次数
+    uint32_t verifyReads; // 写入校验的读回次数
+    uint32_t verifySkipped; // 跳过校验的写入次数
+} sMLX90640I2CStats;
+
 int MLX90640_I2CRead(uint8_t slaveAddr, uint16_t startAddress, uint16_t nMemAddressRead, uint16_t* data);
+int MLX90640_I2CReadRaw(uint8_t slaveAddr, uint16_t startAddress, uint16_t nMemAddressRead, uint16_t* data);
 int MLX90640_I2CWrite(uint8_t slaveAddr, uint16_t writeAddress, uint16_t data);
+int MLX90640_I2CWritePolicy(uint8_t slaveAddr, uint16_t writeAddress, uint16_t data, eMLX90640WritePolicy policy);
+void MLX90640_I2CGetStats(sMLX90640I2CStats* stats);
 
 #endif
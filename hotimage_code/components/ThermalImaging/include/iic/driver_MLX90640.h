@@ -21,6 +21,19 @@
 
 #define SCALEALPHA 0.000001
 
+// 读取帧数据中的像素值 MLX90640_GetFrameData 读取的像素数据保持传感器的大端字节序 计算时才转换
+#define MLX90640_PIXEL(frameData, i) ((uint16_t)(((frameData)[i] << 8) | ((frameData)[i] >> 8)))
+
+// 预计算的单像素校准数据 由 MLX90640_ExtractParameters 生成, 供 MLX90640_CalculateToFast 使用
+typedef struct
+{
+    float kta; // kta / 2^ktaScale
+    float kv; // kv / 2^kvScale
+    float alpha; // SCALEALPHA * 2^alphaScale / alpha 未做KsTa补偿的 alphaCompensated
+    int16_t offset; // 像素偏移
+    uint8_t ilChessIdx; // ilPattern * 3 + conversionPattern + 1, 用于查表 il/chess 修正值
+} MLX90640_PixelCalib;
+
 typedef struct
 {
     int16_t kVdd;
@@ -50,21 +63,49 @@ typedef struct
     float ilChessC[3];
     uint16_t brokenPixels[5];
     uint16_t outlierPixels[5];
+
+    // 以下为根据上面的参数预计算的数据 不写入参数缓存
+    float alphaCorrR[4]; // 各温度段的 alpha 修正
+    float ksTo1Kelvin; // 1 - ksTo[1] * 273.15
+    MLX90640_PixelCalib calib[768]; // 每个像素的校准表
 } paramsMLX90640;
 
+// 每个子页计算一次的帧参数 由 MLX90640_UpdateFrameContext / MLX90640_UpdateFrameTaTr 计算
+typedef struct
+{
+    float vdd; // 供电电压 V
+    float ta; // 外壳温度 ℃
+    float gain; // 增益补偿
+    float irDataCP[2]; // 补偿像素(已做偏移和温漂修正, 未乘 tgc)
+    uint8_t mode; // 0=交错模式 0x80=棋盘模式
+    uint8_t subPage; // 当前子页
+    float emissivity; // 计算 taTr 时的辐射率
+    float tr; // 计算 taTr 时的反射温度
+    float taTrTa; // 计算 taTr 时的外壳温度
+    float taTr; // tr^4 - (tr^4 - ta^4) / emissivity
+} MLX90640_FrameContext;
+
 void MLX90640_Init();
 uint16_t MLX90640_getEEPROMSize();
 uint16_t MLX90640_getFrameSize();
 
 int MLX90640_DumpEE(uint8_t slaveAddr, uint16_t* eeData);
+int MLX90640_GetDeviceID(uint8_t slaveAddr, uint16_t* deviceID);
 int MLX90640_SynchFrame(uint8_t slaveAddr);
+void MLX90640_SetSubPagePeriod(uint32_t periodUs);
+uint16_t MLX90640_GetLastPollCount(void);
+int64_t MLX90640_GetLastReadyTime(void);
 int MLX90640_TriggerMeasurement(uint8_t slaveAddr);
 int MLX90640_GetFrameData(uint8_t slaveAddr, uint16_t* frameData);
 int MLX90640_ExtractParameters(uint16_t* eeData, paramsMLX90640* mlx90640);
+void MLX90640_BuildCalibTable(paramsMLX90640* mlx90640);
 float MLX90640_GetVdd(uint16_t* frameData, const paramsMLX90640* params);
 float MLX90640_GetTa(uint16_t* frameData, const paramsMLX90640* params);
-void MLX90640_GetImage(uint16_t* frameData, const paramsMLX90640* params, float* result);
-void MLX90640_CalculateTo(uint16_t* frameData, const paramsMLX90640* params, float emissivity, float tr, float* result);
+void MLX90640_UpdateFrameContext(uint16_t* frameData, const paramsMLX90640* params, MLX90640_FrameContext* ctx);
+void MLX90640_UpdateFrameTaTr(MLX90640_FrameContext* ctx, float emissivity, float tr);
+void MLX90640_GetImage(uint16_t* frameData, const paramsMLX90640* params, const MLX90640_FrameContext* ctx, float* result);
+void MLX90640_CalculateTo(uint16_t* frameData, const paramsMLX90640* params, const MLX90640_FrameContext* ctx, float* result);
+void MLX90640_CalculateToFast(uint16_t* frameData, const paramsMLX90640* params, const MLX90640_FrameContext* ctx, float* result);
 int MLX90640_SetResolution(uint8_t slaveAddr, uint8_t resolution);
 int MLX90640_GetCurResolution(uint8_t slaveAddr);
 int MLX90640_SetRefreshRate(uint8_t slaveAddr, uint8_t refreshRate);
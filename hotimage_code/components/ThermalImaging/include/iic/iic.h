@@ -19,6 +19,21 @@
 #define ACK_VAL (i2c_ack_type_t)0 /*!< I2C ack value */
 #define NACK_VAL (i2c_ack_type_t)1 /*!< I2C nack value */
 
+// 总线仲裁优先级
+typedef enum {
+    I2C_BUS_PRIO_HIGH = 0, // 实时传输 例如 MLX90640 帧数据 不等待低优先级传输
+    I2C_BUS_PRIO_LOW = 1, // 后台传输 例如 SHT31 温湿度 只在空闲窗口内进行
+} eI2CBusPriority;
+
+// 总线仲裁计数
+typedef struct
+{
+    uint32_t high; // 高优先级传输次数
+    uint32_t low; // 低优先级传输次数
+    uint32_t lowInWindow; // 在空闲窗口内完成的低优先级传输次数
+    uint32_t lowDeadlineMiss; // 截止时间内没有等到空闲窗口 被放弃的低优先级传输次数
+} sI2CBusStats;
+
 /**
  * @brief 初始化IIC设备
  *
@@ -31,6 +46,37 @@ void I2CInit(int sda_io_num, int scl_io_num, uint32_t freqHZ, i2c_mode_t mode);
  */
 void i2c_master_scan(void);
 
+/**
+ * @brief 获取总线使用权 一次传输(可以包含多次读写)开始前调用 结束后调用 i2c_bus_release
+ *        高优先级传输不会等待低优先级传输排队, 低优先级传输只在空闲窗口内 且剩余时间足够时进行
+ *
+ * @param prio 优先级
+ * @param costUs 预计占用总线的时间 只对低优先级有效
+ * @param ticks_to_wait 截止时间 低优先级超过截止时间后放弃 返回 ESP_ERR_TIMEOUT
+ * @return esp_err_t
+ */
+esp_err_t i2c_bus_acquire(eI2CBusPriority prio, uint32_t costUs, TickType_t ticks_to_wait);
+
+/**
+ * @brief 释放总线使用权
+ *
+ */
+void i2c_bus_release(void);
+
+/**
+ * @brief 高优先级设备通知总线在 endUs 之前空闲
+ *
+ * @param endUs 窗口结束时间 esp_timer_get_time() 时间
+ */
+void i2c_bus_open_idle_window(int64_t endUs);
+
+/**
+ * @brief 获取总线仲裁计数
+ *
+ * @param stats
+ */
+void i2c_bus_get_stats(sI2CBusStats* stats);
+
 /**
  * @brief 总线上所有支持的地址将得到复位
  *        要支持此命令的设备才有效：目前已知设备 sht31
@@ -126,4 +172,28 @@ esp_err_t i2c_master_write_slave(i2c_port_t i2c_num, uint8_t slave_addr, uint8_t
  */
 esp_err_t i2c_master_write_slave_reg(i2c_port_t i2c_num, uint8_t slave_addr, uint8_t reg_addr, uint8_t* data_wr, size_t size, TickType_t ticks_to_wait);
 
+/**
+ * @brief  I2Cx-写从设备的寄存器值（寄存器地址 或 命令 为2字节的器件）
+ *      - 适用于 MLX90640 这种寄存器地址为16位的I2C设备
+ *
+ * @param  i2c_num I2C端口号。I2C_NUM_0 / I2C_NUM_1
+ * @param  slave_addr I2C写从机的器件地址
+ * @param  reg_addr I2C写从机的寄存器地址(2byte)
+ * @param  data_wr 写入的值的指针，存放写入进的数据
+ * @param  size 写入的字节数
+ * @param  ticks_to_wait 超时等待时间
+ *
+ * @return
+ *     - esp_err_t
+ */
+esp_err_t i2c_master_write_slave_reg_16bit(i2c_port_t i2c_num, uint8_t slave_addr, uint16_t reg_addr, uint8_t* data_wr, size_t size, TickType_t ticks_to_wait);
+
+/**
+ * @brief 返回命令链接没有使用静态缓存 改为从堆中分配的次数 正常情况下应一直为0
+ *        只统计命令链接 不包括 IIC 驱动内部的内存分配
+ *
+ * @return uint32_t
+ */
+uint32_t i2c_get_cmd_link_heap_fallbacks(void);
+
 #endif /* _IIC_H_ */
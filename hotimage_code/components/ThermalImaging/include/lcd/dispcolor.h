@@ -76,6 +76,8 @@ uint16_t dispcolor_GetPixel(int16_t x, int16_t y);
 void dispcolor_FillScreen(uint16_t color);
 //该过程从帧缓冲区更新显示
 void dispcolor_Update(void);
+// 从帧缓冲区更新显示 整屏刷新时不等待发送完成
+void dispcolor_UpdateAsync(void);
 //例程在显示器上画一条直线
 void dispcolor_DrawLine(int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint16_t color);
 //例程在显示器上绘制一个矩形
@@ -102,6 +104,10 @@ int16_t dispcolor_getFormatStrWidth(uint8_t FontID, const char *args, ...);
 void dispcolor_screenDark(void);
 // 复制显存数据到指定内存
 void dispcolor_getScreenData(uint16_t *pBuff);
+// 显存地址 像素是液晶的字节序 直接显示模式返回 NULL
+uint16_t* dispcolor_getBuffer(void);
+// 标记显存中被直接写入的矩形
+void dispcolor_markDirty(int16_t x, int16_t y, int16_t w, int16_t h);
 
 
 #endif
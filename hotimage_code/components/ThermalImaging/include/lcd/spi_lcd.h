@@ -727,6 +727,32 @@ void lcd_cmd(spi_device_handle_t spi, const uint8_t cmd);
  */
 void lcd_data(spi_device_handle_t spi, const uint8_t* data, int len);
 
+/**
+ * @brief  向LCD异步发送长度为len个字节的数据（D/C线电平为1） 加入SPI事务队列后立即返回
+ *       - 不获取 pSPIMutex 由调用者在排队前获取 lcd_data_queue_finish 之后释放
+ *       - 排队期间不能调用 lcd_cmd / lcd_data
+ *
+ * @param  spi LCD与SPI关联的句柄，通过此来调用SPI总线上的LCD设备
+ * @param  t 传输结构体 传输完成前不能修改
+ * @param  data 要发送数据的指针 传输完成前不能修改
+ * @param  len 发送的字节数
+ *
+ * @return
+ *     - none
+ */
+void lcd_data_queue(spi_device_handle_t spi, spi_transaction_t* t, const uint8_t* data, int len);
+
+/**
+ * @brief  等待异步发送的数据全部完成
+ *
+ * @param  spi LCD与SPI关联的句柄，通过此来调用SPI总线上的LCD设备
+ * @param  count lcd_data_queue 排队的传输个数
+ *
+ * @return
+ *     - none
+ */
+void lcd_data_queue_finish(spi_device_handle_t spi, int count);
+
 /**
  * @brief  向LCD发送单点16Bit的像素数据，（根据驱动IC的不同，可能为2或3个字节，需要转换RGB565、RGB666）
  *       - ili9488\ili9481 这类IC，SPI总线仅能使用RGB666-18Bit/像素，分3字节传输。而不能使用16Bit/像素，分2字节传输。（0x3A寄存器）
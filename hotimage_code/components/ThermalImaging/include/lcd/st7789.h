@@ -32,14 +32,26 @@ void st7789_DrawPixel(int16_t x, int16_t y, uint16_t color);
 void st7789_FillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
 
 #if (ST7789_MODE == ST7789_BUFFER_MODE)
-// 该过程从帧缓冲区更新显示
+// 该过程从帧缓冲区更新显示 只发送有变化的区域
 void st7789_update(void);
 
+// 标记显存中被直接写入的矩形
+void st7789_markDirty(int16_t x, int16_t y, int16_t w, int16_t h);
+
+// 异步刷新 整屏刷新时复制到行缓存排队发送 显存复制完后返回
+void st7789_updateAsync(void);
+
+// 等待异步刷新全部完成
+void st7789_waitFlush(void);
+
 // 复制显存数据到指定内存
 void st7789_getScreenData(uint16_t *pBuff);
 
 // 该过程返回一个像素的颜色
 uint16_t st7789_GetPixel(int16_t x, int16_t y);
+
+// 显存地址 像素按液晶的字节序(高字节在前)存放
+uint16_t* st7789_getBuffer(void);
 #endif
 
 
@@ -10,8 +10,55 @@ typedef struct
 	uint8_t b;
 } tRGBcolor;
 
+// 查表用的伪彩色 每种固定 PALETTE_LUT_SIZE 个颜色 RGB565 显存字节序 只生成一次
+#define PALETTE_LUT_SIZE 1024
+#define PALETTE_INDEX_SHIFT 16 // 值 -> 下标 的比例 Q16
+
+// 直方图均衡 每帧统计直方图 生成 值 -> 伪彩色 的非线性查表
+#define PALETTE_HIST_BINS 64 // 直方图的格数
+#define PALETTE_HIST_PLATEAU 10 // 每格最多计入平均值的几倍 (平台均衡) 避免大面积的背景占用太多颜色
+#define PALETTE_EQ_LUT_SIZE (PALETTE_HIST_BINS * 4) // 均衡后查表的颜色个数 每格 4 个
+
+// 温度值(放大 TEMP_SCALE 倍的整数) -> 伪彩色 的映射 每帧只需要重新计算比例
+typedef struct
+{
+	const uint16_t *pLut; // PALETTE_LUT_SIZE 个颜色 RGB565 显存字节序
+	int16_t offset; // 下标 0 对应的值 (最小温度)
+	int16_t range; // 下标 PALETTE_LUT_SIZE - 1 对应 offset + range
+	int32_t scale; // (PALETTE_LUT_SIZE - 1) / range Q16 向上取整
+} sPaletteMap;
+
 // 将指针返回到所选类型的伪彩色点数组
 void getPalette(eColorScale palette, uint16_t steps, tRGBcolor *pBuff);
 
+// 所选类型的查表伪彩色 第一次调用时生成 返回 NULL=内存不足
+const uint16_t *palette_getLut(eColorScale palette);
+
+// 设置映射的伪彩色和值的范围
+int palette_setMap(sPaletteMap *pMap, eColorScale palette, int16_t minValue, int16_t maxValue);
+
+// 按图像的直方图设置均衡后的映射
+int palette_setEqualizedMap(sPaletteMap *pMap, uint16_t *pEqLut, eColorScale palette, int16_t minValue, int16_t maxValue,
+	const int16_t *pImage, uint16_t stride, uint16_t width, uint16_t height);
+
+/**
+ * @brief 值 -> 伪彩色 超出范围的取两端的颜色
+ *
+ * @param pMap
+ * @param value
+ * @return uint16_t RGB565 显存字节序
+ */
+static inline uint16_t palette_color(const sPaletteMap *pMap, int32_t value)
+{
+	value -= pMap->offset;
+	if (value < 0) {
+		value = 0;
+	} else if (value > pMap->range) {
+		value = pMap->range;
+	}
+
+	return pMap->pLut[(value * pMap->scale) >> PALETTE_INDEX_SHIFT];
+}
+
 
 #endif /* MAIN_PALETTE_PALETTE_H_ */
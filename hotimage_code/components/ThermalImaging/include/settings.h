@@ -51,6 +51,11 @@ typedef enum {
     Brightness_Minus, // 减小背光
     Save_90640Params, // 保存 90640 参数表
     PausePlay, // 暂停\播放
+    Zoom_Next, // 数字变焦 1x 2x 4x
+    Zoom_PanX, // 变焦视口向右移动
+    Zoom_PanY, // 变焦视口向下移动
+    Zoom_PanXBack, // 变焦视口向左移动
+    Zoom_PanYBack, // 变焦视口向上移动
 } eButtonFunc;
 
 // 图像插值算法
@@ -58,8 +63,23 @@ typedef enum {
     ORIGINAL = 0, // 原始 不插值
     LINEAR, // 线性插值
     HQ3X_2X, // 高斯模糊 双线性插值
+    BICUBIC, // 双三次插值 (Catmull-Rom)
 } eScaleMode;
 
+// 低延迟显示模式
+typedef enum {
+    LOWLATENCY_OFF = 0, // 两个子页都读取后才刷新显示
+    LOWLATENCY_ON, // 每个子页读取后立即刷新显示
+    LOWLATENCY_DEINTERLACE, // 每个子页刷新显示 运动区域用新子页插值 减少梳状条纹
+} eLowLatencyMode;
+
+// 自动缩放模式
+typedef enum {
+    AUTOSCALE_OFF = 0, // 使用设置的最大 最小温度
+    AUTOSCALE_LINEAR, // 按画面的温度范围线性映射
+    AUTOSCALE_HISTOGRAM, // 按画面的温度直方图均衡 小的高温目标不会占用整个伪彩色
+} eAutoScaleMode;
+
 // 伪彩色类型
 typedef enum {
     Iron = 0,
@@ -77,7 +97,7 @@ typedef struct
     eScaleMode ScaleMode; // 插值算法
     uint8_t MLX90640FPS; // 刷新率
     uint8_t Resolution; // AD分辨率
-    uint8_t AutoScaleMode; // 自动缩放模式
+    eAutoScaleMode AutoScaleMode; // 自动缩放模式
     float minTempNew; // 最小温度
     float maxTempNew; // 最大温度
     uint8_t TempMarkers; // 显示最大 最小温度标记
@@ -86,6 +106,7 @@ typedef struct
     eButtonFunc FuncUp; // 按钮Up 类型
     eButtonFunc FuncCenter; // 按钮Center 类型
     eButtonFunc FuncDown; // 按钮Down 类型
+    eLowLatencyMode LowLatency; // 低延迟显示模式
 } structSettingsParms;
 
 extern structSettingsParms settingsParms;
@@ -1,6 +1,7 @@
 #ifndef _MLX90640_TASK_H_
 #define _MLX90640_TASK_H_
 
+#include "MLX90640_I2C_Driver.h"
 #include "esp_system.h"
 #include "settings.h"
 
@@ -17,6 +18,8 @@ typedef struct
 	int8_t minT_Y;
 	int8_t maxT_X; // 最大温度 坐标
 	int8_t maxT_Y;
+
+	int64_t readyUs; // 本帧新数据中最早的子页就绪时间 用于统计显示延迟
 } sMlxData;
 
 // MLX90640 最大最小温度
@@ -29,8 +32,17 @@ extern const int FPS_RATES_COUNT;
 extern const int RESOLUTION[];
 extern const int RESOLUTION_COUNT;
 
-extern sMlxData* pMlxData;
+// 获取最新一帧的完整副本 不会读到正在写入的数据 返回 0=成功 1=还没有帧
+uint8_t mlx90640_getFrame(sMlxData* pBuff, uint32_t* pFrameNo);
+
+// render_task 处理完一帧后调用 用于统计丢帧
+void mlx90640_frameConsumed(uint32_t frameNo);
 
+// 没有被 render_task 处理就被覆盖的帧数
+uint32_t mlx90640_getDroppedFrames(void);
+
+// 读者因为数据被覆盖而重新复制的次数
+uint32_t mlx90640_getReadRetries(void);
 
 // 该过程将温度矩阵复制到 pBuff 缓冲区
 void GetThermoData(float *pBuff);
@@ -42,4 +54,19 @@ void mlx90640_task(void* arg);
 
 uint8_t setMLX90640IsPause(uint8_t isPause);
 
+// 上一帧查询状态寄存器的次数
+uint16_t mlx90640_getPollsPerFrame(void);
+
+// 读取子页返回 -8 (读取太慢 数据已被覆盖) 的次数
+uint32_t mlx90640_getFrameErrorCount(void);
+
+// 读取子页返回 -10 (等待数据就绪超时) 的次数
+uint32_t mlx90640_getFrameTimeoutCount(void);
+
+// 读取子页返回 -1 (传感器未应答) 的次数
+uint32_t mlx90640_getFrameNackCount(void);
+
+// 上一帧的 I2C 调用计数 verifySkipped 即省掉的读回次数
+void mlx90640_getI2CStatsPerFrame(sMLX90640I2CStats* stats);
+
 #endif /* _MLX90640_TASK_H_ */
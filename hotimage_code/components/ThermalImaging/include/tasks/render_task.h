@@ -9,8 +9,7 @@ extern EventGroupHandle_t* pHandleEventGroup;
 extern SemaphoreHandle_t pSPIMutex;
 
 typedef enum _render_type {
-    RENDER_MLX90640_NO0 = 1 << 0, // 第0帧
-    RENDER_MLX90640_NO1 = 1 << 1, // 第1帧
+    RENDER_MLX90640_FRAME = 1 << 0, // MLX90640 发布了新的一帧
     RENDER_ShortPress_Up = 1 << 2, // Up按钮
     RENDER_Hold_Up = 1 << 3, // Up按钮长按
     RENDER_ShortPress_Center = 1 << 4, // Center按钮
@@ -23,4 +22,16 @@ void render_task(void* arg);
 
 void tips_printf(const char* args, ...);
 
+// 上个统计周期的显示延迟(子页数据就绪到刷新到液晶屏) 和显示刷新率
+void render_getLatency(uint32_t* pAvgUs, uint32_t* pMaxUs, float* pFps);
+
+// 自动缩放 更新的帧数 和 重新缩放伪彩色的次数
+void render_getAutoRangeStats(uint32_t* pFrames, uint32_t* pRescales);
+
+// 数字变焦 1x -> 2x -> 4x -> 1x
+void render_zoomNext(void);
+
+// 移动变焦视口 按显示方向 dx 1=向右 dy 1=向下
+void render_zoomPan(int8_t dx, int8_t dy);
+
 #endif /* MAIN_TASK_UI_H_ */
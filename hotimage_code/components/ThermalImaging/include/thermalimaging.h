@@ -40,6 +40,9 @@
 
 // tools
 #include "SAFiter.h"
+#include "autorange.h"
+#include "profiler.h"
 #include "tools.h"
+#include "workpool.h"
 
 #endif // _THERMALIMAGING_H
\ No newline at end of file
@@ -0,0 +1,34 @@
+#ifndef _AUTORANGE_H_
+#define _AUTORANGE_H_
+
+#include "sdkconfig.h"
+#include <stdint.h>
+
+// 自动缩放的参数
+typedef struct
+{
+    float attack; // 范围向外扩展时 每帧跟上目标的比例 0~1
+    float release; // 范围向内收缩时 每帧跟上目标的比例 0~1
+    float deadband; // 平滑后的范围和当前使用的范围相差超过这个温度才重新缩放
+    uint8_t percentile; // 0=用最小最大温度 1~10=用 n% 和 (100-n)% 分位数 去掉两端的异常点
+} sAutoRangeConfig;
+
+// 自动缩放控制器 每帧输入画面的温度范围 输出伪彩色使用的范围
+typedef struct
+{
+    sAutoRangeConfig cfg;
+    uint8_t valid; // 0=下次更新直接使用输入的范围
+    float smoothMin; // 平滑后的范围
+    float smoothMax;
+    float outMin; // 当前使用的范围
+    float outMax;
+    uint32_t frames; // 更新的帧数
+    uint32_t rescales; // 重新缩放的次数
+} sAutoRange;
+
+void autorange_init(sAutoRange* pRange, const sAutoRangeConfig* pConfig);
+void autorange_reset(sAutoRange* pRange);
+uint8_t autorange_update(sAutoRange* pRange, float minT, float maxT);
+void autorange_percentile(const float* pImage, uint16_t stride, uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint8_t percentile, float* pMin, float* pMax);
+
+#endif /* _AUTORANGE_H_ */
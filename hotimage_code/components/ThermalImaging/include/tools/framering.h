@@ -0,0 +1,40 @@
+#ifndef _FRAMERING_H_
+#define _FRAMERING_H_
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// 帧环形缓存 单生产者 多消费者
+// 每个槽有一个序号(seqlock) 写入期间为奇数 写完为偶数, 读者复制数据前后序号相同且为偶数 说明复制的数据完整
+// 生产者总是写最新帧的下一个槽 读者只读最新帧 复制耗时小于 (FRAMERING_SLOTS - 1) 帧时不会重试
+#define FRAMERING_SLOTS 3
+
+typedef struct
+{
+    uint8_t* pData; // FRAMERING_SLOTS 个槽 每个 slotSize 字节
+    size_t slotSize;
+    atomic_uint seq[FRAMERING_SLOTS]; // 槽序号 奇数=正在写入
+    atomic_uint publishedFrameNo; // 最新发布的帧号 0=还没有帧 帧号 n 存放在槽 n % FRAMERING_SLOTS
+    atomic_uint consumedFrameNo; // 主要消费者最后处理的帧号
+    atomic_uint droppedFrames; // 没有被主要消费者处理就被覆盖的帧数
+    atomic_uint readRetries; // 读者因为数据被覆盖而重新复制的次数
+} sFrameRing;
+
+// 分配槽 pRing 须已清零 (静态变量) 返回 0=成功
+int framering_init(sFrameRing* pRing, size_t slotSize);
+
+// 生产者 开始写入下一帧 返回要写入的槽 写完调用 framering_publish
+void* framering_writeBegin(sFrameRing* pRing);
+void framering_publish(sFrameRing* pRing);
+
+// 读取最新一帧的一部分 保证数据完整 不阻塞生产者 返回 0=成功 1=还没有帧
+uint8_t framering_read(sFrameRing* pRing, void* pBuff, size_t offset, size_t size, uint32_t* pFrameNo);
+
+// 主要消费者处理完一帧后调用 用于统计丢帧
+void framering_consumed(sFrameRing* pRing, uint32_t frameNo);
+
+uint32_t framering_getDroppedFrames(sFrameRing* pRing);
+uint32_t framering_getReadRetries(sFrameRing* pRing);
+
+#endif /* _FRAMERING_H_ */
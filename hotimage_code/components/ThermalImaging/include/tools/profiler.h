@@ -0,0 +1,86 @@
+#ifndef _PROFILER_H_
+#define _PROFILER_H_
+
+#include "sdkconfig.h"
+#include <stdint.h>
+
+// 帧处理流水线的各个阶段
+typedef enum {
+    PROF_I2C_READ = 0, // 读取子页RAM (不含等待数据就绪)
+    PROF_TO_CALC, // 计算像素温度
+    PROF_BAD_PIXEL, // 坏点修复
+    PROF_MIN_MAX, // 搜索最大最小温度
+    PROF_INTERP, // 插值
+    PROF_PALETTE, // 伪彩色映射
+    PROF_OVERLAY, // 标记 标题 比例尺等叠加内容绘制
+    PROF_SPI_FLUSH, // 显存刷新到液晶屏
+    PROF_STAGE_COUNT
+} eProfilerStage;
+
+// 某个阶段在统计周期内的耗时
+typedef struct
+{
+    uint32_t count; // 样本数
+    uint32_t minUs; // 最小耗时
+    uint32_t avgUs; // 平均耗时
+    uint32_t p99Us; // 99% 的样本不超过这个耗时 (直方图分辨率 1/4 倍频程)
+    uint32_t maxUs; // 最大耗时
+} sProfilerStats;
+
+// 计时源 返回微秒 默认 esp_timer_get_time (两个核心共用 任务换核心不影响计时)
+typedef int64_t (*profiler_clock_t)(void);
+
+#ifdef CONFIG_THERMAL_PROFILER
+
+// 当前所在核心 并行渲染按核心分别累加耗时
+// 主机测试可以在包含本文件之前定义 PROFILER_CORE_ID() 替换
+#ifndef PROFILER_CORE_ID
+#include <freertos/FreeRTOS.h>
+#define PROFILER_CORE_ID() xPortGetCoreID()
+#endif
+
+typedef struct
+{
+    uint32_t us; // 开始时间
+} sProfilerMark;
+
+// 替换计时源 NULL=恢复默认 主机测试用假时钟驱动统计
+void profiler_set_clock(profiler_clock_t clock);
+uint32_t profiler_now(void);
+
+static inline sProfilerMark profiler_mark(void)
+{
+    sProfilerMark mark = { profiler_now() };
+    return mark;
+}
+
+// 每个阶段只能由一个任务记录 读取统计和请求清零可以在任意任务
+void profiler_record(eProfilerStage stage, uint32_t us);
+void profiler_end(eProfilerStage stage, const sProfilerMark* pMark);
+void profiler_get_stats(eProfilerStage stage, sProfilerStats* pStats);
+void profiler_reset(void);
+void profiler_dump(void);
+const char* profiler_stage_name(eProfilerStage stage);
+
+// 在一段代码前后使用 同一个作用域内每个阶段只能 BEGIN 一次
+#define PROFILER_BEGIN(stage) const sProfilerMark _prof_##stage = profiler_mark()
+#define PROFILER_END(stage) profiler_end((stage), &_prof_##stage)
+// 一个阶段分成几段计时的 累加耗时后一次记录
+#define PROFILER_NOW() profiler_now()
+#define PROFILER_RECORD(stage, us) profiler_record((stage), (us))
+
+#else
+
+#define PROFILER_BEGIN(stage) \
+    do {                      \
+    } while (0)
+#define PROFILER_END(stage) \
+    do {                    \
+    } while (0)
+#define PROFILER_RECORD(stage, us) \
+    do {                           \
+    } while (0)
+
+#endif // CONFIG_THERMAL_PROFILER
+
+#endif /* _PROFILER_H_ */
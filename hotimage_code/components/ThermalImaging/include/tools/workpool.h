@@ -0,0 +1,18 @@
+#ifndef _WORKPOOL_H_
+#define _WORKPOOL_H_
+
+#include <stdint.h>
+
+// 工作线程个数 调用者自己也处理一段 一共分成 WORKPOOL_WORKERS + 1 段
+#define WORKPOOL_WORKERS 1
+
+/**
+ * @brief 分段处理函数 处理 [start, end) 范围
+ *
+ */
+typedef void (*workpool_func_t)(void* arg, int start, int end);
+
+int workpool_init(void);
+void workpool_parallel_for(int count, workpool_func_t func, void* arg);
+
+#endif /* _WORKPOOL_H_ */
@@ -155,6 +155,26 @@ static void shortPressButtonHandler(eButtonFunc btnSetup)
         uint8_t last = setMLX90640IsPause(true);
         setMLX90640IsPause((last + 1) & 1);
     } break;
+
+    case Zoom_Next:
+        render_zoomNext();
+        break;
+
+    case Zoom_PanX:
+        render_zoomPan(1, 0);
+        break;
+
+    case Zoom_PanY:
+        render_zoomPan(0, 1);
+        break;
+
+    case Zoom_PanXBack:
+        render_zoomPan(-1, 0);
+        break;
+
+    case Zoom_PanYBack:
+        render_zoomPan(0, -1);
+        break;
     }
 }
 
@@ -1,6 +1,11 @@
 #include "MLX90640_I2C_Driver.h"
 #include "iic.h"
 #include <stdio.h>
+#include <string.h>
+
+static sMLX90640I2CStats i2cStats; // I2C 调用计数
+
+#define MLX90640_I2C_TIMEOUT (1000 / portTICK_RATE_MS)
 
 #if 0
 /**
@@ -51,7 +56,7 @@ static int MLX90640_I2CReadBytes(uint8_t slaveAddr, uint16_t startAddress, uint1
 int MLX90640_I2CRead(uint8_t slaveAddr, uint16_t startAddress, uint16_t nMemAddressRead, uint16_t* data)
 {
 #if 1
-    esp_err_t ret = i2c_master_read_slave_reg_16bit(I2C_NUM, slaveAddr, startAddress, (uint8_t*)data, nMemAddressRead << 1, 1000 / portTICK_RATE_MS);
+    esp_err_t ret = MLX90640_I2CReadRaw(slaveAddr, startAddress, nMemAddressRead, data);
     if (ret == ESP_OK) {
         uint16_t d;
         for (int i = 0; i < nMemAddressRead; i++) {
@@ -78,7 +83,29 @@ int MLX90640_I2CRead(uint8_t slaveAddr, uint16_t startAddress, uint16_t nMemAddr
 }
 
 /**
- * @brief 2 字节字的写函数 i2c ESP32
+ * @brief 读取2字节字数组的函数 不转换字节序 数据保持传感器的大端字节序
+ *
+ * @param slaveAddr 设备地址
+ * @param startAddress 寄存器地址
+ * @param nMemAddressRead 读取大小
+ * @param data 读取内存指针
+ * @return int
+ */
+int MLX90640_I2CReadRaw(uint8_t slaveAddr, uint16_t startAddress, uint16_t nMemAddressRead, uint16_t* data)
+{
+    // 帧数据读取为高优先级 不等待其它设备
+    esp_err_t ret = i2c_bus_acquire(I2C_BUS_PRIO_HIGH, 0, MLX90640_I2C_TIMEOUT);
+    if (ret != ESP_OK)
+        return ret;
+
+    i2cStats.reads++;
+    ret = i2c_master_read_slave_reg_16bit(I2C_NUM, slaveAddr, startAddress, (uint8_t*)data, nMemAddressRead << 1, MLX90640_I2C_TIMEOUT);
+    i2c_bus_release();
+    return ret;
+}
+
+/**
+ * @brief 2 字节字的写函数 i2c ESP32 写入后读回校验
  *
  * @param slaveAddr
  * @param writeAddress
@@ -87,29 +114,62 @@ int MLX90640_I2CRead(uint8_t slaveAddr, uint16_t startAddress, uint16_t nMemAddr
  */
 int MLX90640_I2CWrite(uint8_t slaveAddr, uint16_t writeAddress, uint16_t data)
 {
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+    return MLX90640_I2CWritePolicy(slaveAddr, writeAddress, data, MLX90640_WRITE_VERIFY);
+}
 
-    // 首先，我们选择传感器的内部地址
-    i2c_master_start(cmd);
-    i2c_master_write_byte(cmd, (slaveAddr << 1) | WRITE_BIT, ACK_CHECK_EN);
+/**
+ * @brief 2 字节字的写函数 按策略决定是否读回校验
+ *
+ * @param slaveAddr
+ * @param writeAddress
+ * @param data
+ * @param policy MLX90640_WRITE_VERIFY=读回校验 MLX90640_WRITE_NO_VERIFY=只写
+ * @return int 0=成功 -2=校验失败 其它为I2C错误
+ */
+int MLX90640_I2CWritePolicy(uint8_t slaveAddr, uint16_t writeAddress, uint16_t data, eMLX90640WritePolicy policy)
+{
+    uint8_t buff[2];
+    uint16_t dataCheck;
 
-    i2c_master_write_byte(cmd, writeAddress >> 8, ACK_CHECK_EN);
-    i2c_master_write_byte(cmd, writeAddress & 0xFF, ACK_CHECK_EN);
+    esp_err_t ret = i2c_bus_acquire(I2C_BUS_PRIO_HIGH, 0, MLX90640_I2C_TIMEOUT);
+    if (ret != ESP_OK)
+        return ret;
 
-    // 数据
-    i2c_master_write_byte(cmd, data >> 8, ACK_CHECK_EN);
-    i2c_master_write_byte(cmd, data & 0xFF, ACK_CHECK_EN);
-    i2c_master_stop(cmd);
+    i2cStats.writes++;
+    buff[0] = data >> 8;
+    buff[1] = data & 0xFF;
+    ret = i2c_master_write_slave_reg_16bit(I2C_NUM, slaveAddr, writeAddress, buff, 2, MLX90640_I2C_TIMEOUT);
+    if (ret != ESP_OK) {
+        i2c_bus_release();
+        return ret;
+    }
 
-    esp_err_t ret = i2c_master_cmd_begin(I2C_NUM, cmd, 1000 / portTICK_RATE_MS);
-    i2c_cmd_link_delete(cmd);
+    if (policy == MLX90640_WRITE_NO_VERIFY) {
+        i2c_bus_release();
+        i2cStats.verifySkipped++;
+        return 0;
+    }
 
     // 通过读取检查记录
-    static uint16_t dataCheck;
-    MLX90640_I2CRead(slaveAddr, writeAddress, 1, &dataCheck);
+    i2cStats.verifyReads++;
+    ret = i2c_master_read_slave_reg_16bit(I2C_NUM, slaveAddr, writeAddress, (uint8_t*)&dataCheck, 2, MLX90640_I2C_TIMEOUT);
+    i2c_bus_release();
+    if (ret != ESP_OK)
+        return ret;
+    dataCheck = (dataCheck << 8) | (dataCheck >> 8);
 
     if (dataCheck != data)
         return -2;
 
-    return ret;
+    return 0;
+}
+
+/**
+ * @brief 获取 I2C 调用计数
+ *
+ * @param stats
+ */
+void MLX90640_I2CGetStats(sMLX90640I2CStats* stats)
+{
+    memcpy(stats, &i2cStats, sizeof(sMLX90640I2CStats));
 }
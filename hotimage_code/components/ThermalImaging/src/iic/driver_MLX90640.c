@@ -15,10 +15,21 @@
  *
  */
 #include "iic.h"
+#include "esp_rom_sys.h"
+#include "profiler.h"
+#include "esp_timer.h"
 #include <MLX90640_I2C_Driver.h>
 #include <driver_MLX90640.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
 #include <math.h>
 
+#define POLL_BACKOFF_MIN_US 200 // 查询状态寄存器的最小间隔
+#define POLL_TICK_US (portTICK_PERIOD_MS * 1000) // 系统节拍
+#define POLL_TIMEOUT_US 100000 // 超出子页周期多久后放弃等待
+#define IDLE_WINDOW_GUARD_US 2000 // 空闲窗口在下一子页就绪前提前结束的时间
+#define READY_GUARD_US 1000 // 在预计就绪时刻之前多久醒来开始查询 也是允许的就绪时刻偏差
+
 void ExtractVDDParameters(uint16_t* eeData, paramsMLX90640* mlx90640);
 void ExtractPTATParameters(uint16_t* eeData, paramsMLX90640* mlx90640);
 void ExtractGainParameters(uint16_t* eeData, paramsMLX90640* mlx90640);
@@ -38,6 +49,67 @@ float GetMedian(float* values, int n);
 int IsPixelBad(uint16_t pixel, paramsMLX90640* params);
 int ValidateFrameData(uint16_t* frameData);
 int ValidateAuxData(uint16_t* auxData);
+static float CalcTa(uint16_t* frameData, const paramsMLX90640* params, float vdd);
+static int WaitDataReady(uint8_t slaveAddr, uint16_t* statusRegister);
+
+// 采集调度 根据子页周期休眠到数据即将就绪时再查询状态寄存器
+// 预计就绪时刻每个子页加一个周期 不使用读取完成的时间 读取耗时和调度抖动不会累积, 只有错过就绪时刻时才重新同步
+static uint32_t subPagePeriodUs = 0; // 子页周期 0=未设置
+static int64_t expectedReadyUs = 0; // 预计下一子页就绪的时间 0=未同步
+static int64_t lastReadyUs = 0; // 上一子页就绪的时间
+static uint16_t lastPollCount = 0; // 上次等待时查询状态寄存器的次数
+
+// 控制寄存器缓存 只在写入控制寄存器后重新读取
+static uint16_t controlRegister = 0;
+static uint8_t controlRegisterValid = 0;
+
+static uint16_t subPagePixels[2][2][384]; // 每个子页包含的像素序号 [0=交错模式 1=棋盘模式][子页]
+
+#if defined(CONFIG_MLX90640_TO_KERNEL_FLOAT)
+static float invRoot4Seed[64]; // x^(-1/4) 的初值表 [指数低2位][尾数高4位]
+
+/**
+ * @brief 单精度四次方根 x^(1/4)
+ *        查表得到 x^(-1/4) 初值(相对误差 < 1%), 两次牛顿迭代 r = r * (5 - x * r^4) / 4, 再由 x * r^3 得到结果
+ *        相对误差 < 7e-7 (由 host_test/test_fast_root4.c 验证), 非正数/非规格化数/无穷大退回 sqrtf
+ *
+ * @param x
+ * @return float
+ */
+static inline float FastRoot4(float x)
+{
+    union {
+        float f;
+        uint32_t u;
+    } v, scale;
+    int32_t e;
+    float r;
+    float r2;
+
+    v.f = x;
+    e = (int32_t)((v.u >> 23) & 0xff) - 127;
+    if (x <= 0 || e == -127 || e == 128) {
+        return sqrtf(sqrtf(x));
+    }
+
+    // x = 2^(4q + n) * m  =>  x^(-1/4) = 2^(-q) * (2^n * m)^(-1/4)
+    scale.u = (uint32_t)(127 - (e >> 2)) << 23;
+    r = invRoot4Seed[((e & 3) << 4) | ((v.u >> 19) & 0x0f)] * scale.f;
+
+    r2 = r * r;
+    r = r * (5 - x * r2 * r2) * 0.25f;
+    r2 = r * r;
+    r = r * (5 - x * r2 * r2) * 0.25f;
+
+    return x * r * r * r;
+}
+
+#define MLX90640_ROOT4(x) FastRoot4(x)
+#define MLX90640_KELVIN 273.15f
+#else
+#define MLX90640_ROOT4(x) sqrt(sqrt(x))
+#define MLX90640_KELVIN 273.15
+#endif
 
 /**
  * @brief 初始化IIC
@@ -79,6 +151,18 @@ int MLX90640_DumpEE(uint8_t slaveAddr, uint16_t* eeData)
     return MLX90640_I2CRead(slaveAddr, 0x2400, MLX90640_getEEPROMSize(), eeData);
 }
 
+/**
+ * @brief 读取传感器ID(EEPROM 0x2407~0x2409) 用于判断传感器是否更换
+ *
+ * @param slaveAddr
+ * @param deviceID 3个字
+ * @return int
+ */
+int MLX90640_GetDeviceID(uint8_t slaveAddr, uint16_t* deviceID)
+{
+    return MLX90640_I2CRead(slaveAddr, 0x2407, 3, deviceID);
+}
+
 /**
  * @brief 等待新数据可用
  *
@@ -87,26 +171,146 @@ int MLX90640_DumpEE(uint8_t slaveAddr, uint16_t* eeData)
  */
 int MLX90640_SynchFrame(uint8_t slaveAddr)
 {
-    uint16_t dataReady = 0;
     uint16_t statusRegister;
     int error = 1;
 
-    error = MLX90640_I2CWrite(slaveAddr, 0x8000, 0x0030);
+    error = MLX90640_I2CWritePolicy(slaveAddr, 0x8000, 0x0030, MLX90640_WRITE_NO_VERIFY);
     if (error == -1) {
         return error;
     }
 
-    while (dataReady == 0) {
-        error = MLX90640_I2CRead(slaveAddr, 0x8000, 1, &statusRegister);
+    expectedReadyUs = 0; // 清除了就绪标志 需要重新同步
+    error = WaitDataReady(slaveAddr, &statusRegister);
+    if (error != 0) {
+        return error;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief 设置子页周期 用于采集调度 修改刷新率后须重新设置
+ *
+ * @param periodUs 子页周期 单位us 等于 1 / 刷新率 0=不休眠 一直查询
+ */
+void MLX90640_SetSubPagePeriod(uint32_t periodUs)
+{
+    subPagePeriodUs = periodUs;
+    expectedReadyUs = 0;
+}
+
+/**
+ * @brief 返回上次等待数据时查询状态寄存器的次数
+ *
+ * @return uint16_t
+ */
+uint16_t MLX90640_GetLastPollCount(void)
+{
+    return lastPollCount;
+}
+
+/**
+ * @brief 返回上一子页数据就绪的时间 esp_timer_get_time() 时间
+ *
+ * @return int64_t
+ */
+int64_t MLX90640_GetLastReadyTime(void)
+{
+    return lastReadyUs;
+}
+
+/**
+ * @brief 等待新数据就绪
+ *        先休眠到预计就绪时刻之前 READY_GUARD_US, 然后按指数退避查询状态寄存器
+ *        退避间隔达到一个系统节拍后改为每节拍查询一次
+ *        预计就绪时刻按子页周期累加, 第一次查询已经就绪(传感器比预计早)或者比预计晚 READY_GUARD_US 以上时重新同步
+ *
+ * @param slaveAddr
+ * @param statusRegister 就绪时的状态寄存器
+ * @return int 0=就绪 -10=超时 其它为IIC错误
+ */
+static int WaitDataReady(uint8_t slaveAddr, uint16_t* statusRegister)
+{
+    int64_t now;
+    int64_t wake;
+    int64_t deadline;
+    int64_t pollUs;
+    uint32_t backoffUs = POLL_BACKOFF_MIN_US;
+    uint16_t polls = 0;
+    int error;
+
+    now = esp_timer_get_time();
+    if (subPagePeriodUs != 0 && expectedReadyUs != 0) {
+        // 休眠整数个节拍 醒来后剩余不足一个节拍的时间短延时 第一次查询在预计就绪时刻之前 READY_GUARD_US
+        wake = expectedReadyUs - READY_GUARD_US;
+        while (wake - now >= POLL_TICK_US) {
+            vTaskDelay((wake - now) / POLL_TICK_US);
+            now = esp_timer_get_time();
+        }
+        if (wake > now) {
+            esp_rom_delay_us(wake - now);
+        }
+    }
+    deadline = esp_timer_get_time() + subPagePeriodUs + POLL_TIMEOUT_US;
+
+    while (1) {
+        pollUs = esp_timer_get_time();
+        error = MLX90640_I2CRead(slaveAddr, 0x8000, 1, statusRegister);
+        polls++;
         if (error != 0) {
+            lastPollCount = polls;
             return error;
         }
-        dataReady = statusRegister & 0x0008;
+        if (*statusRegister & 0x0008) {
+            break;
+        }
+
+        if (esp_timer_get_time() > deadline) {
+            lastPollCount = polls;
+            expectedReadyUs = 0;
+            return -10;
+        }
+
+        if (backoffUs < POLL_TICK_US) {
+            esp_rom_delay_us(backoffUs);
+            backoffUs <<= 1;
+        } else {
+            vTaskDelay(1);
+        }
     }
+    lastPollCount = polls;
 
+    if (subPagePeriodUs == 0) {
+        expectedReadyUs = 0;
+        lastReadyUs = pollUs;
+        return 0;
+    }
+
+    if (expectedReadyUs == 0) {
+        // 还未同步
+        expectedReadyUs = pollUs;
+    } else if (polls == 1) {
+        if (pollUs < expectedReadyUs) {
+            // 醒来时已经就绪 传感器比预计早
+            expectedReadyUs = pollUs;
+        } else {
+            // 上一子页处理太久 醒来晚了 预计时刻仍然有效, 跳过已经错过的子页
+            while (pollUs - expectedReadyUs >= (int64_t)subPagePeriodUs) {
+                expectedReadyUs += subPagePeriodUs;
+            }
+        }
+    } else if (pollUs - expectedReadyUs > READY_GUARD_US) {
+        // 传感器比预计晚
+        expectedReadyUs = pollUs;
+    }
+
+    lastReadyUs = expectedReadyUs;
+    expectedReadyUs += subPagePeriodUs;
     return 0;
 }
 
+//------------------------------------------------------------------------------
+
 /**
  * @brief 使用IIC中的全局复位命令
  *
@@ -126,6 +330,7 @@ int MLX90640_TriggerMeasurement(uint8_t slaveAddr)
 
     ctrlReg |= 0x8000;
     error = MLX90640_I2CWrite(slaveAddr, 0x800D, ctrlReg);
+    controlRegisterValid = 0;
     if (error != 0) {
         return error;
     }
@@ -150,59 +355,64 @@ int MLX90640_TriggerMeasurement(uint8_t slaveAddr)
 
 /**
  * @brief 读取一帧实时数据 计算所需要的完整的一帧数据为 834 个字（包括 832个字 RAM 数据+控制寄存器+状态寄存器）
+ *        前768个像素数据为传感器原始的大端字节序 须使用 MLX90640_PIXEL 读取
  *
  * @param slaveAddr
  * @param frameData
- * @return int 返回-1 表示 MLX90640 未应答， -8 表示读取异常（最可能的情况是读取速率太低了）
+ * @return int 返回-1 表示 MLX90640 未应答， -8 表示读取异常（最可能的情况是读取速率太低了）， -10 表示等待数据超时
  *             返回 0 或者 1 则表示读取到了刚刚测量完成的子页 0 或者子页 1（读取成功）
  */
 int MLX90640_GetFrameData(uint8_t slaveAddr, uint16_t* frameData)
 {
-    uint16_t dataReady = 0;
-    uint16_t controlRegister1;
     uint16_t statusRegister;
     int error = 1;
-    uint16_t data[64];
-    uint8_t cnt = 0;
+    uint16_t d;
 
-    // 读取寄存器 判断新数据是否准备好
-    while (dataReady == 0) {
-        error = MLX90640_I2CRead(slaveAddr, 0x8000, 1, &statusRegister);
-        if (error != 0) {
-            return error;
-        }
-        dataReady = statusRegister & 0x0008;
+    // 等待新数据准备好
+    error = WaitDataReady(slaveAddr, &statusRegister);
+    if (error != 0) {
+        return error;
     }
 
-    error = MLX90640_I2CWrite(slaveAddr, 0x8000, 0x0030);
+    // 只统计数据就绪后的传输时间
+    PROFILER_BEGIN(PROF_I2C_READ);
+    error = MLX90640_I2CWritePolicy(slaveAddr, 0x8000, 0x0030, MLX90640_WRITE_NO_VERIFY);
     if (error == -1) {
         return error;
     }
 
-    // 读取帧缓存
-    error = MLX90640_I2CRead(slaveAddr, 0x0400, 768, frameData);
+    // 一次读取全部RAM 768个像素 + 64个辅助数据
+    // 像素数据保持传感器的大端字节序 计算时由 MLX90640_PIXEL 转换, 辅助数据在这里转换
+    error = MLX90640_I2CReadRaw(slaveAddr, 0x0400, 832, frameData);
     if (error != 0) {
         return error;
     }
 
-    error = MLX90640_I2CRead(slaveAddr, 0x0700, 64, data);
-    if (error != 0) {
-        return error;
+    for (int i = 768; i < 832; i++) {
+        d = frameData[i];
+        frameData[i] = (d << 8) | (d >> 8);
     }
 
-    error = MLX90640_I2CRead(slaveAddr, 0x800D, 1, &controlRegister1);
-    frameData[832] = controlRegister1;
+    // 控制寄存器只在可能被修改后重新读取
+    if (!controlRegisterValid) {
+        error = MLX90640_I2CRead(slaveAddr, 0x800D, 1, &controlRegister);
+        if (error != 0) {
+            return error;
+        }
+        controlRegisterValid = 1;
+    }
+    frameData[832] = controlRegister;
     frameData[833] = statusRegister & 0x0001; // 新的一帧 在page0还是page1
+    PROFILER_END(PROF_I2C_READ);
 
-    if (error != 0) {
-        return error;
+    // 本子页的传输已完成 下一子页就绪前总线空闲 其它设备可以使用
+    if (subPagePeriodUs > 0 && expectedReadyUs != 0) {
+        i2c_bus_open_idle_window(expectedReadyUs - IDLE_WINDOW_GUARD_US);
     }
 
-    error = ValidateAuxData(data);
-    if (error == 0) {
-        for (cnt = 0; cnt < 64; cnt++) {
-            frameData[cnt + 768] = data[cnt];
-        }
+    error = ValidateAuxData(frameData + 768);
+    if (error != 0) {
+        return error;
     }
 
     error = ValidateFrameData(frameData);
@@ -224,7 +434,7 @@ int ValidateFrameData(uint16_t* frameData)
     uint8_t line = 0;
 
     for (int i = 0; i < 768; i += 32) {
-        if ((frameData[i] == 0x7FFF) && (line % 2 == frameData[833]))
+        if ((MLX90640_PIXEL(frameData, i) == 0x7FFF) && (line % 2 == frameData[833]))
             return -8;
         line = line + 1;
     }
@@ -295,6 +505,7 @@ int MLX90640_ExtractParameters(uint16_t* eeData, paramsMLX90640* mlx90640)
     ExtractKvPixelParameters(eeData, mlx90640);
     ExtractCILCParameters(eeData, mlx90640);
     error = ExtractDeviatingPixels(eeData, mlx90640);
+    MLX90640_BuildCalibTable(mlx90640);
 
     return error;
 }
@@ -321,6 +532,7 @@ int MLX90640_SetResolution(uint8_t slaveAddr, uint8_t resolution)
     if (error == 0) {
         value = (controlRegister1 & 0xF3FF) | value;
         error = MLX90640_I2CWrite(slaveAddr, 0x800D, value);
+        controlRegisterValid = 0;
     }
 
     return error;
@@ -369,6 +581,7 @@ int MLX90640_SetRefreshRate(uint8_t slaveAddr, uint8_t refreshRate)
     if (error == 0) {
         value = (controlRegister1 & 0xFC7F) | value;
         error = MLX90640_I2CWrite(slaveAddr, 0x800D, value);
+        controlRegisterValid = 0;
     }
 
     return error;
@@ -414,6 +627,7 @@ int MLX90640_SetInterleavedMode(uint8_t slaveAddr)
     if (error == 0) {
         value = (controlRegister1 & 0xEFFF);
         error = MLX90640_I2CWrite(slaveAddr, 0x800D, value);
+        controlRegisterValid = 0;
     }
 
     return error;
@@ -436,6 +650,7 @@ int MLX90640_SetChessMode(uint8_t slaveAddr)
     if (error == 0) {
         value = (controlRegister1 | 0x1000);
         error = MLX90640_I2CWrite(slaveAddr, 0x800D, value);
+        controlRegisterValid = 0;
     }
 
     return error;
@@ -465,52 +680,113 @@ int MLX90640_GetCurMode(uint8_t slaveAddr)
 //------------------------------------------------------------------------------
 
 /**
- * @brief 计算物体绝对温度数据(32*24=768像素)
+ * @brief 计算当前子页的帧参数(Vdd Ta 增益 补偿像素), 每个子页只需计算一次
+ *        供 MLX90640_CalculateTo MLX90640_CalculateToFast MLX90640_GetImage 使用
  *
  * @param frameData 读取到的一帧实时数据
  * @param params 从EEPROM解析的数据
+ * @param ctx 计算结果
+ */
+void MLX90640_UpdateFrameContext(uint16_t* frameData, const paramsMLX90640* params, MLX90640_FrameContext* ctx)
+{
+    float vdd;
+    float ta;
+    float gain;
+
+    ctx->subPage = frameData[833]; // 得到当前的子页
+    ctx->mode = (frameData[832] & 0x1000) >> 5;
+
+    vdd = MLX90640_GetVdd(frameData, params);
+    ta = CalcTa(frameData, params, vdd);
+    ctx->vdd = vdd;
+    ctx->ta = ta;
+
+    //------------------------- Gain calculation -----------------------------------
+    gain = (int16_t)frameData[778];
+    gain = params->gainEE / gain;
+    ctx->gain = gain;
+
+    //------------------------- CP calculation -------------------------------------
+    ctx->irDataCP[0] = (int16_t)frameData[776] * gain;
+    ctx->irDataCP[1] = (int16_t)frameData[808] * gain;
+    ctx->irDataCP[0] = ctx->irDataCP[0] - params->cpOffset[0] * (1 + params->cpKta * (ta - 25)) * (1 + params->cpKv * (vdd - 3.3));
+    if (ctx->mode == params->calibrationModeEE) {
+        ctx->irDataCP[1] = ctx->irDataCP[1] - params->cpOffset[1] * (1 + params->cpKta * (ta - 25)) * (1 + params->cpKv * (vdd - 3.3));
+    } else {
+        ctx->irDataCP[1] = ctx->irDataCP[1] - (params->cpOffset[1] + params->ilChessC[0]) * (1 + params->cpKta * (ta - 25)) * (1 + params->cpKv * (vdd - 3.3));
+    }
+}
+
+//------------------------------------------------------------------------------
+
+/**
+ * @brief 根据辐射率和反射温度计算 taTr, 须在 MLX90640_UpdateFrameContext 之后调用
+ *        辐射率 反射温度 外壳温度均未变化时沿用上次的结果
+ *
+ * @param ctx 帧参数
  * @param emissivity 被测物体的辐射率（人体为 0.95）
  * @param tr 校正温度，一般取 Ta-8
+ */
+void MLX90640_UpdateFrameTaTr(MLX90640_FrameContext* ctx, float emissivity, float tr)
+{
+    float ta4;
+    float tr4;
+
+    if (ctx->emissivity == emissivity && ctx->tr == tr && ctx->taTrTa == ctx->ta) {
+        return;
+    }
+
+    ta4 = (ctx->ta + 273.15);
+    ta4 = ta4 * ta4;
+    ta4 = ta4 * ta4;
+    tr4 = (tr + 273.15);
+    tr4 = tr4 * tr4;
+    tr4 = tr4 * tr4;
+
+    ctx->taTr = tr4 - (tr4 - ta4) / emissivity;
+    ctx->emissivity = emissivity;
+    ctx->tr = tr;
+    ctx->taTrTa = ctx->ta;
+}
+
+//------------------------------------------------------------------------------
+
+/**
+ * @brief 计算物体绝对温度数据(32*24=768像素)
+ *
+ * @param frameData 读取到的一帧实时数据
+ * @param params 从EEPROM解析的数据
+ * @param ctx 由 MLX90640_UpdateFrameContext 和 MLX90640_UpdateFrameTaTr 计算的帧参数
  * @param result 计算结果， 768个浮点数， 单位为℃温度值
  */
-void MLX90640_CalculateTo(uint16_t* frameData, const paramsMLX90640* params, float emissivity, float tr, float* result)
+void MLX90640_CalculateTo(uint16_t* frameData, const paramsMLX90640* params, const MLX90640_FrameContext* ctx, float* result)
 {
     float vdd;
     float ta;
-    float ta4;
-    float tr4;
     float taTr;
     float gain;
-    float irDataCP[2];
+    float emissivity;
     float irData;
     float alphaCompensated;
-    uint8_t mode;
     int8_t ilPattern;
-    int8_t chessPattern;
-    int8_t pattern;
     int8_t conversionPattern;
+    uint16_t pixelNumber;
+    const uint16_t* pixels;
     float Sx;
     float To;
     float alphaCorrR[4];
     int8_t range;
-    uint16_t subPage;
     float ktaScale;
     float kvScale;
     float alphaScale;
     float kta;
     float kv;
 
-    subPage = frameData[833]; // 得到当前的子页
-    vdd = MLX90640_GetVdd(frameData, params);
-    ta = MLX90640_GetTa(frameData, params);
-
-    ta4 = (ta + 273.15);
-    ta4 = ta4 * ta4;
-    ta4 = ta4 * ta4;
-    tr4 = (tr + 273.15);
-    tr4 = tr4 * tr4;
-    tr4 = tr4 * tr4;
-    taTr = tr4 - (tr4 - ta4) / emissivity;
+    vdd = ctx->vdd;
+    ta = ctx->ta;
+    taTr = ctx->taTr;
+    gain = ctx->gain;
+    emissivity = ctx->emissivity;
 
     ktaScale = pow(2, (double)params->ktaScale);
     kvScale = pow(2, (double)params->kvScale);
@@ -521,83 +797,135 @@ void MLX90640_CalculateTo(uint16_t* frameData, const paramsMLX90640* params, flo
     alphaCorrR[2] = (1 + params->ksTo[1] * params->ct[2]);
     alphaCorrR[3] = alphaCorrR[2] * (1 + params->ksTo[2] * (params->ct[3] - params->ct[2]));
 
-    //------------------------- Gain calculation -----------------------------------
-    gain = frameData[778];
-    if (gain > 32767) {
-        gain = gain - 65536;
-    }
-
-    gain = params->gainEE / gain;
-
     //------------------------- To calculation -------------------------------------
-    mode = (frameData[832] & 0x1000) >> 5;
+    pixels = subPagePixels[ctx->mode != 0][ctx->subPage];
+    for (int i = 0; i < 384; i++) {
+        pixelNumber = pixels[i];
+        ilPattern = pixelNumber / 32 - (pixelNumber / 64) * 2;
+        conversionPattern = ((pixelNumber + 2) / 4 - (pixelNumber + 3) / 4 + (pixelNumber + 1) / 4 - pixelNumber / 4) * (1 - 2 * ilPattern);
 
-    irDataCP[0] = frameData[776];
-    irDataCP[1] = frameData[808];
-    for (int i = 0; i < 2; i++) {
-        if (irDataCP[i] > 32767) {
-            irDataCP[i] = irDataCP[i] - 65536;
+        irData = MLX90640_PIXEL(frameData, pixelNumber);
+        if (irData > 32767) {
+            irData = irData - 65536;
         }
-        irDataCP[i] = irDataCP[i] * gain;
-    }
-    irDataCP[0] = irDataCP[0] - params->cpOffset[0] * (1 + params->cpKta * (ta - 25)) * (1 + params->cpKv * (vdd - 3.3));
-    if (mode == params->calibrationModeEE) {
-        irDataCP[1] = irDataCP[1] - params->cpOffset[1] * (1 + params->cpKta * (ta - 25)) * (1 + params->cpKv * (vdd - 3.3));
-    } else {
-        irDataCP[1] = irDataCP[1] - (params->cpOffset[1] + params->ilChessC[0]) * (1 + params->cpKta * (ta - 25)) * (1 + params->cpKv * (vdd - 3.3));
-    }
+        irData = irData * gain;
 
-    for (int pixelNumber = 0; pixelNumber < 768; pixelNumber++) {
-        ilPattern = pixelNumber / 32 - (pixelNumber / 64) * 2;
-        chessPattern = ilPattern ^ (pixelNumber - (pixelNumber / 2) * 2);
-        conversionPattern = ((pixelNumber + 2) / 4 - (pixelNumber + 3) / 4 + (pixelNumber + 1) / 4 - pixelNumber / 4) * (1 - 2 * ilPattern);
+        kta = params->kta[pixelNumber] / ktaScale;
+        kv = params->kv[pixelNumber] / kvScale;
+        irData = irData - params->offset[pixelNumber] * (1 + kta * (ta - 25)) * (1 + kv * (vdd - 3.3));
 
-        if (mode == 0) {
-            pattern = ilPattern;
-        } else {
-            pattern = chessPattern;
+        if (ctx->mode != params->calibrationModeEE) {
+            irData = irData + params->ilChessC[2] * (2 * ilPattern - 1) - params->ilChessC[1] * conversionPattern;
         }
 
-        if (pattern == frameData[833]) {
-            irData = frameData[pixelNumber];
-            if (irData > 32767) {
-                irData = irData - 65536;
-            }
-            irData = irData * gain;
+        irData = irData - params->tgc * ctx->irDataCP[ctx->subPage];
+        irData = irData / emissivity;
 
-            kta = params->kta[pixelNumber] / ktaScale;
-            kv = params->kv[pixelNumber] / kvScale;
-            irData = irData - params->offset[pixelNumber] * (1 + kta * (ta - 25)) * (1 + kv * (vdd - 3.3));
+        alphaCompensated = SCALEALPHA * alphaScale / params->alpha[pixelNumber];
+        alphaCompensated = alphaCompensated * (1 + params->KsTa * (ta - 25));
 
-            if (mode != params->calibrationModeEE) {
-                irData = irData + params->ilChessC[2] * (2 * ilPattern - 1) - params->ilChessC[1] * conversionPattern;
-            }
+        Sx = alphaCompensated * alphaCompensated * alphaCompensated * (irData + alphaCompensated * taTr);
+        Sx = sqrt(sqrt(Sx)) * params->ksTo[1];
 
-            irData = irData - params->tgc * irDataCP[subPage];
-            irData = irData / emissivity;
+        To = sqrt(sqrt(irData / (alphaCompensated * (1 - params->ksTo[1] * 273.15) + Sx) + taTr)) - 273.15;
 
-            alphaCompensated = SCALEALPHA * alphaScale / params->alpha[pixelNumber];
-            alphaCompensated = alphaCompensated * (1 + params->KsTa * (ta - 25));
+        if (To < params->ct[1]) {
+            range = 0;
+        } else if (To < params->ct[2]) {
+            range = 1;
+        } else if (To < params->ct[3]) {
+            range = 2;
+        } else {
+            range = 3;
+        }
 
-            Sx = alphaCompensated * alphaCompensated * alphaCompensated * (irData + alphaCompensated * taTr);
-            Sx = sqrt(sqrt(Sx)) * params->ksTo[1];
+        To = sqrt(sqrt(irData / (alphaCompensated * alphaCorrR[range] * (1 + params->ksTo[range] * (To - params->ct[range]))) + taTr)) - 273.15;
 
-            To = sqrt(sqrt(irData / (alphaCompensated * (1 - params->ksTo[1] * 273.15) + Sx) + taTr)) - 273.15;
+        result[pixelNumber] = To;
+    }
+}
 
-            if (To < params->ct[1]) {
-                range = 0;
-            } else if (To < params->ct[2]) {
-                range = 1;
-            } else if (To < params->ct[3]) {
-                range = 2;
-            } else {
-                range = 3;
-            }
+//------------------------------------------------------------------------------
 
-            To = sqrt(sqrt(irData / (alphaCompensated * alphaCorrR[range] * (1 + params->ksTo[range] * (To - params->ct[range]))) + taTr)) - 273.15;
+/**
+ * @brief 与 MLX90640_CalculateTo 计算结果相同(误差 < 0.01℃)，使用 MLX90640_ExtractParameters 预计算的校准表
+ *        省去了每帧的 pow 计算以及每个像素的除法和 il/chess/conversion 图案计算
+ *        四次方根的实现由 CONFIG_MLX90640_TO_KERNEL_FLOAT/DOUBLE 选择
+ *
+ * @param frameData 读取到的一帧实时数据
+ * @param params 从EEPROM解析的数据
+ * @param ctx 由 MLX90640_UpdateFrameContext 和 MLX90640_UpdateFrameTaTr 计算的帧参数
+ * @param result 计算结果， 768个浮点数， 单位为℃温度值
+ */
+void MLX90640_CalculateToFast(uint16_t* frameData, const paramsMLX90640* params, const MLX90640_FrameContext* ctx, float* result)
+{
+    float taTr;
+    float gain;
+    float irData;
+    float alphaCompensated;
+    float Sx;
+    float To;
+    int8_t range;
+    float ktaFactor;
+    float kvFactor;
+    float ksTaFactor;
+    float cpComp;
+    float invEmissivity;
+    float ilChessCorr[6];
+    const MLX90640_PixelCalib* calib;
+    const uint16_t* pixels;
+    uint16_t pixelNumber;
+
+    taTr = ctx->taTr;
+    gain = ctx->gain;
+    ktaFactor = ctx->ta - 25;
+    kvFactor = ctx->vdd - 3.3f;
+    ksTaFactor = 1 + params->KsTa * ktaFactor;
+    invEmissivity = 1 / ctx->emissivity;
+    cpComp = params->tgc * ctx->irDataCP[ctx->subPage];
+
+    // il/chess 修正值只有 ilPattern(0/1) x conversionPattern(-1/0/1) 6种组合
+    for (int i = 0; i < 6; i++) {
+        if (ctx->mode != params->calibrationModeEE) {
+            ilChessCorr[i] = params->ilChessC[2] * (2 * (i / 3) - 1) - params->ilChessC[1] * (i % 3 - 1);
+        } else {
+            ilChessCorr[i] = 0;
+        }
+    }
 
-            result[pixelNumber] = To;
+    //------------------------- To calculation -------------------------------------
+    // 只计算当前子页更新的 384 个像素
+    pixels = subPagePixels[ctx->mode != 0][ctx->subPage];
+    for (int i = 0; i < 384; i++) {
+        pixelNumber = pixels[i];
+        calib = &params->calib[pixelNumber];
+
+        irData = (int16_t)MLX90640_PIXEL(frameData, pixelNumber) * gain;
+        irData = irData - calib->offset * (1 + calib->kta * ktaFactor) * (1 + calib->kv * kvFactor);
+        irData = irData + ilChessCorr[calib->ilChessIdx];
+        irData = irData - cpComp;
+        irData = irData * invEmissivity;
+
+        alphaCompensated = calib->alpha * ksTaFactor;
+
+        Sx = alphaCompensated * alphaCompensated * alphaCompensated * (irData + alphaCompensated * taTr);
+        Sx = MLX90640_ROOT4(Sx) * params->ksTo[1];
+
+        To = MLX90640_ROOT4(irData / (alphaCompensated * params->ksTo1Kelvin + Sx) + taTr) - MLX90640_KELVIN;
+
+        if (To < params->ct[1]) {
+            range = 0;
+        } else if (To < params->ct[2]) {
+            range = 1;
+        } else if (To < params->ct[3]) {
+            range = 2;
+        } else {
+            range = 3;
         }
+
+        To = MLX90640_ROOT4(irData / (alphaCompensated * params->alphaCorrR[range] * (1 + params->ksTo[range] * (To - params->ct[range]))) + taTr) - MLX90640_KELVIN;
+
+        result[pixelNumber] = To;
     }
 }
 
@@ -609,95 +937,61 @@ void MLX90640_CalculateTo(uint16_t* frameData, const paramsMLX90640* params, flo
  *
  * @param frameData
  * @param params
+ * @param ctx 由 MLX90640_UpdateFrameContext 计算的帧参数
  * @param result
  */
-void MLX90640_GetImage(uint16_t* frameData, const paramsMLX90640* params, float* result)
+void MLX90640_GetImage(uint16_t* frameData, const paramsMLX90640* params, const MLX90640_FrameContext* ctx, float* result)
 {
     float vdd;
     float ta;
     float gain;
-    float irDataCP[2];
     float irData;
     float alphaCompensated;
-    uint8_t mode;
     int8_t ilPattern;
-    int8_t chessPattern;
-    int8_t pattern;
     int8_t conversionPattern;
+    uint16_t pixelNumber;
+    const uint16_t* pixels;
     float image;
-    uint16_t subPage;
     float ktaScale;
     float kvScale;
     float kta;
     float kv;
 
-    subPage = frameData[833]; // 得到当前的子页
-    vdd = MLX90640_GetVdd(frameData, params);
-    ta = MLX90640_GetTa(frameData, params);
+    vdd = ctx->vdd;
+    ta = ctx->ta;
+    gain = ctx->gain;
 
     ktaScale = pow(2, (double)params->ktaScale);
     kvScale = pow(2, (double)params->kvScale);
 
-    //------------------------- Gain calculation -----------------------------------
-    gain = frameData[778];
-    if (gain > 32767) {
-        gain = gain - 65536;
-    }
-
-    gain = params->gainEE / gain;
-
     //------------------------- Image calculation -------------------------------------
-    mode = (frameData[832] & 0x1000) >> 5;
-
-    irDataCP[0] = frameData[776];
-    irDataCP[1] = frameData[808];
-    for (int i = 0; i < 2; i++) {
-        if (irDataCP[i] > 32767) {
-            irDataCP[i] = irDataCP[i] - 65536;
-        }
-        irDataCP[i] = irDataCP[i] * gain;
-    }
-    irDataCP[0] = irDataCP[0] - params->cpOffset[0] * (1 + params->cpKta * (ta - 25)) * (1 + params->cpKv * (vdd - 3.3));
-    if (mode == params->calibrationModeEE) {
-        irDataCP[1] = irDataCP[1] - params->cpOffset[1] * (1 + params->cpKta * (ta - 25)) * (1 + params->cpKv * (vdd - 3.3));
-    } else {
-        irDataCP[1] = irDataCP[1] - (params->cpOffset[1] + params->ilChessC[0]) * (1 + params->cpKta * (ta - 25)) * (1 + params->cpKv * (vdd - 3.3));
-    }
-
-    for (int pixelNumber = 0; pixelNumber < 768; pixelNumber++) {
+    pixels = subPagePixels[ctx->mode != 0][ctx->subPage];
+    for (int i = 0; i < 384; i++) {
+        pixelNumber = pixels[i];
         ilPattern = pixelNumber / 32 - (pixelNumber / 64) * 2;
-        chessPattern = ilPattern ^ (pixelNumber - (pixelNumber / 2) * 2);
         conversionPattern = ((pixelNumber + 2) / 4 - (pixelNumber + 3) / 4 + (pixelNumber + 1) / 4 - pixelNumber / 4) * (1 - 2 * ilPattern);
 
-        if (mode == 0) {
-            pattern = ilPattern;
-        } else {
-            pattern = chessPattern;
+        irData = MLX90640_PIXEL(frameData, pixelNumber);
+        if (irData > 32767) {
+            irData = irData - 65536;
         }
+        irData = irData * gain;
 
-        if (pattern == frameData[833]) {
-            irData = frameData[pixelNumber];
-            if (irData > 32767) {
-                irData = irData - 65536;
-            }
-            irData = irData * gain;
-
-            kta = params->kta[pixelNumber] / ktaScale;
-            kv = params->kv[pixelNumber] / kvScale;
-            irData = irData - params->offset[pixelNumber] * (1 + kta * (ta - 25)) * (1 + kv * (vdd - 3.3));
+        kta = params->kta[pixelNumber] / ktaScale;
+        kv = params->kv[pixelNumber] / kvScale;
+        irData = irData - params->offset[pixelNumber] * (1 + kta * (ta - 25)) * (1 + kv * (vdd - 3.3));
 
-            if (mode != params->calibrationModeEE) {
-                irData = irData + params->ilChessC[2] * (2 * ilPattern - 1) - params->ilChessC[1] * conversionPattern;
-            }
+        if (ctx->mode != params->calibrationModeEE) {
+            irData = irData + params->ilChessC[2] * (2 * ilPattern - 1) - params->ilChessC[1] * conversionPattern;
+        }
 
-            irData = irData - params->tgc * irDataCP[subPage];
+        irData = irData - params->tgc * ctx->irDataCP[ctx->subPage];
 
-            alphaCompensated = params->alpha[pixelNumber];
+        alphaCompensated = params->alpha[pixelNumber];
 
-            image = irData * alphaCompensated;
+        image = irData * alphaCompensated;
 
-            result[pixelNumber] = image;
-        }
+        result[pixelNumber] = image;
     }
 }
 
@@ -722,7 +1016,7 @@ float MLX90640_GetVdd(uint16_t* frameData, const paramsMLX90640* params)
         vdd = vdd - 65536;
     }
     resolutionRAM = (frameData[832] & 0x0C00) >> 10;
-    resolutionCorrection = pow(2, (double)params->resolutionEE) / pow(2, (double)resolutionRAM);
+    resolutionCorrection = (float)(1 << params->resolutionEE) / (1 << resolutionRAM);
     vdd = (resolutionCorrection * vdd - params->vdd25) / params->kVdd + 3.3;
 
     return vdd;
@@ -731,21 +1025,19 @@ float MLX90640_GetVdd(uint16_t* frameData, const paramsMLX90640* params)
 //------------------------------------------------------------------------------
 
 /**
- * @brief 计算得到 Ta（ MLX90640 外壳温度）
+ * @brief 根据已计算的 Vdd 得到 Ta
  *
  * @param frameData
  * @param params
- * @return float 返回值是浮点数，单位为℃。若与环境温度相差甚远，则说明发生了较为严重的问题
+ * @param vdd MLX90640_GetVdd 的结果
+ * @return float
  */
-float MLX90640_GetTa(uint16_t* frameData, const paramsMLX90640* params)
+static float CalcTa(uint16_t* frameData, const paramsMLX90640* params, float vdd)
 {
     float ptat;
     float ptatArt;
-    float vdd;
     float ta;
 
-    vdd = MLX90640_GetVdd(frameData, params);
-
     ptat = frameData[800];
     if (ptat > 32767) {
         ptat = ptat - 65536;
@@ -755,7 +1047,7 @@ float MLX90640_GetTa(uint16_t* frameData, const paramsMLX90640* params)
     if (ptatArt > 32767) {
         ptatArt = ptatArt - 65536;
     }
-    ptatArt = (ptat / (ptat * params->alphaPTAT + ptatArt)) * pow(2, (double)18);
+    ptatArt = (ptat / (ptat * params->alphaPTAT + ptatArt)) * 262144.0; // 2^18
 
     ta = (ptatArt / (1 + params->KvPTAT * (vdd - 3.3)) - params->vPTAT25);
     ta = ta / params->KtPTAT + 25;
@@ -763,6 +1055,18 @@ float MLX90640_GetTa(uint16_t* frameData, const paramsMLX90640* params)
     return ta;
 }
 
+/**
+ * @brief 计算得到 Ta（ MLX90640 外壳温度）
+ *
+ * @param frameData
+ * @param params
+ * @return float 返回值是浮点数，单位为℃。若与环境温度相差甚远，则说明发生了较为严重的问题
+ */
+float MLX90640_GetTa(uint16_t* frameData, const paramsMLX90640* params)
+{
+    return CalcTa(frameData, params, MLX90640_GetVdd(frameData, params));
+}
+
 //------------------------------------------------------------------------------
 
 /**
@@ -1463,6 +1767,60 @@ int ExtractDeviatingPixels(uint16_t* eeData, paramsMLX90640* mlx90640)
 
 //------------------------------------------------------------------------------
 
+/**
+ * @brief 根据已解析的参数生成每个像素的校准表以及各子页的像素序号表, 供温度计算使用
+ *        须在其它 Extract 函数之后调用, 从缓存恢复参数后也须调用
+ *
+ * @param mlx90640
+ */
+void MLX90640_BuildCalibTable(paramsMLX90640* mlx90640)
+{
+    float ktaScale;
+    float kvScale;
+    float alphaScale;
+    int8_t ilPattern;
+    int8_t chessPattern;
+    int8_t conversionPattern;
+    MLX90640_PixelCalib* calib;
+    uint16_t count[2][2] = { { 0, 0 }, { 0, 0 } };
+
+#if defined(CONFIG_MLX90640_TO_KERNEL_FLOAT)
+    // 每个区间取尾数中点的 (2^n * m)^(-1/4)
+    for (int i = 0; i < 64; i++) {
+        invRoot4Seed[i] = powf((1 << (i >> 4)) * (1 + ((i & 0x0f) + 0.5f) / 16), -0.25f);
+    }
+#endif
+
+    ktaScale = pow(2, (double)mlx90640->ktaScale);
+    kvScale = pow(2, (double)mlx90640->kvScale);
+    alphaScale = pow(2, (double)mlx90640->alphaScale);
+
+    mlx90640->alphaCorrR[0] = 1 / (1 + mlx90640->ksTo[0] * 40);
+    mlx90640->alphaCorrR[1] = 1;
+    mlx90640->alphaCorrR[2] = (1 + mlx90640->ksTo[1] * mlx90640->ct[2]);
+    mlx90640->alphaCorrR[3] = mlx90640->alphaCorrR[2] * (1 + mlx90640->ksTo[2] * (mlx90640->ct[3] - mlx90640->ct[2]));
+    mlx90640->ksTo1Kelvin = 1 - mlx90640->ksTo[1] * 273.15;
+
+    for (int pixelNumber = 0; pixelNumber < 768; pixelNumber++) {
+        ilPattern = pixelNumber / 32 - (pixelNumber / 64) * 2;
+        chessPattern = ilPattern ^ (pixelNumber - (pixelNumber / 2) * 2);
+        conversionPattern = ((pixelNumber + 2) / 4 - (pixelNumber + 3) / 4 + (pixelNumber + 1) / 4 - pixelNumber / 4) * (1 - 2 * ilPattern);
+
+        calib = &mlx90640->calib[pixelNumber];
+        calib->kta = mlx90640->kta[pixelNumber] / ktaScale;
+        calib->kv = mlx90640->kv[pixelNumber] / kvScale;
+        calib->alpha = SCALEALPHA * alphaScale / mlx90640->alpha[pixelNumber];
+        calib->offset = mlx90640->offset[pixelNumber];
+        calib->ilChessIdx = ilPattern * 3 + conversionPattern + 1;
+
+        // 按子页分组 交错模式按 ilPattern 棋盘模式按 chessPattern
+        subPagePixels[0][ilPattern][count[0][ilPattern]++] = pixelNumber;
+        subPagePixels[1][chessPattern][count[1][chessPattern]++] = pixelNumber;
+    }
+}
+
+//------------------------------------------------------------------------------
+
 /**
  * @brief
  *
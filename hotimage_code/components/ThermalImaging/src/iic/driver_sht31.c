@@ -17,6 +17,10 @@
 #define SHT31_COMMAND_READ_STATUS 0xF32DU /**< read status command */
 #define SHT31_COMMAND_CLEAR_STATUS 0x3041U /**< clear status command */
 
+// SHT31 为后台设备 总线传输在 MLX90640 子页之间的空闲窗口内进行
+#define SHT31_BUS_COST_US 1000 // 一次传输预计占用总线的时间
+#define SHT31_BUS_DEADLINE (1000 / portTICK_RATE_MS) // 等待空闲窗口的截止时间
+
 static uint8_t sht31_iic_addr = 0x44; // SHT31 IIC 地址
 static sht31_handle_t sht31_handle = { 0 };
 
@@ -46,7 +50,13 @@ static uint8_t a_sht31_write(uint16_t reg)
     uint8_t cmd_buffer[2];
     cmd_buffer[0] = (reg >> 8) & 0xFF;
     cmd_buffer[1] = reg & 0xFF;
-    return i2c_master_write_slave_reg(I2C_NUM, sht31_iic_addr, cmd_buffer[0], cmd_buffer + 1, 1, 100 / portTICK_RATE_MS);
+
+    esp_err_t ret = i2c_bus_acquire(I2C_BUS_PRIO_LOW, SHT31_BUS_COST_US, SHT31_BUS_DEADLINE);
+    if (ret != ESP_OK)
+        return ret;
+    ret = i2c_master_write_slave_reg(I2C_NUM, sht31_iic_addr, cmd_buffer[0], cmd_buffer + 1, 1, 100 / portTICK_RATE_MS);
+    i2c_bus_release();
+    return ret;
 }
 
 /**
@@ -62,7 +72,12 @@ static uint8_t a_sht31_write(uint16_t reg)
  */
 static uint8_t a_sht31_read(uint16_t reg, uint8_t* data, uint16_t len)
 {
-    return i2c_master_read_slave_reg_16bit(I2C_NUM, sht31_iic_addr, reg, data, len, 100 / portTICK_RATE_MS);
+    esp_err_t ret = i2c_bus_acquire(I2C_BUS_PRIO_LOW, SHT31_BUS_COST_US, SHT31_BUS_DEADLINE);
+    if (ret != ESP_OK)
+        return ret;
+    ret = i2c_master_read_slave_reg_16bit(I2C_NUM, sht31_iic_addr, reg, data, len, 100 / portTICK_RATE_MS);
+    i2c_bus_release();
+    return ret;
 }
 
 /**
@@ -77,7 +92,12 @@ static uint8_t a_sht31_read(uint16_t reg, uint8_t* data, uint16_t len)
  */
 static uint8_t a_sht31_read_noreg(uint8_t* data, uint16_t len)
 {
-    return i2c_master_read_slave(I2C_NUM, sht31_iic_addr, data, len, 100 / portTICK_RATE_MS);
+    esp_err_t ret = i2c_bus_acquire(I2C_BUS_PRIO_LOW, SHT31_BUS_COST_US, SHT31_BUS_DEADLINE);
+    if (ret != ESP_OK)
+        return ret;
+    ret = i2c_master_read_slave(I2C_NUM, sht31_iic_addr, data, len, 100 / portTICK_RATE_MS);
+    i2c_bus_release();
+    return ret;
 }
 
 /**
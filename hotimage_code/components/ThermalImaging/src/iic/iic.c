@@ -1,10 +1,72 @@
 #include "iic.h"
+#include "esp_timer.h"
+#include <freertos/event_groups.h>
+#include <freertos/task.h>
+#include <string.h>
 
 #ifdef CONFIG_ESP32_IIC_SUPPORT
 
-/* 互斥信号量句柄 */
+/* 递归互斥信号量句柄 总线仲裁持有期间 内部的读写函数可以再次获取 */
 static SemaphoreHandle_t xSemaphore = NULL;
 
+/* 总线仲裁 */
+#define BUS_IDLE_WINDOW_BIT (1 << 0) // 空闲窗口已打开
+#define BUS_WINDOW_STALE_US 3000000 // 超过这个时间没有打开空闲窗口 认为没有高优先级设备在调度总线
+
+static EventGroupHandle_t busEventGroup = NULL;
+static portMUX_TYPE busSpinlock = portMUX_INITIALIZER_UNLOCKED;
+static volatile uint32_t highWaiting = 0; // 正在等待总线的高优先级传输数
+static volatile int64_t idleWindowEndUs = 0; // 当前空闲窗口的结束时间
+static volatile int64_t idleWindowOpenUs = 0; // 上次打开空闲窗口的时间 0=从未打开
+static sI2CBusStats busStats;
+
+/* 命令链接缓存 所有传输都在互斥信号量内进行 共用一个静态缓存 避免每次传输都申请堆内存 */
+static uint8_t cmdLinkBuff[I2C_LINK_RECOMMENDED_SIZE(3)];
+static uint8_t cmdLinkIsStatic = 0;
+static uint32_t cmdLinkHeapFallbacks = 0; // 静态缓存不可用 命令链接改为从堆中分配的次数
+
+/**
+ * @brief 获取命令链接 须在互斥信号量内调用
+ *        静态缓存不可用时才从堆中分配
+ *
+ * @return i2c_cmd_handle_t
+ */
+static i2c_cmd_handle_t cmd_link_get(void)
+{
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create_static(cmdLinkBuff, sizeof(cmdLinkBuff));
+    cmdLinkIsStatic = (NULL != cmd);
+    if (!cmdLinkIsStatic) {
+        cmdLinkHeapFallbacks++;
+        cmd = i2c_cmd_link_create();
+    }
+    return cmd;
+}
+
+/**
+ * @brief 释放命令链接
+ *
+ * @param cmd
+ */
+static void cmd_link_put(i2c_cmd_handle_t cmd)
+{
+    if (cmdLinkIsStatic) {
+        i2c_cmd_link_delete_static(cmd);
+    } else {
+        i2c_cmd_link_delete(cmd);
+    }
+}
+
+/**
+ * @brief 返回命令链接没有使用静态缓存 改为从堆中分配的次数 正常情况下应一直为0
+ *        只统计命令链接 不包括 IIC 驱动内部的内存分配
+ *
+ * @return uint32_t
+ */
+uint32_t i2c_get_cmd_link_heap_fallbacks(void)
+{
+    return cmdLinkHeapFallbacks;
+}
+
 /**
  * @brief 初始化IIC设备
  *
@@ -23,7 +85,125 @@ void I2CInit(int sda_io_num, int scl_io_num, uint32_t freqHZ, i2c_mode_t mode)
     i2c_driver_install(I2C_NUM, conf.mode, I2C_RX_BUF_DISABLE, I2C_TX_BUF_DISABLE, 0);
 
     /* 创建互斥信号量 */
-    xSemaphore = xSemaphoreCreateMutex();
+    xSemaphore = xSemaphoreCreateRecursiveMutex();
+    busEventGroup = xEventGroupCreate();
+}
+
+/**
+ * @brief 获取总线使用权 一次传输(可以包含多次读写)开始前调用 结束后调用 i2c_bus_release
+ *        高优先级: 立即关闭空闲窗口 只等待正在进行的传输结束, 低优先级传输不会再开始
+ *        低优先级: 只在高优先级设备打开的空闲窗口内 且窗口剩余时间足够时才开始
+ *                  超过截止时间仍没有合适的窗口 则放弃本次传输(记入 lowDeadlineMiss) 不抢占下一子页的总线
+ *        没有高优先级设备调度总线时(从未打开窗口或窗口已过期很久) 低优先级直接等待总线
+ *
+ * @param prio 优先级
+ * @param costUs 预计占用总线的时间 只对低优先级有效
+ * @param ticks_to_wait 截止时间
+ * @return esp_err_t ESP_OK 或 ESP_ERR_TIMEOUT(低优先级截止时间内没有等到空闲窗口 调用者应跳过本次传输)
+ */
+esp_err_t i2c_bus_acquire(eI2CBusPriority prio, uint32_t costUs, TickType_t ticks_to_wait)
+{
+    BaseType_t res;
+
+    if (I2C_BUS_PRIO_HIGH == prio) {
+        portENTER_CRITICAL(&busSpinlock);
+        highWaiting++;
+        portEXIT_CRITICAL(&busSpinlock);
+
+        xEventGroupClearBits(busEventGroup, BUS_IDLE_WINDOW_BIT);
+        res = xSemaphoreTakeRecursive(xSemaphore, ticks_to_wait);
+
+        portENTER_CRITICAL(&busSpinlock);
+        highWaiting--;
+        portEXIT_CRITICAL(&busSpinlock);
+
+        if (res != pdTRUE)
+            return ESP_ERR_TIMEOUT;
+
+        busStats.high++;
+        return ESP_OK;
+    }
+
+    TickType_t start = xTaskGetTickCount();
+    while (1) {
+        TickType_t waited = xTaskGetTickCount() - start;
+        if (waited >= ticks_to_wait)
+            break;
+
+        int64_t now = esp_timer_get_time();
+        if (0 == idleWindowOpenUs || now - idleWindowOpenUs > BUS_WINDOW_STALE_US) {
+            // 没有高优先级设备在调度总线
+            res = xSemaphoreTakeRecursive(xSemaphore, ticks_to_wait - waited);
+            if (res != pdTRUE)
+                break;
+            busStats.low++;
+            return ESP_OK;
+        }
+
+        EventBits_t bits = xEventGroupWaitBits(busEventGroup, BUS_IDLE_WINDOW_BIT, pdFALSE, pdTRUE, ticks_to_wait - waited);
+        if (!(bits & BUS_IDLE_WINDOW_BIT))
+            continue;
+
+        // 窗口剩余时间不够 等待下一个窗口
+        if (esp_timer_get_time() + costUs > idleWindowEndUs) {
+            xEventGroupClearBits(busEventGroup, BUS_IDLE_WINDOW_BIT);
+            continue;
+        }
+
+        if (xSemaphoreTakeRecursive(xSemaphore, 0) != pdTRUE) {
+            vTaskDelay(1);
+            continue;
+        }
+
+        // 拿到总线的同时来了高优先级传输 让出
+        if (highWaiting) {
+            xSemaphoreGiveRecursive(xSemaphore);
+            continue;
+        }
+
+        busStats.low++;
+        busStats.lowInWindow++;
+        return ESP_OK;
+    }
+
+    // 截止时间已到 放弃本次传输 帧数据读取不能排在低优先级传输后面
+    busStats.lowDeadlineMiss++;
+    return ESP_ERR_TIMEOUT;
+}
+
+/**
+ * @brief 释放总线使用权
+ *
+ */
+void i2c_bus_release(void)
+{
+    xSemaphoreGiveRecursive(xSemaphore);
+}
+
+/**
+ * @brief 高优先级设备通知总线空闲 在 endUs 之前不会再使用总线 低优先级传输可以在这个窗口内进行
+ *
+ * @param endUs 窗口结束时间 esp_timer_get_time() 时间
+ */
+void i2c_bus_open_idle_window(int64_t endUs)
+{
+    int64_t now = esp_timer_get_time();
+    if (endUs <= now)
+        return;
+
+    idleWindowEndUs = endUs;
+    idleWindowOpenUs = now;
+    xEventGroupSetBits(busEventGroup, BUS_IDLE_WINDOW_BIT);
+}
+
+/**
+ * @brief 获取总线仲裁计数
+ *
+ * @param stats
+ */
+void i2c_bus_get_stats(sI2CBusStats* stats)
+{
+    memcpy(stats, &busStats, sizeof(sI2CBusStats));
 }
 
 /**
@@ -40,13 +220,15 @@ void i2c_master_scan(void)
             fflush(stdout);
             address = i + j;
 
-            i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+            xSemaphoreTakeRecursive(xSemaphore, portMAX_DELAY);
+            i2c_cmd_handle_t cmd = cmd_link_get();
             i2c_master_start(cmd);
             i2c_master_write_byte(cmd, (address << 1) | WRITE_BIT, ACK_CHECK_EN);
             i2c_master_stop(cmd);
 
             esp_err_t ret = i2c_master_cmd_begin(I2C_NUM, cmd, 50 / portTICK_RATE_MS);
-            i2c_cmd_link_delete(cmd);
+            cmd_link_put(cmd);
+            xSemaphoreGiveRecursive(xSemaphore);
 
             if (ret == ESP_OK) {
                 printf("%02x ", address);
@@ -78,7 +260,7 @@ esp_err_t i2c_general_reset()
 #if 0
 uint8_t iic_write_address16(uint8_t addr, uint16_t reg, uint8_t* pBuf, uint16_t len)
 {
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+    i2c_cmd_handle_t cmd = cmd_link_get();
 
     // 1 选择传感器的内部地址
     i2c_master_start(cmd);
@@ -94,14 +276,14 @@ uint8_t iic_write_address16(uint8_t addr, uint16_t reg, uint8_t* pBuf, uint16_t
     i2c_master_stop(cmd);
 
     esp_err_t ret = i2c_master_cmd_begin(I2C_NUM, cmd, 1000 / portTICK_RATE_MS);
-    i2c_cmd_link_delete(cmd);
+    cmd_link_put(cmd);
 
     return ret;
 }
 
 uint8_t iic_read_address16(uint8_t addr, uint16_t reg, uint8_t* pBuf, uint16_t len)
 {
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+    i2c_cmd_handle_t cmd = cmd_link_get();
 
     // 1 选择传感器的内部地址
     i2c_master_start(cmd);
@@ -118,7 +300,7 @@ uint8_t iic_read_address16(uint8_t addr, uint16_t reg, uint8_t* pBuf, uint16_t l
     i2c_master_stop(cmd);
 
     esp_err_t ret = i2c_master_cmd_begin(I2C_NUM, cmd, 1000 / portTICK_RATE_MS);
-    i2c_cmd_link_delete(cmd);
+    cmd_link_put(cmd);
 
     return ret;
 }
@@ -143,9 +325,9 @@ esp_err_t i2c_master_read_slave(i2c_port_t i2c_num, uint8_t slave_addr, uint8_t*
         return ESP_OK;
     }
 
-    xSemaphoreTake(xSemaphore, portMAX_DELAY);
+    xSemaphoreTakeRecursive(xSemaphore, portMAX_DELAY);
 
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+    i2c_cmd_handle_t cmd = cmd_link_get();
     i2c_master_start(cmd);
     i2c_master_write_byte(cmd, (slave_addr << 1) | I2C_MASTER_READ, ACK_CHECK_EN); // 设备地址
 
@@ -156,9 +338,9 @@ esp_err_t i2c_master_read_slave(i2c_port_t i2c_num, uint8_t slave_addr, uint8_t*
 
     i2c_master_stop(cmd);
     esp_err_t ret = i2c_master_cmd_begin(i2c_num, cmd, ticks_to_wait);
-    i2c_cmd_link_delete(cmd);
+    cmd_link_put(cmd);
 
-    xSemaphoreGive(xSemaphore);
+    xSemaphoreGiveRecursive(xSemaphore);
     return ret;
 }
 
@@ -187,9 +369,9 @@ esp_err_t i2c_master_read_slave_reg(i2c_port_t i2c_num, uint8_t slave_addr, uint
         return ESP_OK;
     }
 
-    xSemaphoreTake(xSemaphore, portMAX_DELAY);
+    xSemaphoreTakeRecursive(xSemaphore, portMAX_DELAY);
 
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+    i2c_cmd_handle_t cmd = cmd_link_get();
     i2c_master_start(cmd);
     i2c_master_write_byte(cmd, (slave_addr << 1) | I2C_MASTER_WRITE, ACK_CHECK_EN); // 设备地址
     i2c_master_write_byte(cmd, reg_addr, ACK_CHECK_EN);
@@ -204,9 +386,9 @@ esp_err_t i2c_master_read_slave_reg(i2c_port_t i2c_num, uint8_t slave_addr, uint
 
     i2c_master_stop(cmd);
     esp_err_t ret = i2c_master_cmd_begin(i2c_num, cmd, ticks_to_wait);
-    i2c_cmd_link_delete(cmd);
+    cmd_link_put(cmd);
 
-    xSemaphoreGive(xSemaphore);
+    xSemaphoreGiveRecursive(xSemaphore);
     return ret;
 }
 
@@ -235,9 +417,9 @@ esp_err_t i2c_master_read_slave_reg_16bit(i2c_port_t i2c_num, uint8_t slave_addr
         return ESP_OK;
     }
 
-    xSemaphoreTake(xSemaphore, portMAX_DELAY);
+    xSemaphoreTakeRecursive(xSemaphore, portMAX_DELAY);
 
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+    i2c_cmd_handle_t cmd = cmd_link_get();
 
     i2c_master_start(cmd);
     i2c_master_write_byte(cmd, (slave_addr << 1) | I2C_MASTER_WRITE, ACK_CHECK_EN); // 设备地址 写入模式
@@ -254,9 +436,9 @@ esp_err_t i2c_master_read_slave_reg_16bit(i2c_port_t i2c_num, uint8_t slave_addr
 
     i2c_master_stop(cmd);
     esp_err_t ret = i2c_master_cmd_begin(i2c_num, cmd, ticks_to_wait);
-    i2c_cmd_link_delete(cmd);
+    cmd_link_put(cmd);
 
-    xSemaphoreGive(xSemaphore);
+    xSemaphoreGiveRecursive(xSemaphore);
     return ret;
 }
 
@@ -279,9 +461,9 @@ esp_err_t i2c_master_write_slave(i2c_port_t i2c_num, uint8_t slave_addr, uint8_t
         return ESP_OK;
     }
 
-    xSemaphoreTake(xSemaphore, portMAX_DELAY);
+    xSemaphoreTakeRecursive(xSemaphore, portMAX_DELAY);
 
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+    i2c_cmd_handle_t cmd = cmd_link_get();
     i2c_master_start(cmd);
     i2c_master_write_byte(cmd, (slave_addr << 1) | I2C_MASTER_WRITE, ACK_CHECK_EN); // 设备地址
 
@@ -289,9 +471,9 @@ esp_err_t i2c_master_write_slave(i2c_port_t i2c_num, uint8_t slave_addr, uint8_t
     i2c_master_stop(cmd);
 
     esp_err_t ret = i2c_master_cmd_begin(i2c_num, cmd, ticks_to_wait);
-    i2c_cmd_link_delete(cmd);
+    cmd_link_put(cmd);
 
-    xSemaphoreGive(xSemaphore);
+    xSemaphoreGiveRecursive(xSemaphore);
     return ret;
 }
 
@@ -319,9 +501,9 @@ esp_err_t i2c_master_write_slave_reg(i2c_port_t i2c_num, uint8_t slave_addr, uin
     if (size == 0) {
         return ESP_OK;
     }
-    xSemaphoreTake(xSemaphore, portMAX_DELAY);
+    xSemaphoreTakeRecursive(xSemaphore, portMAX_DELAY);
 
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+    i2c_cmd_handle_t cmd = cmd_link_get();
     i2c_master_start(cmd);
     i2c_master_write_byte(cmd, (slave_addr << 1) | I2C_MASTER_WRITE, ACK_CHECK_EN); // 设备地址
 
@@ -330,9 +512,51 @@ esp_err_t i2c_master_write_slave_reg(i2c_port_t i2c_num, uint8_t slave_addr, uin
     i2c_master_stop(cmd);
 
     esp_err_t ret = i2c_master_cmd_begin(i2c_num, cmd, ticks_to_wait);
-    i2c_cmd_link_delete(cmd);
+    cmd_link_put(cmd);
+
+    xSemaphoreGiveRecursive(xSemaphore);
+    return ret;
+}
+
+/**
+ * @brief  I2Cx-写从设备的寄存器值（寄存器地址 或 命令 为2字节的器件）
+ *      - 适用于 MLX90640 这种寄存器地址为16位的I2C设备
+ *      - 例：i2c_master_write_slave_reg_16bit(I2C_NUM_0, 0x33, 0x8000, data, 2, 100 / portTICK_RATE_MS);
+ *
+ * ___________________________________________________________________________________________
+ * | start | slave_addr + wr_bit + ack | reg_addr(2byte) + ack | write n bytes + ack  | stop |
+ * --------|---------------------------|-----------------------|----------------------|------|
+ *
+ * @param  i2c_num I2C端口号。I2C_NUM_0 / I2C_NUM_1
+ * @param  slave_addr I2C写从机的器件地址
+ * @param  reg_addr I2C写从机的寄存器地址(2byte)
+ * @param  data_wr 写入的值的指针，存放写入进的数据
+ * @param  size 写入的字节数
+ * @param  ticks_to_wait 超时等待时间
+ *
+ * @return
+ *     - esp_err_t
+ */
+esp_err_t i2c_master_write_slave_reg_16bit(i2c_port_t i2c_num, uint8_t slave_addr, uint16_t reg_addr, uint8_t* data_wr, size_t size, TickType_t ticks_to_wait)
+{
+    if (size == 0) {
+        return ESP_OK;
+    }
+    xSemaphoreTakeRecursive(xSemaphore, portMAX_DELAY);
+
+    i2c_cmd_handle_t cmd = cmd_link_get();
+    i2c_master_start(cmd);
+    i2c_master_write_byte(cmd, (slave_addr << 1) | I2C_MASTER_WRITE, ACK_CHECK_EN); // 设备地址
+
+    i2c_master_write_byte(cmd, reg_addr >> 8, ACK_CHECK_EN); // 寄存器地址
+    i2c_master_write_byte(cmd, reg_addr & 0xFF, ACK_CHECK_EN); // 寄存器地址
+    i2c_master_write(cmd, data_wr, size, ACK_CHECK_EN); // 数据
+    i2c_master_stop(cmd);
+
+    esp_err_t ret = i2c_master_cmd_begin(i2c_num, cmd, ticks_to_wait);
+    cmd_link_put(cmd);
 
-    xSemaphoreGive(xSemaphore);
+    xSemaphoreGiveRecursive(xSemaphore);
     return ret;
 }
 
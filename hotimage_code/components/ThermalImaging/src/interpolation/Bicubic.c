@@ -0,0 +1,181 @@
+#include "IDW.h"
+#include <string.h>
+
+// 双三次插值 (Catmull-Rom) 整数倍放大
+// 放大倍数固定 每个输出像素在源像素内的相位只有 scale 种 4 个权重预先按相位计算好
+// 先垂直插值出一行 (两边各扩展 2 个像素 水平插值时不需要判断边界) 再水平插值 两遍都是定点运算
+#define BICUBIC_PAD 2 // 每行两边扩展的像素数
+#define BICUBIC_ROW_SHIFT 2 // 垂直方向结果保留 2 位小数 Catmull-Rom 有负权重 全范围 int16 输入水平方向累加也不会溢出
+
+/**
+ * @brief 计算一个相位的 Catmull-Rom 权重 Q12 四个权重之和正好是 IDW_BICUBIC_ONE
+ *
+ * @param pPhase
+ * @param t 插值点到第二个源像素的距离 0 ~ 1
+ */
+static void bicubic_build_phase(sIdwBicubicPhase* pPhase, float t)
+{
+    const float t2 = t * t;
+    const float t3 = t2 * t;
+    const float w[4] = {
+        (-t3 + 2 * t2 - t) * 0.5f,
+        (3 * t3 - 5 * t2 + 2) * 0.5f,
+        (-3 * t3 + 4 * t2 + t) * 0.5f,
+        (t3 - t2) * 0.5f,
+    };
+    int32_t sum = 0;
+    int maxIdx = 1;
+
+    for (int i = 0; i < 4; i++) {
+        pPhase->weight[i] = (int16_t)lroundf(w[i] * IDW_BICUBIC_ONE);
+        sum += pPhase->weight[i];
+        if (w[i] > w[maxIdx]) {
+            maxIdx = i;
+        }
+    }
+
+    // 四舍五入的误差补到最大的权重上 平坦区域不会偏色
+    pPhase->weight[maxIdx] += IDW_BICUBIC_ONE - sum;
+}
+
+/**
+ * @brief 初始化双三次插值 按像素中心对齐 预先计算每个相位的权重
+ *
+ * @param pBicubic
+ * @param srcWidth 源图像宽 2 ~ IDW_SCALER_MAX_SRC
+ * @param srcHeight 源图像高 至少 2
+ * @param scale 放大倍数 1 ~ IDW_BICUBIC_MAX_SCALE
+ * @return int 0=成功 -1=参数错误
+ */
+int idwBicubicInit(sIdwBicubic* pBicubic, uint16_t srcWidth, uint16_t srcHeight, uint16_t scale)
+{
+    memset(pBicubic, 0, sizeof(sIdwBicubic));
+
+    if (srcWidth < 2 || srcWidth > IDW_SCALER_MAX_SRC || srcHeight < 2 || 0 == scale || scale > IDW_BICUBIC_MAX_SCALE) {
+        return -1;
+    }
+
+    pBicubic->srcWidth = srcWidth;
+    pBicubic->srcHeight = srcHeight;
+    pBicubic->scale = scale;
+
+    for (uint16_t p = 0; p < scale; p++) {
+        // 输出像素中心对应的源坐标 (相对本源像素中心)
+        float t = (p + 0.5f) / scale - 0.5f;
+
+        // 在本源像素中心的左边(上边) 4 个源像素从 -2 开始 否则从 -1 开始
+        if (t < 0) {
+            t += 1.0f;
+            pBicubic->phase[p].offset = 0;
+        } else {
+            pBicubic->phase[p].offset = 1;
+        }
+        bicubic_build_phase(&pBicubic->phase[p], t);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief 垂直方向插值 输出行 y 对应的一行数据 Q2 两边各扩展 BICUBIC_PAD 个像素
+ *
+ * @param pBicubic
+ * @param pSrc 源图像
+ * @param y 输出行
+ * @param pRow srcWidth + BICUBIC_PAD * 2 个 Q2 数据
+ */
+static inline void bicubic_vertical(const sIdwBicubic* pBicubic, const int16_t* pSrc, uint16_t y, int32_t* pRow)
+{
+    const uint16_t w = pBicubic->srcWidth;
+    const sIdwBicubicPhase* pPhase = &pBicubic->phase[y % pBicubic->scale];
+    const int16_t* pRows[4];
+    int32_t sy = y / pBicubic->scale + pPhase->offset - BICUBIC_PAD;
+
+    // 上下边缘取最近的行
+    for (int k = 0; k < 4; k++, sy++) {
+        int32_t clamped = sy < 0 ? 0 : (sy >= pBicubic->srcHeight ? pBicubic->srcHeight - 1 : sy);
+        pRows[k] = pSrc + clamped * w;
+    }
+
+    const int32_t w0 = pPhase->weight[0], w1 = pPhase->weight[1], w2 = pPhase->weight[2], w3 = pPhase->weight[3];
+    const int32_t round = 1 << (IDW_BICUBIC_SHIFT - BICUBIC_ROW_SHIFT - 1);
+    int32_t* pOut = pRow + BICUBIC_PAD;
+    for (uint16_t x = 0; x < w; x++) {
+        pOut[x] = (pRows[0][x] * w0 + pRows[1][x] * w1 + pRows[2][x] * w2 + pRows[3][x] * w3 + round) >> (IDW_BICUBIC_SHIFT - BICUBIC_ROW_SHIFT);
+    }
+
+    // 左右边缘取最近的像素
+    pRow[0] = pRow[1] = pOut[0];
+    pOut[w] = pOut[w + 1] = pOut[w - 1];
+}
+
+/**
+ * @brief 水平方向插值 一个输出像素 Q2 * Q12 四舍五入
+ *
+ */
+#define BICUBIC_HORIZONTAL(pTap, pPhase) \
+    ((int16_t)(((pTap)[0] * (pPhase)->weight[0] + (pTap)[1] * (pPhase)->weight[1] + (pTap)[2] * (pPhase)->weight[2] + (pTap)[3] * (pPhase)->weight[3] + (1 << (IDW_BICUBIC_SHIFT + BICUBIC_ROW_SHIFT - 1))) >> (IDW_BICUBIC_SHIFT + BICUBIC_ROW_SHIFT)))
+
+/**
+ * @brief 双三次插值 放大 scale 倍 只计算输出图像的 [rowStart, rowEnd) 行 各行之间互不依赖 可以分段并行计算
+ *
+ * @param pBicubic idwBicubicInit 初始化的权重表
+ * @param pSrc 源图像
+ * @param pDest 输出图像 (srcWidth * scale) x (srcHeight * scale) 的第 rowStart 行 可以只是一段的缓存
+ * @param rowStart 输出起始行
+ * @param rowEnd 输出结束行(不包含)
+ */
+void idwBicubicRows(const sIdwBicubic* pBicubic, const int16_t* pSrc, int16_t* pDest, uint16_t rowStart, uint16_t rowEnd)
+{
+    const uint16_t destWidth = pBicubic->srcWidth * pBicubic->scale;
+    int32_t row[IDW_SCALER_MAX_SRC + BICUBIC_PAD * 2];
+
+    for (uint16_t y = rowStart; y < rowEnd; y++) {
+        int16_t* pOut = pDest + (y - rowStart) * destWidth;
+
+        bicubic_vertical(pBicubic, pSrc, y, row);
+        // 按相位处理 同一相位的权重放在寄存器里
+        for (uint16_t p = 0; p < pBicubic->scale; p++) {
+            const sIdwBicubicPhase phase = pBicubic->phase[p];
+            const int32_t* pTap = row + phase.offset;
+            int16_t* pPix = pOut + p;
+
+            for (uint16_t sx = 0; sx < pBicubic->srcWidth; sx++, pTap++, pPix += pBicubic->scale) {
+                *pPix = BICUBIC_HORIZONTAL(pTap, &phase);
+            }
+        }
+    }
+}
+
+/**
+ * @brief 双三次插值 + 伪彩色 直接写入显存 只计算输出图像的 [rowStart, rowEnd) 行
+ *        输出水平镜像 (和热成像的显示方向一致) 结果和 idwBicubicRows + 查表 完全相同
+ *
+ * @param pBicubic idwBicubicInit 初始化的权重表
+ * @param pSrc 源图像
+ * @param pFrame 显存中第 rowStart 行的地址 一行 srcWidth * scale 个像素
+ * @param pMap 插值结果 -> 伪彩色 的映射
+ * @param rowStart 输出起始行
+ * @param rowEnd 输出结束行(不包含)
+ */
+void idwBicubicPaletteRows(const sIdwBicubic* pBicubic, const int16_t* pSrc, uint16_t* pFrame, const sPaletteMap* pMap, uint16_t rowStart, uint16_t rowEnd)
+{
+    const uint16_t destWidth = pBicubic->srcWidth * pBicubic->scale;
+    int32_t row[IDW_SCALER_MAX_SRC + BICUBIC_PAD * 2];
+
+    for (uint16_t y = rowStart; y < rowEnd; y++) {
+        uint16_t* pOut = pFrame + (y - rowStart + 1) * destWidth - 1; // 镜像 从行尾往前写
+
+        bicubic_vertical(pBicubic, pSrc, y, row);
+        // 按相位处理 同一相位的权重放在寄存器里
+        for (uint16_t p = 0; p < pBicubic->scale; p++) {
+            const sIdwBicubicPhase phase = pBicubic->phase[p];
+            const int32_t* pTap = row + phase.offset;
+            uint16_t* pPix = pOut - p;
+
+            for (uint16_t sx = 0; sx < pBicubic->srcWidth; sx++, pTap++, pPix -= pBicubic->scale) {
+                *pPix = palette_color(pMap, BICUBIC_HORIZONTAL(pTap, &phase));
+            }
+        }
+    }
+}
@@ -1,69 +1,152 @@
 #include "IDW.h"
 #include "esp_log.h"
+#include <string.h>
 
-// 设置指定像素的颜色值
-static inline void set_point(int16_t* pSrc, uint16_t width, uint16_t height, int16_t x, int16_t y, float f)
+/**
+ * @brief 生成一个方向的源坐标和Q8权重表
+ *        目标坐标 i 对应源坐标 i * src / dst, 最后一个源像素用 (src - 2, 256) 表示 插值时不需要判断边界
+ *
+ * @param pIdx 源坐标 每个目标像素一个
+ * @param pWeight 右边(下边)源像素的权重 Q8 0~256
+ * @param srcSize 源尺寸
+ * @param destSize 目标尺寸
+ */
+static void scaler_build_table(uint16_t* pIdx, uint16_t* pWeight, uint16_t srcSize, uint16_t destSize)
 {
-    pSrc[y * width + x] = (int16_t)f;
+    for (uint32_t i = 0; i < destSize; i++) {
+        uint32_t pos = i * srcSize;
+        uint16_t idx = pos / destSize;
+        uint16_t weight = ((pos % destSize) * IDW_SCALER_ONE + (destSize >> 1)) / destSize;
+
+        if (idx >= srcSize - 1) {
+            idx = srcSize - 2;
+            weight = IDW_SCALER_ONE;
+        }
+
+        pIdx[i] = idx;
+        pWeight[i] = weight;
+    }
 }
 
-// 获取指定像素的颜色值
-static float bilinear_get_point(const float* p, uint8_t width, uint8_t height, int8_t x, int8_t y)
+/**
+ * @brief 初始化定点双线性缩放 预先计算每列 每行的源坐标和权重
+ *
+ * @param pScaler
+ * @param srcWidth 源图像宽 2 ~ IDW_SCALER_MAX_SRC
+ * @param srcHeight 源图像高 至少 2
+ * @param destWidth 输出图像宽
+ * @param destHeight 输出图像高
+ * @return int 0=成功 -1=参数错误 -2=内存不足
+ */
+int idwScalerInit(sIdwScaler* pScaler, uint16_t srcWidth, uint16_t srcHeight, uint16_t destWidth, uint16_t destHeight)
 {
-    if (x >= width) {
-        x = width - 1;
+    memset(pScaler, 0, sizeof(sIdwScaler));
+
+    if (srcWidth < 2 || srcWidth > IDW_SCALER_MAX_SRC || srcHeight < 2 || 0 == destWidth || 0 == destHeight) {
+        return -1;
     }
 
-    if (y >= height) {
-        y = height - 1;
+    pScaler->pXIdx = malloc((destWidth + destHeight) * 2 * sizeof(uint16_t));
+    if (NULL == pScaler->pXIdx) {
+        return -2;
     }
-    return p[y * width + x];
+    pScaler->pXWeight = pScaler->pXIdx + destWidth;
+    pScaler->pYIdx = pScaler->pXWeight + destWidth;
+    pScaler->pYWeight = pScaler->pYIdx + destHeight;
+
+    pScaler->srcWidth = srcWidth;
+    pScaler->srcHeight = srcHeight;
+    pScaler->destWidth = destWidth;
+    pScaler->destHeight = destHeight;
+
+    scaler_build_table(pScaler->pXIdx, pScaler->pXWeight, srcWidth, destWidth);
+    scaler_build_table(pScaler->pYIdx, pScaler->pYWeight, srcHeight, destHeight);
+
+    return 0;
 }
 
-// 将4个像素融合在一起
-static float bilinear_interpolate(const float p[], float x, float y)
+/**
+ * @brief 释放 idwScalerInit 分配的表
+ *
+ * @param pScaler
+ */
+void idwScalerFree(sIdwScaler* pScaler)
 {
-    float xx = p[1] * x + p[0] * (1.f - x);
-    float xy = p[3] * x + p[2] * (1.f - x);
-    return xy * y + xx * (1.f - y);
+    free(pScaler->pXIdx);
+    memset(pScaler, 0, sizeof(sIdwScaler));
 }
 
-// 得到4个像素值
-static void bilinear_get_adjacents_2d(const float* pSrc, float* pDest, uint8_t src_gauss_width, uint8_t src_gauss_height, int8_t x, int8_t y)
+/**
+ * @brief 垂直方向插值 输出行 y 对应的一行源数据 Q8
+ *
+ * @param pScaler
+ * @param pSrc 源图像
+ * @param y 输出行
+ * @param pRow 一行 srcWidth 个 Q8 数据
+ */
+static inline void scaler_vertical(const sIdwScaler* pScaler, const int16_t* pSrc, uint16_t y, int32_t* pRow)
 {
-    pDest[0] = bilinear_get_point(pSrc, src_gauss_width, src_gauss_height, x + 0, y + 0); // 原点
-    pDest[1] = bilinear_get_point(pSrc, src_gauss_width, src_gauss_height, x + 1, y + 0); // 右边
-    pDest[2] = bilinear_get_point(pSrc, src_gauss_width, src_gauss_height, x + 0, y + 1); // 上边
-    pDest[3] = bilinear_get_point(pSrc, src_gauss_width, src_gauss_height, x + 1, y + 1); // 右下
+    const int16_t* pRow0 = pSrc + pScaler->pYIdx[y] * pScaler->srcWidth;
+    const int16_t* pRow1 = pRow0 + pScaler->srcWidth;
+    const int32_t wy = pScaler->pYWeight[y];
+
+    for (uint16_t x = 0; x < pScaler->srcWidth; x++) {
+        pRow[x] = pRow0[x] * IDW_SCALER_ONE + (pRow1[x] - pRow0[x]) * wy;
+    }
 }
 
 /**
- * @brief 双线性插值
+ * @brief 水平方向插值 一个输出像素 Q8 * Q8 四舍五入
  *
- * @param pSrcGaussBuf 高斯模糊地址
- * @param src_gauss_width 高斯模糊宽
- * @param src_gauss_height 高斯模糊高
- * @param pDest 输出图像地址
- * @param dest_width 输出图像宽
- * @param dest_height 输出图像高
- * @param upScaleFactor 比例因子
  */
-void idwBilinear(const float* pSrcGaussBuf, uint8_t src_gauss_width, uint8_t src_gauss_height, int16_t* pDest, uint16_t dest_width, uint16_t dest_height, uint8_t upScaleFactor)
+#define SCALER_HORIZONTAL(pScaler, pRow, x) \
+    ((int16_t)((((pRow)[(pScaler)->pXIdx[x]] * IDW_SCALER_ONE) + ((pRow)[(pScaler)->pXIdx[x] + 1] - (pRow)[(pScaler)->pXIdx[x]]) * (int32_t)(pScaler)->pXWeight[x] + (1 << (IDW_SCALER_SHIFT * 2 - 1))) >> (IDW_SCALER_SHIFT * 2)))
+
+/**
+ * @brief 定点双线性缩放 只计算输出图像的 [rowStart, rowEnd) 行 各行之间互不依赖 可以分段并行计算
+ *        每行先垂直插值出一行源宽度的数据 再水平插值 只需要一行源宽度的临时数据
+ *
+ * @param pScaler idwScalerInit 初始化的缩放表
+ * @param pSrc 源图像
+ * @param pDest 输出图像的第 rowStart 行 可以只是一段的缓存
+ * @param rowStart 输出起始行
+ * @param rowEnd 输出结束行(不包含)
+ */
+void idwScaleRows(const sIdwScaler* pScaler, const int16_t* pSrc, int16_t* pDest, uint16_t rowStart, uint16_t rowEnd)
 {
-    const float mu = 1.f / upScaleFactor;
-    float adj_2d[4]; // 存储相邻矩阵
+    int32_t row[IDW_SCALER_MAX_SRC];
 
-    for (uint16_t y_idx = 0; y_idx < dest_height; y_idx++) {
-        for (uint16_t x_idx = 0; x_idx < dest_width; x_idx++) {
-            float x = x_idx * mu;
-            float y = y_idx * mu;
-            bilinear_get_adjacents_2d(pSrcGaussBuf, adj_2d, src_gauss_width, src_gauss_height, (int8_t)x, (int8_t)y);
+    for (uint16_t y = rowStart; y < rowEnd; y++) {
+        int16_t* pOut = pDest + (y - rowStart) * pScaler->destWidth;
 
-            float frac_x = x - (int)x; // 我们只需要点之间的~delta~
-            float frac_y = y - (int)y; // 我们只需要点之间的~delta~
-            float out = bilinear_interpolate(adj_2d, frac_x, frac_y);
+        scaler_vertical(pScaler, pSrc, y, row);
+        for (uint16_t x = 0; x < pScaler->destWidth; x++) {
+            pOut[x] = SCALER_HORIZONTAL(pScaler, row, x);
+        }
+    }
+}
 
-            set_point(pDest, dest_width, dest_height, x_idx, y_idx, out);
+/**
+ * @brief 定点双线性缩放 + 伪彩色 直接写入显存 只计算输出图像的 [rowStart, rowEnd) 行
+ *        输出水平镜像 (和热成像的显示方向一致) 结果和 idwScaleRows + 查表 完全相同
+ *
+ * @param pScaler idwScalerInit 初始化的缩放表
+ * @param pSrc 源图像
+ * @param pFrame 显存中第 rowStart 行的地址 一行 destWidth 个像素
+ * @param pMap 插值结果 -> 伪彩色 的映射
+ * @param rowStart 输出起始行
+ * @param rowEnd 输出结束行(不包含)
+ */
+void idwScalePaletteRows(const sIdwScaler* pScaler, const int16_t* pSrc, uint16_t* pFrame, const sPaletteMap* pMap, uint16_t rowStart, uint16_t rowEnd)
+{
+    int32_t row[IDW_SCALER_MAX_SRC];
+
+    for (uint16_t y = rowStart; y < rowEnd; y++) {
+        uint16_t* pOut = pFrame + (y - rowStart + 1) * pScaler->destWidth - 1; // 镜像 从行尾往前写
+
+        scaler_vertical(pScaler, pSrc, y, row);
+        for (uint16_t x = 0; x < pScaler->destWidth; x++, pOut--) {
+            *pOut = palette_color(pMap, SCALER_HORIZONTAL(pScaler, row, x));
         }
     }
 }
@@ -96,128 +179,256 @@ void dumpLineData(int16_t lineNo, int16_t* pSrcImage, int16_t* pHDImage, int16_t
 }
 #endif
 
+// 线性插值的增量计算 (DDA)
+// 分子每步加一个常数 商和余数跟着累加 不需要每个像素做除法
+// 商按向下取整保存 余数 0 ~ n-1, 输出时转换成 C 语言的向零取整 和原来的除法结果完全相同
+typedef struct
+{
+    int16_t q; // 分子 / n 向下取整
+    int16_t dq; // 每步 商的增量
+    uint8_t r; // 余数
+    uint8_t dr; // 每步 余数的增量
+} sLinearDDA;
+
 /**
- * @brief 老双线性插值
- *
- * @param src 输入图像地址
- * @param src_rows 宽
- * @param src_cols 高
- * @param steps 缩放倍数
- * @param pHdImage 输出图像地址
- */
-void idwOldInterpolate(int16_t* pSrcImage, uint16_t srcWidth, uint16_t srcHeight, uint16_t scale, int16_t* pHDImageOut)
-{
-
-    const uint16_t scaleWidth = srcWidth * scale; // 一行LCD像素个数 = 原始宽度 * 放大比例
-
-    /*
-                      0 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16 17 18 19 20 ...... 317 318 319    共320列
-    第 00 行 插值     0~9=pSrcImage[0][0-1插值]，  10~19=pSrcImage[0][1-2插值]，  20~29=pSrcImage[0][2-3插值]， ....... 31=pSrcImage[0][319]
-    第 yy 行 不处理
-    第 10 行 插值     0~9=pSrcImage[1][0-1插值]，  10~19=pSrcImage[1][1-2插值]，  20~29=pSrcImage[1][2-3插值]， .......
-    第 yy 行 不处理
-    第 20 行 插值     0~9=pSrcImage[2][0-1插值]，  10~19=pSrcImage[2][1-2插值]，  20~29=pSrcImage[2][2-3插值]， .......
-    第 yy 行 不处理
-    第 30 行 插值     0~9=pSrcImage[3][0-1插值]，  10~19=pSrcImage[3][1-2插值]，  20~29=pSrcImage[3][2-3插值]， .......
-    第 yy 行 不处理
-    第 x0 行 插值
-    第 yy 行 不处理
-    第230 行 插值     0~9=pSrcImage[22][0-1插值]， 10~19=pSrcImage[22][1-2插值]， 20~29=pSrcImage[22][2-3插值]， .......
-    第 yy 行 不处理
-    第239 行 插值     0~9=pSrcImage[23][0-1插值]， 10~19=pSrcImage[23][1-2插值]， 20~29=pSrcImage[23][2-3插值]， .......
-    共240行
-     */
-    // 计算分布到每行的次数
-    const uint16_t distributedX = scaleWidth - ((srcWidth - 1) * scale) - 1;
-    const uint16_t distributedY = (srcHeight * scale) - ((srcHeight - 1) * scale) - 1;
-
-    // 先插值每行的数据
-    int32_t offsetY = 0;
-    uint16_t _newSrcWidth = srcWidth - 1;
-    for (uint16_t _h = 0; _h < srcHeight; _h++) { // 高度24行
-        // 得到原始像素偏移
-        uint16_t baseS = _h * srcWidth; // 第几行 * 一行像素个数 = 原始温度位置
-
-        // 计算目标地址      例: 0~319  3200~3519  6400~6719  9600~9919
-        // 每隔scale行计算一次 0-10-20-30  一共计算srcHeight次
-        uint32_t offsetX = 0;
-        if (_h == (srcHeight - 1)) {
-            // 最后一行
-            offsetX = (srcHeight * scale) * scaleWidth - scaleWidth;
-        } else {
-            offsetX = (_h * scale * scaleWidth) + offsetY;
+ * @brief 初始化 分子从 q * n 开始 每步加 step
+ *
+ * @param pDDA
+ * @param q 初始的商
+ * @param step 分子每步的增量
+ * @param n 除数
+ */
+static inline void linear_dda_init(sLinearDDA* pDDA, int16_t q, int32_t step, int32_t n)
+{
+    int32_t dq = step / n;
+    int32_t dr = step % n;
+
+    if (dr < 0) {
+        dr += n;
+        dq--;
+    }
+
+    pDDA->q = q;
+    pDDA->r = 0;
+    pDDA->dq = dq;
+    pDDA->dr = dr;
+}
+
+/**
+ * @brief 前进一步 返回 分子 / n (向零取整)
+ *
+ * @param pDDA
+ * @param n 除数
+ * @return int16_t
+ */
+static inline int16_t linear_dda_step(sLinearDDA* pDDA, int32_t n)
+{
+    int32_t r = pDDA->r + pDDA->dr;
+    int32_t carry = (r >= n);
+    int32_t q = pDDA->q + pDDA->dq + carry;
+
+    r -= carry * n;
+    pDDA->q = q;
+    pDDA->r = r;
+
+    return q + ((q < 0) & (r != 0));
+}
+
+/**
+ * @brief 初始化分段线性插值 (线性插值模式) 结果和原来的 idwOldInterpolate 完全相同
+ *        每行 srcWidth * scale 列分给 srcWidth - 1 段, 多出的列从第一段开始每段多分一列
+ *        第一行到最后一行之间的 srcHeight * scale - 1 行分给 srcHeight - 1 段, 多出的行同样从第一段开始分配
+ *
+ * @param pLinear
+ * @param srcWidth 源图像宽 2 ~ IDW_LINEAR_MAX_SRC
+ * @param srcHeight 源图像高 2 ~ IDW_LINEAR_MAX_SRC
+ * @param scale 放大倍数 srcWidth * scale 不超过 IDW_LINEAR_MAX_WIDTH
+ * @return int 0=成功 -1=参数错误
+ */
+int idwLinearInit(sIdwLinear* pLinear, uint16_t srcWidth, uint16_t srcHeight, uint16_t scale)
+{
+    memset(pLinear, 0, sizeof(sIdwLinear));
+
+    if (srcWidth < 2 || srcWidth > IDW_LINEAR_MAX_SRC || srcHeight < 2 || srcHeight > IDW_LINEAR_MAX_SRC || 0 == scale || srcWidth * scale > IDW_LINEAR_MAX_WIDTH) {
+        return -1;
+    }
+
+    pLinear->srcWidth = srcWidth;
+    pLinear->srcHeight = srcHeight;
+    pLinear->scale = scale;
+
+    for (uint16_t w = 0; w < srcWidth - 1; w++) {
+        uint16_t count = scale + scale / (srcWidth - 1) + (w < scale % (srcWidth - 1));
+
+        // 增量计算的余数用 uint8_t 保存
+        if (count >= 128) {
+            return -1;
         }
+        pLinear->colCount[w] = count;
+    }
 
-        // 插值一行数据  32 -> 320
-        for (uint16_t _w = 0; _w < _newSrcWidth; _w++) { // 宽度 一行有32列
-            // 得到左右相邻的2个温度
-            int16_t tempStart = pSrcImage[baseS + _w];
-            int16_t tempEnd = pSrcImage[baseS + _w + 1];
+    pLinear->keyRow[0] = 0;
+    for (uint16_t h = 0; h < srcHeight - 1; h++) {
+        uint16_t gap = scale + (scale - 1) / (srcHeight - 1) + (h < (scale - 1) % (srcHeight - 1));
 
-            int16_t _newScale = scale;
-            if (_w <= distributedX) {
-                _newScale++;
-            }
+        if (gap >= 128) {
+            return -1;
+        }
+        pLinear->keyRow[h + 1] = pLinear->keyRow[h] + gap;
+    }
 
-            // 开始插值计算
-            for (uint16_t _s = 0; _s < _newScale; _s++) {
-                pHDImageOut[offsetX + _s] = (tempStart * (_newScale - _s) + tempEnd * _s) / _newScale;
-            }
-            offsetX += _newScale;
+    return 0;
+}
+
+/**
+ * @brief 水平插值一个源行 输出 srcWidth * scale 个像素
+ *
+ * @param pLinear
+ * @param pSrcRow 源图像的一行
+ * @param pOut
+ */
+static void linear_horizontal(const sIdwLinear* pLinear, const int16_t* pSrcRow, int16_t* pOut)
+{
+    for (uint16_t w = 0; w < pLinear->srcWidth - 1; w++) {
+        const int16_t tempStart = pSrcRow[w];
+        const int16_t tempEnd = pSrcRow[w + 1];
+        const uint8_t n = pLinear->colCount[w];
+        sLinearDDA dda;
+
+        linear_dda_init(&dda, tempStart, tempEnd - tempStart, n);
+        *pOut++ = tempStart;
+        for (uint16_t s = 1; s < n; s++) {
+            *pOut++ = linear_dda_step(&dda, n);
         }
+    }
+}
+
+/**
+ * @brief 除以 n 的倒数 ceil(2^32 / n) n = 2 ~ 127
+ *
+ */
+#define LINEAR_RECIP(n) ((uint32_t)(0xFFFFFFFFu / (n)) + 1)
+
+/**
+ * @brief x / n 向零取整 用乘倒数代替除法 |x| < 2^22 时和除法结果完全相同
+ *
+ * @param x
+ * @param recip LINEAR_RECIP(n)
+ * @return int32_t
+ */
+static inline int32_t linear_div(int32_t x, uint32_t recip)
+{
+    uint32_t ax = x < 0 ? -x : x;
+    int32_t q = ((uint64_t)ax * recip) >> 32;
+
+    return x < 0 ? -q : q;
+}
 
-        // 计算前几行要分布的偏移
-        if (_h < distributedY) {
-            offsetY += scaleWidth;
+// 分段线性插值一段输出行时的状态 上下两个已经水平插值的源行
+typedef struct
+{
+    int16_t top[IDW_LINEAR_MAX_WIDTH];
+    int16_t bottom[IDW_LINEAR_MAX_WIDTH];
+    int16_t seg; // top 对应的源行 -1=还没有计算
+} sLinearBand;
+
+/**
+ * @brief 找到输出行 y 所在的段 需要时重新水平插值上下两个源行
+ *        最后一行属于最后一段
+ *
+ * @param pLinear
+ * @param pSrc 源图像
+ * @param y 输出行
+ * @param pBand
+ * @return uint16_t 段内的行号 0=top 段的行数=bottom
+ */
+static uint16_t linear_band_seek(const sIdwLinear* pLinear, const int16_t* pSrc, uint16_t y, sLinearBand* pBand)
+{
+    int16_t seg = pBand->seg < 0 ? 0 : pBand->seg;
+
+    while (seg + 2 < pLinear->srcHeight && y >= pLinear->keyRow[seg + 1]) {
+        seg++;
+    }
+
+    if (seg != pBand->seg) {
+        if (pBand->seg >= 0 && seg == pBand->seg + 1) {
+            memcpy(pBand->top, pBand->bottom, sizeof(pBand->top));
+        } else {
+            linear_horizontal(pLinear, pSrc + seg * pLinear->srcWidth, pBand->top);
         }
+        linear_horizontal(pLinear, pSrc + (seg + 1) * pLinear->srcWidth, pBand->bottom);
+        pBand->seg = seg;
     }
 
-    /*
-    将上面最后9行分布到前面几行中，每个各分配1行，凑满9行
-    0 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16 17 18 19 20 ...... 317 318 319    共320列
-    第 00 行 插值     0~9=pSrcImage[0][0-1插值]，  10~19=pSrcImage[0][1-2插值]，  20~29=pSrcImage[0][2-3插值]， .......
-    第 yy 行   现在处理 一列一列进行处理
-    第 10 行 插值     0~9=pSrcImage[1][0-1插值]，  10~19=pSrcImage[1][1-2插值]，  20~29=pSrcImage[1][2-3插值]， .......
-    第 yy 行   现在处理 一列一列进行处理
-    第 20 行 插值     0~9=pSrcImage[2][0-1插值]，  10~19=pSrcImage[2][1-2插值]，  20~29=pSrcImage[2][2-3插值]， .......
-    第 yy 行   现在处理 一列一列进行处理
-    第 30 行 插值     0~9=pSrcImage[3][0-1插值]，  10~19=pSrcImage[3][1-2插值]，  20~29=pSrcImage[3][2-3插值]， .......
-    第 yy 行   现在处理 一列一列进行处理
-    第 x0 行 插值
-    第 yy 行   现在处理 一列一列进行处理
-    第230 行 插值     0~9=pSrcImage[22][0-1插值]， 10~19=pSrcImage[22][1-2插值]， 20~29=pSrcImage[22][2-3插值]， .......
-    第 yy 行   现在处理 一列一列进行处理
-    第239 行 插值     0~9=pSrcImage[23][0-1插值]， 10~19=pSrcImage[23][1-2插值]， 20~29=pSrcImage[23][2-3插值]， .......
-    共240行
-     */
-    // 插值2行之间的数据
-    uint16_t _newScale; // 可以认为是写入的行数
-    uint16_t _newSrcHeight = srcHeight - 1;
-    int32_t _s = 0, _n = 0;
-
-    for (uint16_t _w = 0; _w < scaleWidth; _w++) { // 320列
-        _s = _n = _w;
-
-        for (uint16_t _h = 0; _h < _newSrcHeight; _h++) { // 24行
-            // 计算2行的偏移位置
-            _s = _n;
-
-            if (_h < distributedY) {
-                _n += scaleWidth * scale + scaleWidth;
-                _newScale = scale + 1;
-            } else {
-                _n += scaleWidth * scale;
-                _newScale = scale;
+    return y - pLinear->keyRow[seg];
+}
+
+/**
+ * @brief 分段线性插值 只计算输出图像的 [rowStart, rowEnd) 行 各行之间互不依赖 可以分段并行计算
+ *        每段开始时水平插值上下两个源行 中间的行 top * (n - s) / n + bottom * s / n 两项分别向零取整
+ *        结果和原来的 idwOldInterpolate 完全相同 但不需要整幅的输出缓存
+ *
+ * @param pLinear idwLinearInit 初始化的分段表
+ * @param pSrc 源图像
+ * @param pDest 输出图像 (srcWidth * scale) x (srcHeight * scale) 的第 rowStart 行 可以只是一段的缓存
+ * @param rowStart 输出起始行
+ * @param rowEnd 输出结束行(不包含)
+ */
+void idwLinearRows(const sIdwLinear* pLinear, const int16_t* pSrc, int16_t* pDest, uint16_t rowStart, uint16_t rowEnd)
+{
+    const uint16_t destWidth = pLinear->srcWidth * pLinear->scale;
+    sLinearBand band;
+
+    band.seg = -1;
+    for (uint16_t y = rowStart; y < rowEnd; y++) {
+        int16_t* pOut = pDest + (y - rowStart) * destWidth;
+        const uint16_t s = linear_band_seek(pLinear, pSrc, y, &band);
+        const uint16_t n = pLinear->keyRow[band.seg + 1] - pLinear->keyRow[band.seg];
+
+        if (0 == s) {
+            memcpy(pOut, band.top, destWidth * sizeof(int16_t));
+        } else if (n == s) {
+            memcpy(pOut, band.bottom, destWidth * sizeof(int16_t));
+        } else {
+            const uint32_t recip = LINEAR_RECIP(n);
+            for (uint16_t x = 0; x < destWidth; x++) {
+                pOut[x] = linear_div(band.top[x] * (n - s), recip) + linear_div(band.bottom[x] * s, recip);
             }
+        }
+    }
+}
 
-            // 得到2行之间的温度
-            int16_t tempStart = pHDImageOut[_s]; // 行 * 10 * 320 + 列
-            int16_t tempEnd = pHDImageOut[_n]; // 下一行
+/**
+ * @brief 分段线性插值 + 伪彩色 直接写入显存 只计算输出图像的 [rowStart, rowEnd) 行
+ *        输出水平镜像 (和热成像的显示方向一致) 结果和 idwLinearRows + 查表 完全相同
+ *
+ * @param pLinear idwLinearInit 初始化的分段表
+ * @param pSrc 源图像
+ * @param pFrame 显存中第 rowStart 行的地址 一行 srcWidth * scale 个像素
+ * @param pMap 插值结果 -> 伪彩色 的映射
+ * @param rowStart 输出起始行
+ * @param rowEnd 输出结束行(不包含)
+ */
+void idwLinearPaletteRows(const sIdwLinear* pLinear, const int16_t* pSrc, uint16_t* pFrame, const sPaletteMap* pMap, uint16_t rowStart, uint16_t rowEnd)
+{
+    const uint16_t destWidth = pLinear->srcWidth * pLinear->scale;
+    sLinearBand band;
 
-            // outputDebug("%d %08X %08X %x %x\r\n", _h, pHDImageOut + _s, pHDImageOut + _n, tempStart, tempEnd);
-            for (uint16_t _scale = 1; _scale < _newScale; _scale++) {
-                uint32_t Idx = _s + _scale * scaleWidth;
-                pHDImageOut[Idx] = tempStart * (_newScale - _scale) / _newScale + tempEnd * _scale / _newScale; // 插值算法
+    band.seg = -1;
+    for (uint16_t y = rowStart; y < rowEnd; y++) {
+        uint16_t* pOut = pFrame + (y - rowStart + 1) * destWidth - 1; // 镜像 从行尾往前写
+        const uint16_t s = linear_band_seek(pLinear, pSrc, y, &band);
+        const uint16_t n = pLinear->keyRow[band.seg + 1] - pLinear->keyRow[band.seg];
+
+        if (0 == s || n == s) {
+            const int16_t* pRow = (0 == s) ? band.top : band.bottom;
+            for (uint16_t x = 0; x < destWidth; x++, pOut--) {
+                *pOut = palette_color(pMap, pRow[x]);
+            }
+        } else {
+            const uint32_t recip = LINEAR_RECIP(n);
+            for (uint16_t x = 0; x < destWidth; x++, pOut--) {
+                *pOut = palette_color(pMap, linear_div(band.top[x] * (n - s), recip) + linear_div(band.bottom[x] * s, recip));
             }
         }
     }
@@ -1,172 +1,100 @@
 #include "IDW.h"
 
-#define P0 (0.077847)
-#define P1 (0.123317 + 0.077847)
-#define P2 (0.195346 + 0.123317 + 0.123317 + 0.077847)
+// 高斯模糊 先按 scale 倍最近邻放大 再在放大后的网格上做 3x3 高斯模糊
+// 3x3 高斯核可以分解为两个一维核 [a, b, a] 的外积, 先垂直再水平 两遍都是定点运算
+#define GAUSS_TAP_SHIFT 15 // 垂直方向一维核 Q15
+#define GAUSS_ROW_SHIFT 2 // 垂直方向结果保留 2 位小数
+#define GAUSS_HTAP_SHIFT 13 // 水平方向一维核 Q13 Q2 的行值 (int16 * 4) 乘以权重之和 (1 << 13) 不超过 int32
 
-static int ktype = 2;
+typedef struct
+{
+    int32_t side; // 两边的权重 a
+    int32_t center; // 中间的权重 b = 1 - 2a
+} sGaussTaps;
 
-static const int8_t offset[4][9] = {
-    { -33, -32, -32, -1, 0, 0, -1, 0, 0 },
-    { -32, -32, -31, 0, 0, 1, 0, 0, 1 },
-    { -1, 0, 0, -1, 0, 0, 31, 32, 32 },
-    { 0, 0, 1, 0, 0, 1, 32, 32, 33 },
+// 一维核 a = sqrt(角上的权重) b = sqrt(中间的权重) 归一化后 a + b + a = 1
+static const sGaussTaps gaussTaps[GAUSS_SIGMA_COUNT] = {
+    { 5169, 22430 }, // Sigma = 0.5 3x3: 0.024879 0.107973 0.468592
+    { 9143, 14482 }, // Sigma = 1.0 3x3: 0.077847 0.123317 0.195346
+    { 10468, 11832 }, // Sigma = 2.0 3x3: 0.102059 0.115349 0.130371
 };
 
-// const int8_t offset[4][9] =
-//     {
-//         {-65, -64, -64,
-//          -2, 0, 0,
-//          -2, 0, 0},
-//         {-64, -64, -63,
-//          0, 0, 2,
-//          0, 0, 2},
-//         {-2, 0, 0,
-//          -2, 0, 0,
-//          63, 64, 64},
-//         {0, 0, 2,
-//          0, 0, 2,
-//          64, 64, 65},
-// };
+static eGaussSigma gaussSigma = GAUSS_SIGMA_2_0;
 
-static const float kernel[3][9] = {
-    // Signa = 0.5
-    {
-        0.024879f,
-        0.107973f,
-        0.024879f,
-        0.107973f,
-        0.468592f,
-        0.107973f,
-        0.024879f,
-        0.107973f,
-        0.024879f,
-    },
-    // Sigma = 1.0
-    {
-        0.077847f,
-        0.123317f,
-        0.077847f,
-        0.123317f,
-        0.195346f,
-        0.123317f,
-        0.077847f,
-        0.123317f,
-        0.077847f,
-    },
-    // Sigma = 2.0
-    {
-        0.102059f,
-        0.115349f,
-        0.102059f,
-        0.115349f,
-        0.130371f,
-        0.115349f,
-        0.102059f,
-        0.115349f,
-        0.102059f,
-    },
-};
+/**
+ * @brief 选择高斯模糊的 Sigma 在下一帧开始生效
+ *
+ * @param sigma
+ */
+void idwGaussSetSigma(eGaussSigma sigma)
+{
+    if (sigma < GAUSS_SIGMA_COUNT) {
+        gaussSigma = sigma;
+    }
+}
 
 /**
- * @brief 高斯模糊 2倍
+ * @brief 高斯模糊 放大 scale 倍
  *
  * @param pSrc 输入
- * @param w 输入宽
+ * @param w 输入宽 不超过 IDW_GAUSS_MAX_WIDTH
  * @param h 输入高
- * @param pDest 输出
+ * @param scale 放大倍数
+ * @param pDest 输出 (w * scale) x (h * scale)
  */
-void idwGauss(int16_t* pSrc, uint16_t w, uint16_t h, uint16_t scale, float* pDest)
+void idwGauss(const int16_t* pSrc, uint16_t w, uint16_t h, uint16_t scale, int16_t* pDest)
 {
-    const float* pKernel = kernel[ktype];
-    const int32_t totalSize = w * h;
-    const uint16_t _Scale = scale * scale;
-
-    for (int i = 0; i < totalSize * _Scale; i++) {
-        float pix = 0;
-        int sourceAddress = ((i >> 1) & 0x1f) + ((i & 0xffffff80) >> 2);
-        uint16_t q = (i & 1) + ((i & 0x40) >> 5);
-
-        for (int z = 0; z < 9; z++) {
-            int sa = sourceAddress + offset[q][z];
-            if (sa < 0) {
-                sa = 0;
-            } else if (sa >= totalSize) {
-                sa = totalSize - 1;
-            }
-            pix += pKernel[z] * pSrc[sa];
-        }
-        pDest[i] = pix;
-    }
+    idwGaussRows(pSrc, w, h, scale, pDest, 0, h * scale);
 }
 
-#if 0
-
-static const uint16_t kernelInt[3][9] = {
-    {
-        815,
-        3538,
-        815,
-        3538,
-        15355,
-        3538,
-        815,
-        3538,
-        815,
-    },
-    {
-        2551,
-        4041,
-        2551,
-        4041,
-        6401,
-        4041,
-        2551,
-        4041,
-        2551,
-    },
-    {
-        3344,
-        3780,
-        3344,
-        3780,
-        4272,
-        3780,
-        3344,
-        3780,
-        3344,
-    }
-};
-
 /**
- * @brief 高斯插值 2倍 定点运算
+ * @brief 高斯模糊 放大 scale 倍 只计算输出图像的 [rowStart, rowEnd) 行 各行之间互不依赖 可以分段并行计算
+ *        边缘按行 列分别取最近的像素 不会取到相邻行
  *
  * @param pSrc 输入
- * @param w 输入宽
+ * @param w 输入宽 不超过 IDW_GAUSS_MAX_WIDTH
  * @param h 输入高
- * @param dest
+ * @param scale 放大倍数
+ * @param pDest 输出 (w * scale) x (h * scale)
+ * @param rowStart 输出起始行
+ * @param rowEnd 输出结束行(不包含)
  */
-void idwGaussInt(int16_t* pSrc, uint16_t w, uint16_t h, uint16_t scale, float* pDest)
+void idwGaussRows(const int16_t* pSrc, uint16_t w, uint16_t h, uint16_t scale, int16_t* pDest, uint16_t rowStart, uint16_t rowEnd)
 {
-    const uint16_t* pKernel = kernelInt[ktype];
-    const int32_t totalSize = w * h;
-    const uint16_t _Scale = scale * scale;
+    const sGaussTaps taps = gaussTaps[gaussSigma];
+    const int32_t rowRound = 1 << (GAUSS_TAP_SHIFT - GAUSS_ROW_SHIFT - 1);
+    const int32_t outRound = 1 << (GAUSS_HTAP_SHIFT + GAUSS_ROW_SHIFT - 1);
+    // 水平方向的核 Q15 -> Q13 中间的权重补齐 权重之和不变 平坦区域不偏色
+    const int32_t hSide = (taps.side + (1 << (GAUSS_TAP_SHIFT - GAUSS_HTAP_SHIFT - 1))) >> (GAUSS_TAP_SHIFT - GAUSS_HTAP_SHIFT);
+    const int32_t hCenter = (1 << GAUSS_HTAP_SHIFT) - 2 * hSide;
+    int32_t row[IDW_GAUSS_MAX_WIDTH]; // 垂直方向模糊后的一行 Q2
+
+    if (w > IDW_GAUSS_MAX_WIDTH) {
+        return;
+    }
+
+    for (uint16_t oy = rowStart; oy < rowEnd; oy++) {
+        // 放大后的上下两行 在同一个源像素内时就是本行
+        uint16_t y = oy / scale;
+        uint16_t k = oy - y * scale;
+        const int16_t* pUp = pSrc + ((k == 0 && y > 0) ? y - 1 : y) * w;
+        const int16_t* pMid = pSrc + y * w;
+        const int16_t* pDown = pSrc + ((k == scale - 1 && y < h - 1) ? y + 1 : y) * w;
+
+        for (uint16_t x = 0; x < w; x++) {
+            row[x] = (taps.side * (pUp[x] + pDown[x]) + taps.center * pMid[x] + rowRound) >> (GAUSS_TAP_SHIFT - GAUSS_ROW_SHIFT);
+        }
 
-    for (int i = 0; i < totalSize * _Scale; i++) {
-        float pix = 0;
-        int sourceAddress = ((i >> 1) & 0x1f) + ((i & 0xffffff80) >> 2);
-        uint16_t q = (i & 1) + ((i & 0x40) >> 5);
+        int16_t* pOut = pDest + oy * w * scale;
+        for (uint16_t x = 0; x < w; x++) {
+            int32_t left = row[x > 0 ? x - 1 : x];
+            int32_t right = row[x < w - 1 ? x + 1 : x];
 
-        for (int z = 0; z < 9; z++) {
-            int sa = sourceAddress + offset[q][z];
-            if (sa < 0) {
-                sa = 0;
-            } else if (sa >= totalSize) {
-                sa = totalSize - 1;
+            for (uint16_t sub = 0; sub < scale; sub++) {
+                int32_t l = (sub == 0) ? left : row[x];
+                int32_t r = (sub == scale - 1) ? right : row[x];
+                *pOut++ = (hSide * (l + r) + hCenter * row[x] + outRound) >> (GAUSS_HTAP_SHIFT + GAUSS_ROW_SHIFT);
             }
-            pix += (pKernel[z] * (int32_t)(pSrc[sa])) >> 15;
         }
-        pDest[i] = pix;
     }
 }
-#endif
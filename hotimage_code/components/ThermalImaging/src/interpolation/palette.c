@@ -2,6 +2,11 @@
 #include "dispcolor.h"
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
+#include <esp_heap_caps.h>
+
+static uint16_t* paletteLut[COLOR_MAX] = { NULL }; // 各类型的查表伪彩色
+
+#define PALETTE_EQ_NORM_SHIFT 22 // 直方图均衡 累计分布 -> 伪彩色下标 的比例
 
 /**
  * @brief 构建多色 伪彩色
@@ -150,3 +155,156 @@ void getPalette(eColorScale palette, uint16_t steps, tRGBcolor* pBuff)
         break;
     }
 }
+
+/**
+ * @brief 返回 所选类型的查表伪彩色 第一次调用时生成 之后只返回指针
+ *
+ * @param palette 调色板类型
+ * @return const uint16_t* PALETTE_LUT_SIZE 个颜色 RGB565 显存字节序 NULL=内存不足
+ */
+const uint16_t* palette_getLut(eColorScale palette)
+{
+    if (palette >= COLOR_MAX) {
+        palette = Iron;
+    }
+
+    if (NULL == paletteLut[palette]) {
+        tRGBcolor* pColors = heap_caps_malloc(PALETTE_LUT_SIZE * sizeof(tRGBcolor), MALLOC_CAP_8BIT);
+        uint16_t* pLut = heap_caps_malloc(PALETTE_LUT_SIZE * sizeof(uint16_t), MALLOC_CAP_8BIT);
+
+        if (NULL == pColors || NULL == pLut) {
+            heap_caps_free(pColors);
+            heap_caps_free(pLut);
+            return NULL;
+        }
+
+        getPalette(palette, PALETTE_LUT_SIZE, pColors);
+
+        // 显存里的像素是高字节在前
+        for (uint16_t i = 0; i < PALETTE_LUT_SIZE; i++) {
+            uint16_t color = RGB565(pColors[i].r, pColors[i].g, pColors[i].b);
+            pLut[i] = (color >> 8) | (color << 8);
+        }
+
+        heap_caps_free(pColors);
+        paletteLut[palette] = pLut;
+    }
+
+    return paletteLut[palette];
+}
+
+/**
+ * @brief 设置映射的伪彩色和值的范围 只计算比例 不重新生成伪彩色
+ *
+ * @param pMap
+ * @param palette 调色板类型
+ * @param minValue 对应第一个颜色的值
+ * @param maxValue 对应最后一个颜色的值
+ * @return int 0=成功 -1=内存不足 映射不变
+ */
+int palette_setMap(sPaletteMap* pMap, eColorScale palette, int16_t minValue, int16_t maxValue)
+{
+    const uint16_t* pLut = palette_getLut(palette);
+
+    if (NULL == pLut) {
+        return -1;
+    }
+
+    pMap->pLut = pLut;
+    pMap->offset = minValue;
+    pMap->range = (maxValue > minValue) ? maxValue - minValue : 1;
+    // 比例向上取整 maxValue 正好落在最后一个颜色 向下取整时只能到倒数第二个
+    pMap->scale = (((int32_t)(PALETTE_LUT_SIZE - 1) << PALETTE_INDEX_SHIFT) + pMap->range - 1) / pMap->range;
+
+    return 0;
+}
+
+/**
+ * @brief 按图像的直方图设置均衡后的映射 (平台均衡)
+ *        每格的计数先限制在平台值 多出的部分平均分给所有格 累计分布就是 值 -> 伪彩色下标 的曲线
+ *        生成的查表和 palette_setMap 一样通过 palette_color 使用 每个像素仍然只查一次表
+ *
+ * @param pMap
+ * @param pEqLut 均衡后的查表 PALETTE_EQ_LUT_SIZE 个颜色 映射使用期间不能修改
+ * @param palette 调色板类型
+ * @param minValue 对应第一个颜色的值
+ * @param maxValue 对应最后一个颜色的值
+ * @param pImage 统计直方图的图像 (视口左上角)
+ * @param stride 图像一行的像素数
+ * @param width 统计的宽
+ * @param height 统计的高
+ * @return int 0=成功 -1=内存不足或参数错误 映射不变
+ */
+int palette_setEqualizedMap(sPaletteMap* pMap, uint16_t* pEqLut, eColorScale palette, int16_t minValue, int16_t maxValue,
+    const int16_t* pImage, uint16_t stride, uint16_t width, uint16_t height)
+{
+    const uint16_t* pLut = palette_getLut(palette);
+    const uint32_t total = width * height;
+    uint16_t hist[PALETTE_HIST_BINS] = { 0 };
+    uint32_t cdf[PALETTE_HIST_BINS + 1];
+
+    if (NULL == pLut || 0 == total) {
+        return -1;
+    }
+
+    // 值 -> 格 和 palette_color 的 值 -> 下标 用同一种比例 查表的每 4 个颜色正好是一格
+    const int32_t range = (maxValue > minValue) ? maxValue - minValue : 1;
+    const int32_t binScale = ((int32_t)PALETTE_HIST_BINS << PALETTE_INDEX_SHIFT) / (range + 1);
+
+    for (uint16_t y = 0; y < height; y++) {
+        const int16_t* pRow = pImage + y * stride;
+        for (uint16_t x = 0; x < width; x++) {
+            int32_t value = pRow[x] - minValue;
+            if (value < 0) {
+                value = 0;
+            } else if (value > range) {
+                value = range;
+            }
+            hist[(value * binScale) >> PALETTE_INDEX_SHIFT]++;
+        }
+    }
+
+    // 平台 限制每格的计数 被削掉的计数平均分给所有格 (累计分布里相当于叠加一条直线)
+    uint32_t plateau = total * PALETTE_HIST_PLATEAU / PALETTE_HIST_BINS;
+    if (0 == plateau) {
+        plateau = 1;
+    }
+
+    uint32_t kept = 0;
+    for (int b = 0; b < PALETTE_HIST_BINS; b++) {
+        if (hist[b] > plateau) {
+            hist[b] = plateau;
+        }
+        kept += hist[b];
+    }
+
+    // 累计分布 放大 PALETTE_HIST_BINS 倍 保持整数 最后一格正好是 total * PALETTE_HIST_BINS
+    const uint32_t excess = total - kept;
+    uint32_t acc = 0;
+    cdf[0] = 0;
+    for (int b = 0; b < PALETTE_HIST_BINS; b++) {
+        acc += hist[b];
+        cdf[b + 1] = acc * PALETTE_HIST_BINS + excess * (b + 1);
+    }
+
+    // 累计分布 -> 伪彩色下标 每格内 4 个颜色按各自的中心线性插值
+    // 插值位置最大 total * PALETTE_HIST_BINS * 8 乘以 Q22 的比例 结果不超过 32 位
+    const uint32_t norm = ((uint32_t)(PALETTE_LUT_SIZE - 1) << PALETTE_EQ_NORM_SHIFT) / (total * PALETTE_HIST_BINS * 8);
+    uint16_t* pOut = pEqLut;
+    for (int b = 0; b < PALETTE_HIST_BINS; b++) {
+        const uint32_t base = cdf[b] * 8;
+        const uint32_t step = cdf[b + 1] - cdf[b];
+
+        *pOut++ = pLut[((base + step * 1) * norm) >> PALETTE_EQ_NORM_SHIFT];
+        *pOut++ = pLut[((base + step * 3) * norm) >> PALETTE_EQ_NORM_SHIFT];
+        *pOut++ = pLut[((base + step * 5) * norm) >> PALETTE_EQ_NORM_SHIFT];
+        *pOut++ = pLut[((base + step * 7) * norm) >> PALETTE_EQ_NORM_SHIFT];
+    }
+
+    pMap->pLut = pEqLut;
+    pMap->offset = minValue;
+    pMap->range = range;
+    pMap->scale = ((int32_t)PALETTE_EQ_LUT_SIZE << PALETTE_INDEX_SHIFT) / (range + 1);
+
+    return 0;
+}
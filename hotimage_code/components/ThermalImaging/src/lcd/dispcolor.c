@@ -121,6 +121,18 @@ void dispcolor_Update(void)
 #endif
 }
 
+/**
+ * @brief 把显存内容刷新到液晶屏上 整屏刷新时不等待发送完成 (热成像画面)
+ *        显存复制到行缓存后返回 发送期间可以直接绘制下一帧
+ *
+ */
+void dispcolor_UpdateAsync(void)
+{
+#if (ST7789_MODE == ST7789_BUFFER_MODE)
+    st7789_updateAsync();
+#endif
+}
+
 /**
  * @brief 设置全屏幕显示指定颜色
  *
@@ -593,3 +605,32 @@ void dispcolor_getScreenData(uint16_t* pBuff)
     st7789_getScreenData(pBuff);
 #endif
 }
+
+/**
+ * @brief 获取显存地址 热成像整行直接写入时使用 写入后要用 dispcolor_markDirty 标记
+ *
+ * @return uint16_t* 显存地址 像素是液晶的字节序(高字节在前) 直接显示模式返回 NULL
+ */
+uint16_t* dispcolor_getBuffer(void)
+{
+#if (ST7789_MODE == ST7789_BUFFER_MODE)
+    return st7789_getBuffer();
+#else
+    return NULL;
+#endif
+}
+
+/**
+ * @brief 标记显存中被直接写入的矩形 下次 dispcolor_Update 时刷新
+ *
+ * @param x 坐标
+ * @param y 坐标
+ * @param w 宽
+ * @param h 高
+ */
+void dispcolor_markDirty(int16_t x, int16_t y, int16_t w, int16_t h)
+{
+#if (ST7789_MODE == ST7789_BUFFER_MODE)
+    st7789_markDirty(x, y, w, h);
+#endif
+}
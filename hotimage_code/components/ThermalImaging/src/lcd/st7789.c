@@ -1,8 +1,10 @@
 #include "thermalimaging.h"
 #include <driver/gpio.h>
 #include <driver/spi_master.h>
+#include <esp_log.h>
 #include <esp_system.h>
 #include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
 #include <freertos/task.h>
 #include <soc/gpio_struct.h>
 #include <stdio.h>
@@ -13,6 +15,26 @@
 #if (ST7789_MODE == ST7789_BUFFER_MODE)
 // LCD 缓存
 /* EXT_RAM_ATTR */ static uint16_t ScreenBuff[LINE_PIXEL_MAX_SIZE * ROW_PIXEL_MAX_SIZE]; // LCD显存
+
+// 脏区 显存按 16x16 像素分块 每个块行用一个位图记录 刷新时只发送有变化的块
+#define ST7789_TILE_SHIFT 4
+#define ST7789_TILE_SIZE (1 << ST7789_TILE_SHIFT)
+#define ST7789_TILE_DIM_MAX (LINE_PIXEL_MAX_SIZE > ROW_PIXEL_MAX_SIZE ? LINE_PIXEL_MAX_SIZE : ROW_PIXEL_MAX_SIZE)
+#define ST7789_TILE_COUNT ((ST7789_TILE_DIM_MAX + ST7789_TILE_SIZE - 1) >> ST7789_TILE_SHIFT) // 横竖屏都够用 不超过 32
+#define ST7789_TILE_ROW_GAP 4 // 一个块行里没变化的块不超过这个数时整行发送 一次传输比逐行传输快
+
+static uint32_t dirtyTiles[ST7789_TILE_COUNT]; // 绘图函数写过的块 刷新时用哈希去掉内容没变的块 (菜单整屏重绘)
+static uint32_t forceTiles[ST7789_TILE_COUNT]; // 显存被直接写入的块 一定有变化 不计算哈希直接发送
+static uint32_t hashValid[ST7789_TILE_COUNT]; // tileHash 和液晶上的内容一致
+static uint32_t tileHash[ST7789_TILE_COUNT][ST7789_TILE_COUNT]; // 每块上次发送时的哈希
+
+// 异步刷新 显存按段复制到两个行缓存轮流由SPI DMA发送 全部复制后返回 最后两段发送期间可以绘制下一帧
+// 行缓存从内部RAM分配 (DMA) 分配失败时同步发送
+#define ST7789_BAND_ROWS 16 // 每段的行数 最大边长 320 时两个行缓存共 2 * 16 * 320 * 2 = 20KB
+static const char* TAG = "st7789";
+static uint16_t* bandBuff[2] = { NULL, NULL }; // 行缓存
+static spi_transaction_t flushTrans[2];
+static uint8_t flushQueued = 0; // 正在发送的传输个数 0=没有异步刷新
 #endif
 
 #if (ST7789_MODE == ST7789_DIRECT_MODE)
@@ -379,6 +401,9 @@ void st7789_setWindow(uint16_t x, uint16_t y, uint16_t x_end, uint16_t y_end)
 void st7789_DisplayOff(void)
 {
 #ifdef CONFIG_ESP32_SPI_ST7789_LCD
+#if (ST7789_MODE == ST7789_BUFFER_MODE)
+    st7789_waitFlush();
+#endif
     lcd_cmd(LCD_SPI, ST7789_DISPOFF);
 #endif // CONFIG_ESP32_SPI_ST7789_LCD
 }
@@ -487,9 +512,32 @@ void st7789_DrawPixel(int16_t x, int16_t y, uint16_t color)
     SwapBytes(&color);
 
     ScreenBuff[y * lcddev.width + x] = color;
+    dirtyTiles[y >> ST7789_TILE_SHIFT] |= 1u << (x >> ST7789_TILE_SHIFT);
 #endif // CONFIG_ESP32_SPI_ST7789_LCD
 }
 
+#ifdef CONFIG_ESP32_SPI_ST7789_LCD
+/**
+ * @brief 标记矩形覆盖的块 坐标已经在屏幕范围内
+ *
+ * @param pTiles 位图
+ * @param x 起始横坐标
+ * @param y 起始纵坐标
+ * @param w 宽
+ * @param h 高
+ */
+static void markTiles(uint32_t* pTiles, int16_t x, int16_t y, int16_t w, int16_t h)
+{
+    const uint16_t colStart = x >> ST7789_TILE_SHIFT;
+    const uint16_t colEnd = (x + w - 1) >> ST7789_TILE_SHIFT;
+    const uint32_t mask = ((2u << colEnd) - 1) & ~((1u << colStart) - 1);
+
+    for (uint16_t row = y >> ST7789_TILE_SHIFT; row <= (y + h - 1) >> ST7789_TILE_SHIFT; row++) {
+        pTiles[row] |= mask;
+    }
+}
+#endif // CONFIG_ESP32_SPI_ST7789_LCD
+
 /**
  * @brief 填充矩形
  *
@@ -525,18 +573,247 @@ void st7789_FillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
             ScreenBuff[(y + row) * lcddev.width + x + col] = color;
         }
     }
+    markTiles(dirtyTiles, x, y, w, h);
+#endif // CONFIG_ESP32_SPI_ST7789_LCD
+}
+
+/**
+ * @brief 标记显存中被直接写入的矩形 下次刷新时发送 (通过 st7789_getBuffer 写入显存后调用)
+ *
+ * @param x 起始横坐标
+ * @param y 起始纵坐标
+ * @param w 宽
+ * @param h 高
+ */
+void st7789_markDirty(int16_t x, int16_t y, int16_t w, int16_t h)
+{
+#ifdef CONFIG_ESP32_SPI_ST7789_LCD
+    if ((w <= 0) || (h <= 0) || (x >= lcddev.width) || (y >= lcddev.height))
+        return;
+
+    if (x < 0) {
+        w += x;
+        x = 0;
+    }
+    if (y < 0) {
+        h += y;
+        y = 0;
+    }
+
+    if ((x + w) > lcddev.width)
+        w = lcddev.width - x;
+
+    if ((y + h) > lcddev.height)
+        h = lcddev.height - y;
+
+    if ((w <= 0) || (h <= 0))
+        return;
+
+    markTiles(dirtyTiles, x, y, w, h);
+    markTiles(forceTiles, x, y, w, h);
 #endif // CONFIG_ESP32_SPI_ST7789_LCD
 }
 
+#ifdef CONFIG_ESP32_SPI_ST7789_LCD
+/**
+ * @brief 计算一块显存的哈希 (FNV-1a) 只有一个像素不同时哈希一定不同
+ *
+ * @param x 起始横坐标
+ * @param y 起始纵坐标
+ * @param w 宽
+ * @param h 高
+ * @return uint32_t
+ */
+static uint32_t hashTile(uint16_t x, uint16_t y, uint16_t w, uint16_t h)
+{
+    uint32_t hash = 2166136261u;
+
+    for (uint16_t row = 0; row < h; row++) {
+        const uint16_t* pPixel = &ScreenBuff[(y + row) * lcddev.width + x];
+        for (uint16_t col = 0; col < w; col++) {
+            hash = (hash ^ pPixel[col]) * 16777619u;
+        }
+    }
+
+    return hash;
+}
+
+/**
+ * @brief 发送显存中的一个矩形 整行宽度时显存是连续的 一次传输
+ *
+ * @param x 起始横坐标
+ * @param y 起始纵坐标
+ * @param w 宽
+ * @param h 高
+ */
+static void sendWindow(uint16_t x, uint16_t y, uint16_t w, uint16_t h)
+{
+    st7789_setWindow(x, y, w, h);
+
+    if (w == lcddev.width) {
+        lcd_data(LCD_SPI, (uint8_t*)&ScreenBuff[y * lcddev.width], w * h * sizeof(uint16_t));
+        return;
+    }
+
+    for (uint16_t row = 0; row < h; row++) {
+        lcd_data(LCD_SPI, (uint8_t*)&ScreenBuff[(y + row) * lcddev.width + x], w * sizeof(uint16_t));
+    }
+}
+
+/**
+ * @brief 异步发送整行宽度的窗口 每段复制到空闲的行缓存后排队 两个行缓存都在发送时等待前一段完成
+ *        全部复制后返回 显存可以马上写入 最后两段仍在发送
+ *        发送期间持有 pSPIMutex 由 st7789_waitFlush 释放
+ *
+ * @param y 起始行
+ * @param h 行数
+ */
+static void queueWindow(uint16_t y, uint16_t h)
+{
+    uint8_t band = 0;
+
+    st7789_setWindow(0, y, lcddev.width, h);
+
+    xSemaphoreTake(pSPIMutex, portMAX_DELAY);
+    for (uint16_t row = 0; row < h; row += ST7789_BAND_ROWS, band ^= 1) {
+        const uint16_t rows = (h - row < ST7789_BAND_ROWS) ? h - row : ST7789_BAND_ROWS;
+        const uint32_t len = rows * lcddev.width * sizeof(uint16_t);
+
+        // 传输按排队的顺序完成 取到的结果就是这个行缓存上一次的传输
+        if (flushQueued == 2) {
+            lcd_data_queue_finish(LCD_SPI, 1);
+            flushQueued--;
+        }
+        memcpy(bandBuff[band], &ScreenBuff[(y + row) * lcddev.width], len);
+        lcd_data_queue(LCD_SPI, &flushTrans[band], (uint8_t*)bandBuff[band], len);
+        flushQueued++;
+    }
+}
+
+/**
+ * @brief 发送上次刷新之后有变化的块
+ *        每个块行发送有变化的块的范围 上下相邻且范围相同的块行合并成一个窗口
+ *
+ * @param async 1=只有一个整行宽度的窗口时异步发送
+ */
+static void flushTiles(uint8_t async)
+{
+    const uint16_t tileCols = (lcddev.width + ST7789_TILE_SIZE - 1) >> ST7789_TILE_SHIFT;
+    const uint16_t tileRows = (lcddev.height + ST7789_TILE_SIZE - 1) >> ST7789_TILE_SHIFT;
+    uint16_t winX = 0, winY = 0, winW = 0, winH = 0; // 等待发送的窗口 winH = 0 表示没有
+    uint8_t sent = 0; // 已经同步发送了窗口
+
+    for (uint16_t row = 0; row < tileRows; row++) {
+        const uint16_t y = row << ST7789_TILE_SHIFT;
+        const uint16_t h = (lcddev.height - y < ST7789_TILE_SIZE) ? lcddev.height - y : ST7789_TILE_SIZE;
+        uint32_t dirty = dirtyTiles[row];
+        uint32_t changed = forceTiles[row];
+
+        // 直接写入的块不计算哈希 下次只能按有变化处理
+        hashValid[row] &= ~changed;
+        dirty &= ~changed;
+        dirtyTiles[row] = 0;
+        forceTiles[row] = 0;
+
+        // 绘图函数写过的块 内容和上次发送的一样就不再发送
+        while (dirty) {
+            const uint16_t col = __builtin_ctz(dirty);
+            const uint16_t x = col << ST7789_TILE_SHIFT;
+            const uint16_t w = (lcddev.width - x < ST7789_TILE_SIZE) ? lcddev.width - x : ST7789_TILE_SIZE;
+            const uint32_t hash = hashTile(x, y, w, h);
+
+            dirty &= dirty - 1;
+            if ((hashValid[row] & (1u << col)) && hash == tileHash[row][col]) {
+                continue;
+            }
+            tileHash[row][col] = hash;
+            hashValid[row] |= 1u << col;
+            changed |= 1u << col;
+        }
+
+        if (0 == changed) {
+            continue;
+        }
+
+        uint16_t colStart = __builtin_ctz(changed);
+        uint16_t colEnd = 31 - __builtin_clz(changed);
+        if (tileCols - (colEnd - colStart + 1) <= ST7789_TILE_ROW_GAP) {
+            colStart = 0;
+            colEnd = tileCols - 1;
+        }
+
+        const uint16_t x = colStart << ST7789_TILE_SHIFT;
+        const uint16_t w = ((colEnd + 1) << ST7789_TILE_SHIFT > lcddev.width ? lcddev.width : (colEnd + 1) << ST7789_TILE_SHIFT) - x;
+
+        // 和上一个块行的范围相同 合并
+        if (winH && winX == x && winW == w && winY + winH == y) {
+            winH += h;
+            continue;
+        }
+
+        if (winH) {
+            sendWindow(winX, winY, winW, winH);
+            sent = 1;
+        }
+        winX = x;
+        winY = y;
+        winW = w;
+        winH = h;
+    }
+
+    if (0 == winH) {
+        return;
+    }
+
+    // 异步传输排队期间不能有同步传输 只有一个窗口时才能异步发送 没有行缓存时同步发送
+    if (async && !sent && winW == lcddev.width && bandBuff[1]) {
+        queueWindow(winY, winH);
+    } else {
+        sendWindow(winX, winY, winW, winH);
+    }
+}
+#endif // CONFIG_ESP32_SPI_ST7789_LCD
+
 /**
- * @brief 刷新一帧
+ * @brief 刷新一帧 只发送上次刷新之后有变化的块 发送完成后返回
  *
  */
 void st7789_update(void)
 {
 #ifdef CONFIG_ESP32_SPI_ST7789_LCD
-    st7789_setWindow(0, 0, lcddev.width, lcddev.height);
-    lcd_data(LCD_SPI, (uint8_t*)ScreenBuff, sizeof(ScreenBuff));
+    st7789_waitFlush();
+    flushTiles(0);
+#endif // CONFIG_ESP32_SPI_ST7789_LCD
+}
+
+/**
+ * @brief 刷新一帧 整屏刷新时显存复制到行缓存排队发送 最后两段排队后返回 (热成像画面)
+ *        返回后可以直接绘制下一帧 下次刷新前等待这次发送完
+ *        异步刷新必须在同一个任务里开始和结束 (st7789_update / st7789_updateAsync / st7789_waitFlush)
+ *
+ */
+void st7789_updateAsync(void)
+{
+#ifdef CONFIG_ESP32_SPI_ST7789_LCD
+    st7789_waitFlush();
+    flushTiles(1);
+#endif // CONFIG_ESP32_SPI_ST7789_LCD
+}
+
+/**
+ * @brief 等待异步刷新全部完成 释放SPI总线 只能在开始异步刷新的任务里调用
+ *
+ */
+void st7789_waitFlush(void)
+{
+#ifdef CONFIG_ESP32_SPI_ST7789_LCD
+    if (0 == flushQueued) {
+        return;
+    }
+
+    lcd_data_queue_finish(LCD_SPI, flushQueued);
+    flushQueued = 0;
+    xSemaphoreGive(pSPIMutex);
 #endif // CONFIG_ESP32_SPI_ST7789_LCD
 }
 
@@ -573,6 +850,21 @@ uint16_t st7789_GetPixel(int16_t x, int16_t y)
     return 0x0000;
 #endif // CONFIG_ESP32_SPI_ST7789_LCD
 }
+
+/**
+ * @brief 获取显存地址 用于整行直接写入
+ *        像素按液晶的字节序(高字节在前)存放 一行 lcddev.width 个像素
+ *
+ * @return uint16_t* 显存地址
+ */
+uint16_t* st7789_getBuffer(void)
+{
+#ifdef CONFIG_ESP32_SPI_ST7789_LCD
+    return ScreenBuff;
+#else
+    return NULL;
+#endif // CONFIG_ESP32_SPI_ST7789_LCD
+}
 #endif //  ST7789_MODE == ST7789_BUFFER_MODE
 
 /**
@@ -585,6 +877,19 @@ void st7789_init()
     ScreenBuff = heap_caps_malloc((LINE_PIXEL_MAX_SIZE * ROW_PIXEL_MAX_SIZE) << 1, MALLOC_CAP_8BIT);
 #endif
 
+#if (ST7789_MODE == ST7789_BUFFER_MODE) && defined(CONFIG_ESP32_SPI_ST7789_LCD)
+    // 异步刷新的行缓存 用SPI DMA发送 要在内部RAM
+    for (int i = 0; i < 2; i++) {
+        bandBuff[i] = heap_caps_malloc(ST7789_BAND_ROWS * ST7789_TILE_DIM_MAX * sizeof(uint16_t), MALLOC_CAP_DMA);
+    }
+    if (NULL == bandBuff[0] || NULL == bandBuff[1]) {
+        ESP_LOGE(TAG, "no DMA memory for %u byte flush buffers, display updates are synchronous", (unsigned)(2 * ST7789_BAND_ROWS * ST7789_TILE_DIM_MAX * sizeof(uint16_t)));
+        heap_caps_free(bandBuff[0]);
+        heap_caps_free(bandBuff[1]);
+        bandBuff[0] = bandBuff[1] = NULL;
+    }
+#endif
+
     // 配置SPI3-主机模式，配置DMA通道、DMA字节大小，及 MISO、MOSI、CLK的引脚。
     spi_master_init(LCD_SPI_SLOT, LCD_DEF_DMA_CHAN, LCD_DMA_MAX_SIZE, SPI_LCD_PIN_NUM_MISO, SPI_LCD_PIN_NUM_MOSI, SPI_LCD_PIN_NUM_CLK);
 
@@ -161,11 +161,12 @@ static void menu_build()
     // 插值算法
     strcpy(item.Title, "Interpolation:");
     item.ItemType = ComboBox;
-    item.ComboItemsCount = 3;
+    item.ComboItemsCount = 4;
     item.ComboItems = heap_caps_malloc(item.ComboItemsCount * sizeof(sComboItem), MALLOC_CAP_8BIT);
     strcpy(item.ComboItems[0].Str, "Original"); // 原始
     strcpy(item.ComboItems[1].Str, "Linear"); // 线性
     strcpy(item.ComboItems[2].Str, "Gauss + Bilinear"); // 高斯
+    strcpy(item.ComboItems[3].Str, "Bicubic"); // 双三次
     item.pValue = &settingsParms.ScaleMode;
     item.EnterAction = NULL;
     item.Action = NULL;
@@ -197,9 +198,27 @@ static void menu_build()
     item.Action = NULL;
     add_menuitem(&item);
 
-    //
+    // 低延迟显示 每个子页刷新一次
+    strcpy(item.Title, "Low Latency:");
+    item.ItemType = ComboBox;
+    item.ComboItemsCount = 3;
+    item.ComboItems = heap_caps_malloc(item.ComboItemsCount * sizeof(sComboItem), MALLOC_CAP_8BIT);
+    strcpy(item.ComboItems[0].Str, "Off");
+    strcpy(item.ComboItems[1].Str, "On");
+    strcpy(item.ComboItems[2].Str, "On + Deinterlace");
+    item.pValue = &settingsParms.LowLatency;
+    item.EnterAction = NULL;
+    item.Action = NULL;
+    add_menuitem(&item);
+
+    // 自动缩放 关闭 线性 直方图均衡
     strcpy(item.Title, "Auto Scaling:");
-    item.ItemType = CheckBox;
+    item.ItemType = ComboBox;
+    item.ComboItemsCount = 3;
+    item.ComboItems = heap_caps_malloc(item.ComboItemsCount * sizeof(sComboItem), MALLOC_CAP_8BIT);
+    strcpy(item.ComboItems[0].Str, "Off");
+    strcpy(item.ComboItems[1].Str, "Linear");
+    strcpy(item.ComboItems[2].Str, "Histogram");
     item.pValue = &settingsParms.AutoScaleMode;
     item.EnterAction = MenuAction_ReBuildPalette;
     item.Action = NULL;
@@ -272,7 +291,7 @@ static void menu_build()
     // 按钮设置
     strcpy(item.Title, "Up Button:");
     item.ItemType = ComboBox;
-    item.ComboItemsCount = 9;
+    item.ComboItemsCount = 14;
 #ifdef LCD_PIN_NUM_BCKL
     item.ComboItemsCount += 2;
 #endif
@@ -291,6 +310,11 @@ static void menu_build()
 #endif
     strcpy(item.ComboItems[idx++].Str, "MLX90640 Params");
     strcpy(item.ComboItems[idx++].Str, "Pause / Play");
+    strcpy(item.ComboItems[idx++].Str, "Zoom 1x/2x/4x");
+    strcpy(item.ComboItems[idx++].Str, "Zoom Pan X");
+    strcpy(item.ComboItems[idx++].Str, "Zoom Pan Y");
+    strcpy(item.ComboItems[idx++].Str, "Zoom Pan X Back");
+    strcpy(item.ComboItems[idx++].Str, "Zoom Pan Y Back");
     item.pValue = &settingsParms.FuncUp;
     item.EnterAction = NULL;
     item.Action = NULL;
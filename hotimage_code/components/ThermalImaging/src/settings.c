@@ -14,7 +14,7 @@ structSettingsParms settingsParms = {
     ScaleMode : LINEAR,
     MLX90640FPS : 4,
     Resolution : 2,
-    AutoScaleMode : 1,
+    AutoScaleMode : AUTOSCALE_LINEAR,
     minTempNew : SCALE_DEFAULT_MIN,
     maxTempNew : SCALE_DEFAULT_MAX,
     TempMarkers : 1,
@@ -23,6 +23,7 @@ structSettingsParms settingsParms = {
     FuncUp : Markers_OnOff,
     FuncCenter : Save_BMP16,
     FuncDown : Scale_Prev,
+    LowLatency : LOWLATENCY_OFF,
 };
 
 // 设置存储 初始化
@@ -223,6 +224,10 @@ int settings_read_all(void)
     if (err != ESP_OK)
         return err;
 
+    err = setting_read("LowLatency", uint8, &settingsParms.LowLatency);
+    if (err != ESP_OK)
+        return err;
+
     return 0;
 }
 
@@ -289,5 +294,9 @@ int settings_write_all(void)
     if (err != ESP_OK)
         return err;
 
+    err = setting_write("LowLatency", uint8, &settingsParms.LowLatency);
+    if (err != ESP_OK)
+        return err;
+
     return settings_commit();
 }
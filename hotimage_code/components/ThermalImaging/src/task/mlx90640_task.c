@@ -1,14 +1,41 @@
 #include "thermalimaging.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "esp_timer.h"
+#include "framering.h"
+#include "nvs.h"
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
+#include <math.h>
+#include <stddef.h>
 #include <string.h>
 
+static const char* TAG = "mlx90640";
+
 #define MLX_IIC_ADDRESS 0x33u
 #define TA_SHIFT 8 // the default shift for a MLX90640 device in open air
 
+#define DEINTERLACE_THRESHOLD 1.5f // 旧子页像素与新子页插值相差超过这个温度 认为有运动
+
+// 参数缓存 只缓存从EEPROM解析出的部分 预计算表启动时重新生成
+#define MLX_CACHE_NAMESPACE "mlx90640"
+#define MLX_CACHE_KEY_HEAD "calibHead"
+#define MLX_CACHE_KEY_DATA "calibData"
+#define MLX_CACHE_VERSION 2
+#define MLX_CACHE_PARAMS_SIZE offsetof(paramsMLX90640, alphaCorrR)
+
+typedef struct
+{
+    uint32_t version; // 缓存格式版本
+    uint32_t paramsSize; // 缓存的参数长度
+    uint16_t deviceID[3]; // 传感器ID
+    uint32_t paramsCrc; // 缓存参数的 CRC32
+} sMlxCalibCacheHead;
+
 static paramsMLX90640* pMLX90640params = NULL; // MLX90640 解析出的参数
-sMlxData* pMlxData = NULL; // MLX90640 定义2个缓存
-static int8_t lastFrameNo = 0;
+static sFrameRing frameRing; // 帧环形缓存 单生产者(mlx90640_task) 多消费者(render_task save web...) 丢帧按 render_task 统计
+static MLX90640_FrameContext frameCtx; // 当前子页的帧参数
+static float liveImage[THERMALIMAGE_RESOLUTION_WIDTH * THERMALIMAGE_RESOLUTION_HEIGHT]; // 实时图像 每个子页计算后合并到这里
 
 const float FPS_RATES[] = { 0.5, 1, 2, 4, 8, 16, 32, 64 }; // MLX90640帧率
 const int FPS_RATES_COUNT = sizeof(FPS_RATES) / sizeof(FPS_RATES[0]);
@@ -17,11 +44,148 @@ const int RESOLUTION[] = { 16, 17, 18, 19 }; // MLX90640 AD分辨率
 const int RESOLUTION_COUNT = sizeof(RESOLUTION) / sizeof(RESOLUTION[0]);
 
 static uint8_t MLX90640PausePlay = 0; // 暂停LCD刷新 继续LCD刷新功能
+static uint16_t pollsPerFrame = 0; // 上一帧查询状态寄存器的次数
+static sMLX90640I2CStats i2cStatsPerFrame; // 上一帧的 I2C 调用计数
+static uint32_t frameErrorCount = 0; // 读取子页时返回 -8 (读取太慢 数据已被下一子页覆盖) 的次数
+static uint32_t frameTimeoutCount = 0; // 读取子页时返回 -10 (等待数据就绪超时) 的次数
+static uint32_t frameNackCount = 0; // 读取子页时返回 -1 (传感器未应答) 的次数
 
 #ifndef max
 #define max(a, b) ((a) > (b) ? (a) : (b))
 #endif
 
+/**
+ * @brief 像素是否属于指定子页
+ *
+ * @param x
+ * @param y
+ * @param chessMode 1=棋盘模式 0=交错模式
+ * @param subPage
+ * @return uint8_t
+ */
+static inline uint8_t isSubPagePixel(int x, int y, uint8_t chessMode, uint8_t subPage)
+{
+    return (chessMode ? ((x + y) & 1) : (y & 1)) == subPage;
+}
+
+/**
+ * @brief 去隔行 旧子页的像素如果和周围新子页像素的插值相差太大(运动) 用插值代替
+ *        静止区域保留旧子页像素 不损失分辨率
+ *
+ * @param pSrc 实时图像
+ * @param pDst 输出图像
+ * @param chessMode 1=棋盘模式 0=交错模式
+ * @param freshSubPage 刚刚更新的子页
+ */
+static void deinterlaceImage(const float* pSrc, float* pDst, uint8_t chessMode, uint8_t freshSubPage)
+{
+    const int w = THERMALIMAGE_RESOLUTION_WIDTH;
+    const int h = THERMALIMAGE_RESOLUTION_HEIGHT;
+
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            int i = y * w + x;
+            pDst[i] = pSrc[i];
+            if (isSubPagePixel(x, y, chessMode, freshSubPage)) {
+                continue;
+            }
+
+            // 上下两个像素在两种模式下都属于新子页 棋盘模式下左右也是
+            float sum = 0;
+            int cnt = 0;
+            if (y > 0) {
+                sum += pSrc[i - w];
+                cnt++;
+            }
+            if (y < h - 1) {
+                sum += pSrc[i + w];
+                cnt++;
+            }
+            if (chessMode) {
+                if (x > 0) {
+                    sum += pSrc[i - 1];
+                    cnt++;
+                }
+                if (x < w - 1) {
+                    sum += pSrc[i + 1];
+                    cnt++;
+                }
+            }
+
+            float interp = sum / cnt;
+            if (fabsf(pSrc[i] - interp) > DEINTERLACE_THRESHOLD) {
+                pDst[i] = interp;
+            }
+        }
+    }
+}
+
+/**
+ * @brief 把实时图像发布到帧环形缓存 并通知 render_task
+ *
+ * @param freshSubPage 刚刚更新的子页 只有低延迟去隔行模式使用
+ * @param readyUs 本帧新数据中最早的子页就绪时间
+ */
+static void publishLiveImage(uint8_t freshSubPage, int64_t readyUs)
+{
+    sMlxData* _pMlxData = framering_writeBegin(&frameRing);
+
+    if (LOWLATENCY_DEINTERLACE == settingsParms.LowLatency) {
+        deinterlaceImage(liveImage, _pMlxData->ThermoImage, frameCtx.mode != 0, freshSubPage);
+    } else {
+        memcpy(_pMlxData->ThermoImage, liveImage, sizeof(liveImage));
+    }
+    _pMlxData->Vdd = frameCtx.vdd; // 电压
+    _pMlxData->Ta = frameCtx.ta; // 实时外壳温度
+    _pMlxData->readyUs = readyUs;
+
+    framering_publish(&frameRing);
+    if (NULL != pHandleEventGroup)
+        xEventGroupSetBits(pHandleEventGroup, RENDER_MLX90640_FRAME);
+}
+
+/**
+ * @brief 获取最新一帧的完整副本
+ *
+ * @param pBuff
+ * @param pFrameNo 帧号 可以为NULL
+ * @return uint8_t 0=成功 1=还没有帧
+ */
+uint8_t mlx90640_getFrame(sMlxData* pBuff, uint32_t* pFrameNo)
+{
+    return framering_read(&frameRing, pBuff, 0, sizeof(sMlxData), pFrameNo);
+}
+
+/**
+ * @brief render_task 处理完一帧后调用 用于统计丢帧
+ *
+ * @param frameNo
+ */
+void mlx90640_frameConsumed(uint32_t frameNo)
+{
+    framering_consumed(&frameRing, frameNo);
+}
+
+/**
+ * @brief 获取丢帧数 (没有被 render_task 处理就被覆盖的帧)
+ *
+ * @return uint32_t
+ */
+uint32_t mlx90640_getDroppedFrames(void)
+{
+    return framering_getDroppedFrames(&frameRing);
+}
+
+/**
+ * @brief 获取读者因为数据被覆盖而重新复制的次数
+ *
+ * @return uint32_t
+ */
+uint32_t mlx90640_getReadRetries(void)
+{
+    return framering_getReadRetries(&frameRing);
+}
+
 /**
  * @brief 程序将温度矩阵复制到pbuff缓冲区
  *
@@ -29,9 +193,9 @@ static uint8_t MLX90640PausePlay = 0; // 暂停LCD刷新 继续LCD刷新功能
  */
 void GetThermoData(float* pBuff)
 {
-    sMlxData* _pMlxData = &pMlxData[lastFrameNo];
-    float* ThermoImage = _pMlxData->ThermoImage;
-    memcpy(pBuff, ThermoImage, sizeof(_pMlxData->ThermoImage));
+    if (framering_read(&frameRing, pBuff, offsetof(sMlxData, ThermoImage), sizeof(((sMlxData*)0)->ThermoImage), NULL)) {
+        memset(pBuff, 0, sizeof(((sMlxData*)0)->ThermoImage));
+    }
 }
 
 void GetThermoParams(paramsMLX90640* pBuf)
@@ -59,7 +223,61 @@ uint8_t setMLX90640IsPause(uint8_t isPause)
  */
 int mlx90640_flushRate(void)
 {
-    return MLX90640_SetRefreshRate(MLX_IIC_ADDRESS, settingsParms.MLX90640FPS);
+    int result = MLX90640_SetRefreshRate(MLX_IIC_ADDRESS, settingsParms.MLX90640FPS);
+
+    // 刷新率即子页的更新速率
+    MLX90640_SetSubPagePeriod(1000000 / FPS_RATES[settingsParms.MLX90640FPS]);
+    return result;
+}
+
+/**
+ * @brief 获取上一帧(2个子页)查询状态寄存器的次数
+ *
+ * @return uint16_t
+ */
+uint16_t mlx90640_getPollsPerFrame(void)
+{
+    return pollsPerFrame;
+}
+
+/**
+ * @brief 获取读取子页返回 -8 的次数
+ *
+ * @return uint32_t
+ */
+uint32_t mlx90640_getFrameErrorCount(void)
+{
+    return frameErrorCount;
+}
+
+/**
+ * @brief 获取读取子页返回 -10 的次数
+ *
+ * @return uint32_t
+ */
+uint32_t mlx90640_getFrameTimeoutCount(void)
+{
+    return frameTimeoutCount;
+}
+
+/**
+ * @brief 获取读取子页返回 -1 的次数
+ *
+ * @return uint32_t
+ */
+uint32_t mlx90640_getFrameNackCount(void)
+{
+    return frameNackCount;
+}
+
+/**
+ * @brief 获取上一帧(2个子页)的 I2C 调用计数
+ *
+ * @param stats
+ */
+void mlx90640_getI2CStatsPerFrame(sMLX90640I2CStats* stats)
+{
+    memcpy(stats, &i2cStatsPerFrame, sizeof(sMLX90640I2CStats));
 }
 
 /**
@@ -72,6 +290,82 @@ int mlx90640_flushResolution(void)
     return MLX90640_SetResolution(MLX_IIC_ADDRESS, settingsParms.Resolution);
 }
 
+/**
+ * @brief 从NVS读取参数缓存
+ *
+ * @param deviceID 当前传感器ID
+ * @param params 读取成功后的参数
+ * @return int 0=成功 -1=无缓存或缓存无效
+ */
+static int loadParamsCache(const uint16_t* deviceID, paramsMLX90640* params)
+{
+    nvs_handle handle;
+    sMlxCalibCacheHead head;
+    size_t len;
+    int ret = -1;
+
+    if (nvs_open(MLX_CACHE_NAMESPACE, NVS_READONLY, &handle) != ESP_OK)
+        return -1;
+
+    len = sizeof(head);
+    if (nvs_get_blob(handle, MLX_CACHE_KEY_HEAD, &head, &len) != ESP_OK || len != sizeof(head))
+        goto exit;
+
+    // 格式变化或传感器更换 缓存无效
+    if (head.version != MLX_CACHE_VERSION || head.paramsSize != MLX_CACHE_PARAMS_SIZE || memcmp(head.deviceID, deviceID, sizeof(head.deviceID)))
+        goto exit;
+
+    len = MLX_CACHE_PARAMS_SIZE;
+    if (nvs_get_blob(handle, MLX_CACHE_KEY_DATA, params, &len) != ESP_OK || len != MLX_CACHE_PARAMS_SIZE)
+        goto exit;
+
+    if (esp_rom_crc32_le(0, (const uint8_t*)params, MLX_CACHE_PARAMS_SIZE) != head.paramsCrc)
+        goto exit;
+
+    MLX90640_BuildCalibTable(params);
+    ret = 0;
+
+exit:
+    nvs_close(handle);
+    return ret;
+}
+
+/**
+ * @brief 保存参数缓存到NVS
+ *
+ * @param deviceID 当前传感器ID
+ * @param params 解析出的参数
+ * @return esp_err_t
+ */
+static esp_err_t saveParamsCache(const uint16_t* deviceID, const paramsMLX90640* params)
+{
+    nvs_handle handle;
+    sMlxCalibCacheHead head;
+    esp_err_t err;
+
+    memset(&head, 0, sizeof(head));
+    head.version = MLX_CACHE_VERSION;
+    head.paramsSize = MLX_CACHE_PARAMS_SIZE;
+    memcpy(head.deviceID, deviceID, sizeof(head.deviceID));
+    head.paramsCrc = esp_rom_crc32_le(0, (const uint8_t*)params, MLX_CACHE_PARAMS_SIZE);
+
+    err = nvs_open(MLX_CACHE_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK)
+        return err;
+
+    // 先写数据再写头 写入中断时头校验失败 下次启动重新生成
+    err = nvs_erase_key(handle, MLX_CACHE_KEY_HEAD);
+    if (err == ESP_OK || err == ESP_ERR_NVS_NOT_FOUND)
+        err = nvs_set_blob(handle, MLX_CACHE_KEY_DATA, params, MLX_CACHE_PARAMS_SIZE);
+    if (err == ESP_OK)
+        err = nvs_set_blob(handle, MLX_CACHE_KEY_HEAD, &head, sizeof(head));
+    if (err == ESP_OK)
+        err = nvs_commit(handle);
+
+    nvs_close(handle);
+    return err;
+}
+
 /**
  * @brief MLX90640线程
  *
@@ -80,13 +374,18 @@ int mlx90640_flushResolution(void)
 void mlx90640_task(void* arg)
 {
     int result;
+    uint16_t deviceID[3];
+    uint8_t cacheHit = 0;
+    uint8_t firstFrame = 1;
+    int64_t tStart, tConfig, tEEPROM, tParse, tSync;
+
+    tStart = esp_timer_get_time();
 
-    pMlxData = heap_caps_malloc(sizeof(sMlxData) << 1, MALLOC_CAP_8BIT);
     pMLX90640params = heap_caps_malloc(sizeof(paramsMLX90640), MALLOC_CAP_8BIT);
-    uint16_t* pMLX90640Frame = heap_caps_malloc(max(MLX90640_getFrameSize(), MLX90640_getEEPROMSize()) << 1, MALLOC_CAP_8BIT); // 分配 MLX90640 使用的内存, EEPROM读取解析完后 数据就没用了
+    uint16_t* pMLX90640Frame = heap_caps_malloc(max(MLX90640_getFrameSize(), MLX90640_getEEPROMSize()) << 1, MALLOC_CAP_8BIT | MALLOC_CAP_DMA); // 分配 MLX90640 使用的内存(内部RAM), EEPROM读取解析完后 数据就没用了
 
-    if (!pMlxData || !pMLX90640params || !pMLX90640Frame) {
-        FatalErrorMsg("Error allocating ram for MLX framebuffer %p %p %p\r\n", pMlxData, pMLX90640params, pMLX90640Frame);
+    if (framering_init(&frameRing, sizeof(sMlxData)) || !pMLX90640params || !pMLX90640Frame) {
+        FatalErrorMsg("Error allocating ram for MLX framebuffer %p %p %p\r\n", frameRing.pData, pMLX90640params, pMLX90640Frame);
         goto error;
     }
 
@@ -113,56 +412,110 @@ void mlx90640_task(void* arg)
         goto error;
     }
 
-    // 从EEPROM读取MLX90640参数
-    result = MLX90640_DumpEE(MLX_IIC_ADDRESS, pMLX90640Frame);
+    tConfig = esp_timer_get_time();
+
+    // 只读取传感器ID 和缓存的相同则使用缓存的参数 不读取整个EEPROM
+    result = MLX90640_GetDeviceID(MLX_IIC_ADDRESS, deviceID);
     if (result < 0) {
         goto error;
     }
+    cacheHit = (0 == loadParamsCache(deviceID, pMLX90640params));
+    tEEPROM = esp_timer_get_time();
 
-    // 解析EEPROM数据
-    result = MLX90640_ExtractParameters(pMLX90640Frame, pMLX90640params);
-    if (result < 0) {
-        goto error;
+    if (!cacheHit) {
+        // 没有缓存 传感器更换或缓存校验失败 读取并解析整个EEPROM 然后更新缓存
+        result = MLX90640_DumpEE(MLX_IIC_ADDRESS, pMLX90640Frame);
+        if (result < 0) {
+            goto error;
+        }
+
+        result = MLX90640_ExtractParameters(pMLX90640Frame, pMLX90640params);
+        if (result < 0) {
+            goto error;
+        }
+
+        esp_err_t err = saveParamsCache(deviceID, pMLX90640params);
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "save calibration cache failed: %s", esp_err_to_name(err));
+        }
     }
+    tParse = esp_timer_get_time();
 
     // 等待一帧结束
     MLX90640_SynchFrame(MLX_IIC_ADDRESS);
+    tSync = esp_timer_get_time();
+
+    printf("mlx90640 boot: config %lld us, id+cache %lld us, eeprom+parse %lld us, sync %lld us, cache %s\r\n",
+        tConfig - tStart, tEEPROM - tConfig, tParse - tEEPROM, tSync - tParse, cacheHit ? "hit" : "miss");
 
     while (1) {
         if (0 == MLX90640PausePlay) {
-            // 从传感器读取帧
-            sMlxData* _pMlxData = &pMlxData[lastFrameNo];
-            float* pThermoImage = _pMlxData->ThermoImage;
+            // 从传感器读取帧 每个子页的像素计算后合并到实时图像
+            float* pThermoImage = liveImage;
 
             // 连续读取帧 然后计算
+            // 低延迟模式下每个子页都发布一次 否则两个子页都读取后才发布
             uint8_t idx = 0;
+            uint16_t polls = 0;
+            int64_t readyUs = 0;
+            sMLX90640I2CStats statsStart, statsEnd;
+            MLX90640_I2CGetStats(&statsStart);
             while (true) {
                 result = MLX90640_GetFrameData(MLX_IIC_ADDRESS, pMLX90640Frame);
-                if ((0 == result || 1 == result) && (idx == result)) {
-                    // 从MLX90640读取并输出多个参数
-                    _pMlxData->Vdd = MLX90640_GetVdd(pMLX90640Frame, pMLX90640params); // 电压
-                    _pMlxData->Ta = MLX90640_GetTa(pMLX90640Frame, pMLX90640params); // 实时外壳温度
+                polls += MLX90640_GetLastPollCount();
+                if (-8 == result) {
+                    frameErrorCount++;
+                } else if (-10 == result) {
+                    frameTimeoutCount++;
+                } else if (-1 == result) {
+                    frameNackCount++;
+                }
+                uint8_t lowLatency = (LOWLATENCY_OFF != settingsParms.LowLatency);
+                if ((0 == result || 1 == result) && (lowLatency || idx == result)) {
+                    if (0 == readyUs) {
+                        readyUs = MLX90640_GetLastReadyTime();
+                    }
+
+                    // 从MLX90640读取并输出多个参数 每个子页只计算一次
+                    PROFILER_BEGIN(PROF_TO_CALC);
+                    MLX90640_UpdateFrameContext(pMLX90640Frame, pMLX90640params, &frameCtx);
 
                     // 计算环境温度用于温度补偿 手册上说的环境温度可以用外壳温度-8℃
-                    float tr = _pMlxData->Ta - TA_SHIFT;
+                    float tr = frameCtx.ta - TA_SHIFT;
+                    MLX90640_UpdateFrameTaTr(&frameCtx, settingsParms.Emissivity, tr);
 
                     // 计算每个像素的温度
-                    MLX90640_CalculateTo(pMLX90640Frame, pMLX90640params, settingsParms.Emissivity, tr, pThermoImage);
+                    MLX90640_CalculateToFast(pMLX90640Frame, pMLX90640params, &frameCtx, pThermoImage);
+                    PROFILER_END(PROF_TO_CALC);
 
                     // 计算损坏的像素值
+                    PROFILER_BEGIN(PROF_BAD_PIXEL);
                     MLX90640_BadPixelsCorrection(pMLX90640params->brokenPixels, pThermoImage, 1, pMLX90640params);
                     MLX90640_BadPixelsCorrection(pMLX90640params->outlierPixels, pThermoImage, 1, pMLX90640params);
+                    PROFILER_END(PROF_BAD_PIXEL);
 
                     idx++;
+                    if (lowLatency || idx >= 2) {
+                        publishLiveImage(result, readyUs);
+                        readyUs = 0;
+                    }
+
                     if (idx >= 2) {
+                        pollsPerFrame = polls;
+                        MLX90640_I2CGetStats(&statsEnd);
+                        i2cStatsPerFrame.reads = statsEnd.reads - statsStart.reads;
+                        i2cStatsPerFrame.writes = statsEnd.writes - statsStart.writes;
+                        i2cStatsPerFrame.verifyReads = statsEnd.verifyReads - statsStart.verifyReads;
+                        i2cStatsPerFrame.verifySkipped = statsEnd.verifySkipped - statsStart.verifySkipped;
                         break;
                     }
                 }
             }
 
-            if (NULL != pHandleEventGroup)
-                xEventGroupSetBits(pHandleEventGroup, 1 << lastFrameNo);
-            lastFrameNo = (lastFrameNo + 1) & 1;
+            if (firstFrame) {
+                firstFrame = 0;
+                printf("mlx90640 boot: first frame after %lld us\r\n", esp_timer_get_time() - tStart);
+            }
 
         } else {
             vTaskDelay(100 / portTICK_RATE_MS);
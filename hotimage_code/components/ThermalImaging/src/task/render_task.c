@@ -1,15 +1,17 @@
 #include "CelsiusSymbol.h"
 #include "thermalimaging.h"
+#include "esp_timer.h"
 
 #define IMAGE_SCALESIZE (10) // LCD缩放倍数
 #define TEMP_SCALE (10) // 温度放大倍数
 #define RIGHTPALETTEHEIGHT (160) // 右边的比例尺
+#define RENDER_PARALLEL_CHECK 0 // 1=每帧用单线程重新计算一次 与并行直接写入显存的结果比较 用于调试
 
 static int16_t* TermoImage16 = NULL; // 热成像的原始分辨率
-static int16_t* TermoHqImage16 = NULL;
-static float* gaussBuff = NULL;
-static uint16_t PaletteSteps = 0;
-static tRGBcolor* pPaletteImage = NULL; // 伪彩色指针
+static int16_t* viewImage16 = NULL; // 数字变焦时 从原始分辨率裁剪出的视口
+static int16_t* gaussImage16 = NULL; // 高斯模糊 2倍 定点双线性缩放的输入
+static sPaletteMap paletteMap; // 温度 -> 伪彩色 RGB565 已经交换字节序 可以直接写入显存
+static uint16_t paletteEqLut[PALETTE_EQ_LUT_SIZE]; // 直方图均衡 每帧重新生成的伪彩色
 static tRGBcolor* pPaletteScale = NULL; // 右边的伪彩色
 
 // 渲染左下角提示信息
@@ -20,6 +22,292 @@ typedef struct _RenderInfoStr {
 
 static RenderInfoStr renderInfoStr = { 0 };
 
+static sMlxData renderFrame; // 从帧环形缓存复制出来的当前帧
+
+// 数字变焦倍数 只插值视口内的源像素 视口放大到整个LCD
+static const uint8_t ZOOM_LEVELS[] = { 1, 2, 4 };
+#define ZOOM_COUNT (sizeof(ZOOM_LEVELS) / sizeof(ZOOM_LEVELS[0]))
+
+static sIdwScaler hqScaler[ZOOM_COUNT]; // 各变焦倍数 高斯模糊图像 -> LCD 的缩放表
+static sIdwBicubic bicubic[ZOOM_COUNT]; // 各变焦倍数 双三次插值的权重表
+static sIdwLinear linear[ZOOM_COUNT]; // 各变焦倍数 分段线性插值的分段表
+
+// 视口 源像素坐标 (没有镜像)
+typedef struct
+{
+    uint8_t zoomIdx; // ZOOM_LEVELS 的下标
+    uint8_t x; // 左上角
+    uint8_t y;
+    uint8_t width; // 宽
+    uint8_t height; // 高
+    uint16_t scale; // 源像素 -> LCD 放大倍数
+} sRenderView;
+
+static uint8_t zoomIdx = 0; // 当前变焦倍数
+static uint8_t zoomCenterX = THERMALIMAGE_RESOLUTION_WIDTH / 2; // 视口中心 源像素坐标 默认在十字准线
+static uint8_t zoomCenterY = THERMALIMAGE_RESOLUTION_HEIGHT / 2;
+
+// 并行渲染参数 插值和伪彩色按行分段 由 workpool 在两个核心上同时处理
+typedef struct
+{
+    const int16_t* pImage; // 视口内的源图像 view.width x view.height
+    sRenderView view; // 视口
+    sPaletteMap palette; // 本帧的伪彩色映射
+    uint32_t interpUs[portNUM_PROCESSORS]; // 各核心插值耗时 性能分析用
+    uint32_t paletteUs[portNUM_PROCESSORS]; // 各核心伪彩色耗时 性能分析用
+} sRenderJob;
+
+static sRenderJob renderJob;
+
+static sAutoRange autoRange; // 自动缩放 平滑伪彩色的温度范围
+
+#ifdef CONFIG_THERMAL_PROFILER
+static int64_t profilerDumpUs = 0; // 上次从串口输出性能统计的时间
+static uint8_t profilerScaleMode = ORIGINAL; // 统计周期内的插值模式 interp 阶段只统计一种模式
+
+static const char* const SCALE_MODE_NAMES[] = { "Original", "Linear", "Gauss + Bilinear", "Bicubic" };
+#endif
+
+/**
+ * @brief 分段计时开始 性能分析关闭时什么都不做
+ *
+ * @return uint32_t
+ */
+static inline uint32_t bandTimeStart(void)
+{
+#ifdef CONFIG_THERMAL_PROFILER
+    return PROFILER_NOW();
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @brief 分段计时结束 累加到当前核心
+ *
+ * @param pUs 每个核心一个计数
+ * @param start bandTimeStart 的返回值
+ */
+static inline void bandTimeAdd(uint32_t* pUs, uint32_t start)
+{
+#ifdef CONFIG_THERMAL_PROFILER
+    pUs[PROFILER_CORE_ID()] += PROFILER_NOW() - start;
+#endif
+}
+
+/**
+ * @brief 开始一帧的并行渲染
+ *
+ * @param job
+ * @param pImage 视口内的源图像
+ * @param pView 视口
+ * @param pPalette 伪彩色映射
+ */
+static void renderJobBegin(sRenderJob* job, const int16_t* pImage, const sRenderView* pView, const sPaletteMap* pPalette)
+{
+    job->pImage = pImage;
+    job->view = *pView;
+    job->palette = *pPalette;
+    memset(job->interpUs, 0, sizeof(job->interpUs));
+    memset(job->paletteUs, 0, sizeof(job->paletteUs));
+}
+
+/**
+ * @brief 记录一帧并行渲染的耗时 两个核心同时处理 取较慢的核心
+ *
+ * @param job
+ */
+static void renderJobRecord(sRenderJob* job)
+{
+#ifdef CONFIG_THERMAL_PROFILER
+    uint32_t interp = 0, palette = 0;
+
+    for (int i = 0; i < portNUM_PROCESSORS; i++) {
+        interp = job->interpUs[i] > interp ? job->interpUs[i] : interp;
+        palette = job->paletteUs[i] > palette ? job->paletteUs[i] : palette;
+    }
+
+    if (interp) {
+        PROFILER_RECORD(PROF_INTERP, interp);
+    }
+    if (palette) {
+        PROFILER_RECORD(PROF_PALETTE, palette);
+    }
+#endif
+}
+
+// 显示延迟统计 子页数据就绪 到 刷新到液晶屏
+#define LATENCY_REPORT_US 10000000 // 统计周期
+
+typedef struct
+{
+    int64_t startUs; // 统计开始时间
+    uint32_t count; // 统计的帧数
+    uint64_t sumUs; // 延迟累计
+    uint32_t maxUs; // 最大延迟
+    uint32_t lastAvgUs; // 上个周期的平均延迟
+    uint32_t lastMaxUs; // 上个周期的最大延迟
+    float lastFps; // 上个周期的显示刷新率
+} sLatencyStats;
+
+static sLatencyStats latencyStats = { 0 };
+
+/**
+ * @brief 记录一帧的显示延迟 每个统计周期从串口输出一次
+ *
+ * @param readyUs 帧数据就绪时间
+ */
+static void latency_update(int64_t readyUs)
+{
+    int64_t now = esp_timer_get_time();
+    uint32_t latency = now - readyUs;
+
+    if (0 == latencyStats.startUs) {
+        latencyStats.startUs = now;
+    }
+
+    latencyStats.count++;
+    latencyStats.sumUs += latency;
+    if (latency > latencyStats.maxUs) {
+        latencyStats.maxUs = latency;
+    }
+
+    if (now - latencyStats.startUs >= LATENCY_REPORT_US) {
+        sMLX90640I2CStats i2cStats;
+        sI2CBusStats busStats;
+
+        latencyStats.lastAvgUs = latencyStats.sumUs / latencyStats.count;
+        latencyStats.lastMaxUs = latencyStats.maxUs;
+        latencyStats.lastFps = latencyStats.count * 1000000.0f / (now - latencyStats.startUs);
+        printf("render latency: avg %u us, max %u us, %.1f fps, low latency %d\r\n",
+            latencyStats.lastAvgUs, latencyStats.lastMaxUs, latencyStats.lastFps, settingsParms.LowLatency);
+        printf("render auto range: %u rescales in %u frames\r\n", autoRange.rescales, autoRange.frames);
+        printf("render mlx90640 errors: -8 %u, -10 %u, -1 %u, dropped %u\r\n",
+            mlx90640_getFrameErrorCount(), mlx90640_getFrameTimeoutCount(), mlx90640_getFrameNackCount(), mlx90640_getDroppedFrames());
+        printf("render mlx90640 polls: %u per frame\r\n", mlx90640_getPollsPerFrame());
+        mlx90640_getI2CStatsPerFrame(&i2cStats);
+        printf("render mlx90640 i2c per frame: reads %u, writes %u, verify reads %u, verify skipped %u\r\n",
+            i2cStats.reads, i2cStats.writes, i2cStats.verifyReads, i2cStats.verifySkipped);
+        printf("render i2c: cmd link heap fallbacks %u\r\n", i2c_get_cmd_link_heap_fallbacks());
+        i2c_bus_get_stats(&busStats);
+        printf("render i2c bus: high %u, low %u, low in idle window %u, low deadline miss %u\r\n",
+            busStats.high, busStats.low, busStats.lowInWindow, busStats.lowDeadlineMiss);
+
+        latencyStats.startUs = now;
+        latencyStats.count = 0;
+        latencyStats.sumUs = 0;
+        latencyStats.maxUs = 0;
+    }
+}
+
+/**
+ * @brief 获取上个统计周期的显示延迟
+ *
+ * @param pAvgUs 平均延迟
+ * @param pMaxUs 最大延迟
+ * @param pFps 显示刷新率
+ */
+void render_getLatency(uint32_t* pAvgUs, uint32_t* pMaxUs, float* pFps)
+{
+    *pAvgUs = latencyStats.lastAvgUs;
+    *pMaxUs = latencyStats.lastMaxUs;
+    *pFps = latencyStats.lastFps;
+}
+
+/**
+ * @brief 获取自动缩放的统计
+ *
+ * @param pFrames 更新的帧数
+ * @param pRescales 重新缩放伪彩色的次数
+ */
+void render_getAutoRangeStats(uint32_t* pFrames, uint32_t* pRescales)
+{
+    *pFrames = autoRange.frames;
+    *pRescales = autoRange.rescales;
+}
+
+/**
+ * @brief 计算当前变焦的视口 视口不超出热成像
+ *
+ * @param pView
+ */
+static void viewUpdate(sRenderView* pView)
+{
+    const uint8_t zoom = ZOOM_LEVELS[zoomIdx];
+    int16_t x, y;
+
+    pView->zoomIdx = zoomIdx;
+    pView->width = THERMALIMAGE_RESOLUTION_WIDTH / zoom;
+    pView->height = THERMALIMAGE_RESOLUTION_HEIGHT / zoom;
+    pView->scale = IMAGE_SCALESIZE * zoom;
+
+    x = zoomCenterX - pView->width / 2;
+    y = zoomCenterY - pView->height / 2;
+    pView->x = x < 0 ? 0 : (x > THERMALIMAGE_RESOLUTION_WIDTH - pView->width ? THERMALIMAGE_RESOLUTION_WIDTH - pView->width : x);
+    pView->y = y < 0 ? 0 : (y > THERMALIMAGE_RESOLUTION_HEIGHT - pView->height ? THERMALIMAGE_RESOLUTION_HEIGHT - pView->height : y);
+}
+
+/**
+ * @brief 数字变焦 1x -> 2x -> 4x -> 1x 回到 1x 时视口中心回到十字准线
+ *
+ */
+void render_zoomNext(void)
+{
+    zoomIdx = (zoomIdx + 1) % ZOOM_COUNT;
+    if (0 == zoomIdx) {
+        zoomCenterX = THERMALIMAGE_RESOLUTION_WIDTH / 2;
+        zoomCenterY = THERMALIMAGE_RESOLUTION_HEIGHT / 2;
+    }
+    autorange_reset(&autoRange); // 画面变了 自动缩放直接使用新视口的范围
+
+    tips_printf("Zoom %dx", ZOOM_LEVELS[zoomIdx]);
+}
+
+/**
+ * @brief 视口中心在一个方向上移动 到边缘后从另一边开始
+ *
+ * @param pCenter 视口中心
+ * @param dir 1=坐标增加 -1=坐标减小
+ * @param size 热成像的宽(高)
+ * @param viewSize 视口的宽(高)
+ */
+static void zoomPanAxis(uint8_t* pCenter, int8_t dir, uint8_t size, uint8_t viewSize)
+{
+    const int16_t lo = viewSize / 2;
+    const int16_t hi = size - (viewSize - viewSize / 2);
+    const int16_t step = (viewSize >= 4) ? viewSize / 4 : 1;
+    int16_t c = *pCenter < lo ? lo : (*pCenter > hi ? hi : *pCenter);
+
+    if (dir > 0) {
+        c = (c == hi) ? lo : (c + step > hi ? hi : c + step);
+    } else if (dir < 0) {
+        c = (c == lo) ? hi : (c - step < lo ? lo : c - step);
+    }
+
+    *pCenter = c;
+}
+
+/**
+ * @brief 移动变焦视口 按LCD显示方向 每次移动视口的四分之一
+ *
+ * @param dx 1=向右 -1=向左 0=不动
+ * @param dy 1=向下 -1=向上 0=不动
+ */
+void render_zoomPan(int8_t dx, int8_t dy)
+{
+    sRenderView view;
+
+    if (0 == zoomIdx) {
+        tips_printf("Zoom 1x, nothing to pan");
+        return;
+    }
+
+    viewUpdate(&view);
+    zoomPanAxis(&zoomCenterX, -dx, THERMALIMAGE_RESOLUTION_WIDTH, view.width); // 热成像从右到左
+    zoomPanAxis(&zoomCenterY, dy, THERMALIMAGE_RESOLUTION_HEIGHT, view.height);
+    autorange_reset(&autoRange);
+}
+
 /**
  * @brief 在窗口左下角显示一行提示
  *
@@ -36,15 +324,12 @@ void tips_printf(const char* args, ...)
 }
 
 /**
- * @brief 重新生成伪彩色
+ * @brief 伪彩色对应新的温度范围 伪彩色表只生成一次 这里只重新计算比例
  *
  */
 static void RedrawPalette(float minTemp, float maxTemp)
 {
-    // 生成一个新的伪彩色
-    float delta = (maxTemp - minTemp) * IMAGE_SCALESIZE;
-    PaletteSteps = (uint16_t)delta;
-    getPalette(settingsParms.ColorScale, PaletteSteps, pPaletteImage);
+    palette_setMap(&paletteMap, settingsParms.ColorScale, (int16_t)(minTemp * TEMP_SCALE), (int16_t)(maxTemp * TEMP_SCALE));
 }
 
 /**
@@ -55,75 +340,199 @@ void buildPalette(void)
 {
     getPalette(settingsParms.ColorScale, RIGHTPALETTEHEIGHT, pPaletteScale);
 
-    if (!settingsParms.AutoScaleMode) {
-        RedrawPalette(settingsParms.minTempNew, settingsParms.maxTempNew);
-    }
+    RedrawPalette(settingsParms.minTempNew, settingsParms.maxTempNew);
 }
 
 /**
  * @brief 热成像绘图 根据分辨率绘制 (原始分辨率)
  *
  * @param pImage 热成像图 放大10倍
- * @param pPalette 伪彩色
- * @param PaletteSize (最大温度-最小温度)*10+1
+ * @param width 热成像图宽
+ * @param height 热成像图高
+ * @param pPalette 伪彩色映射
  * @param X 绘制起始坐标偏移
  * @param Y 绘制起始坐标偏移
  * @param scaleWidth 放大倍数
  * @param scaleHeight 放大倍数
- * @param minTemp 最小温度
  */
-static void DrawImage(int16_t* pImage, tRGBcolor* pPalette, uint16_t PaletteSize, uint16_t X, uint16_t Y, uint8_t scaleWidth, uint8_t scaleHeight, float minTemp)
+static void DrawImage(const int16_t* pImage, uint8_t width, uint8_t height, const sPaletteMap* pPalette, uint16_t X, uint16_t Y, uint8_t scaleWidth, uint8_t scaleHeight)
 {
     int cnt = 0;
 
-    for (int row = 0; row < THERMALIMAGE_RESOLUTION_HEIGHT; row++) { // 24行
-        for (int col = 0; col < THERMALIMAGE_RESOLUTION_WIDTH; col++, cnt++) { // 32列
-            int16_t colorIdx = pImage[cnt] - (minTemp * TEMP_SCALE); // 颜色索引
-
-            if (colorIdx < 0) {
-                colorIdx = 0;
-            } else if (colorIdx >= PaletteSize) {
-                colorIdx = PaletteSize - 1;
-            }
+    for (int row = 0; row < height; row++) { // 24行
+        for (int col = 0; col < width; col++, cnt++) { // 32列
+            uint16_t color = palette_color(pPalette, pImage[cnt]);
 
-            uint16_t color = RGB565(pPalette[colorIdx].r, pPalette[colorIdx].g, pPalette[colorIdx].b);
-            dispcolor_FillRect((THERMALIMAGE_RESOLUTION_WIDTH - 1 - col) * scaleWidth + X, row * scaleHeight + Y, scaleHeight, scaleHeight, color);
+            color = (color >> 8) | (color << 8); // 显存字节序 -> RGB565
+            dispcolor_FillRect((width - 1 - col) * scaleWidth + X, row * scaleHeight + Y, scaleHeight, scaleHeight, color);
         }
     }
 }
 
 /**
- * @brief 热成像绘图 根据pImage直接显示 (提前做好插值)
+ * @brief 没有显存时 把一行伪彩色逐点画到液晶上
  *
- * @param pImage 热成像图
- * @param pPalette 伪彩色
- * @param PaletteSize (最大温度-最小温度)*10+1
- * @param X LCD起始坐标
- * @param Y LCD起始坐标
+ * @param pLine 一行伪彩色 显存字节序 已经水平镜像
+ * @param y LCD行
  * @param width LCD显示宽度
- * @param height LCD显示高度
- * @param minTemp  最小温度
  */
-static void DrawHQImage(int16_t* pImage, tRGBcolor* pPalette, uint16_t PaletteSize, uint16_t X, uint16_t Y, uint16_t width, uint16_t height, float minTemp)
+static void DrawFrameLine(const uint16_t* pLine, uint16_t y, uint16_t width)
 {
-    int cnt = 0;
+    for (uint16_t x = 0; x < width; x++) {
+        uint16_t color = pLine[x];
 
-    for (int row = 0; row < height; row++) {
-        for (int col = 0; col < width; col++) {
-            int16_t colorIdx = pImage[cnt] - (int16_t)(minTemp * TEMP_SCALE);
-            cnt++;
+        color = (color >> 8) | (color << 8); // 显存字节序 -> RGB565
+        dispcolor_DrawPixel(x, y, color);
+    }
+}
 
-            if (colorIdx < 0) {
-                colorIdx = 0;
-            } else if (colorIdx >= PaletteSize) {
-                colorIdx = PaletteSize - 1;
-            }
+/**
+ * @brief 并行渲染 高斯模糊 按输出行分段
+ *
+ * @param arg sRenderJob
+ * @param start 起始行
+ * @param end 结束行(不包含)
+ */
+static void RenderBand_Gauss(void* arg, int start, int end)
+{
+    sRenderJob* job = (sRenderJob*)arg;
+    uint32_t t0 = bandTimeStart();
 
-            uint16_t color = RGB565(pPalette[colorIdx].r, pPalette[colorIdx].g, pPalette[colorIdx].b);
-            dispcolor_DrawPixel((width - col - 1) + X, row + Y, color);
+    idwGaussRows(job->pImage, job->view.width, job->view.height, 2, gaussImage16, start, end);
+    bandTimeAdd(job->interpUs, t0);
+}
+
+// 插值 + 伪彩色 写入 pFrame (第 rowStart 行的地址) 的 [rowStart, rowEnd) 行
+typedef void (*RenderRowsFunc)(const sRenderJob* job, uint16_t* pFrame, uint16_t rowStart, uint16_t rowEnd);
+
+/**
+ * @brief 并行渲染 插值 + 伪彩色 按LCD行分段 插值结果直接查表写入显存 不需要整幅的中间缓存
+ *        没有显存时逐行写入行缓存再逐点绘制
+ *
+ * @param job
+ * @param start 起始行
+ * @param end 结束行(不包含)
+ * @param func 插值 + 伪彩色 的函数
+ */
+static void RenderBandDraw(sRenderJob* job, int start, int end, RenderRowsFunc func)
+{
+    uint16_t* pFrame = dispcolor_getBuffer();
+    const uint16_t width = dispcolor_getWidth();
+    uint32_t t0;
+
+    if (NULL != pFrame) {
+        t0 = bandTimeStart();
+        func(job, pFrame + start * width, start, end);
+        bandTimeAdd(job->interpUs, t0);
+        return;
+    }
+
+    uint16_t line[IDW_LINEAR_MAX_WIDTH];
+    for (int row = start; row < end; row++) {
+        t0 = bandTimeStart();
+        func(job, line, row, row + 1);
+        bandTimeAdd(job->interpUs, t0);
+
+        t0 = bandTimeStart();
+        DrawFrameLine(line, row, width);
+        bandTimeAdd(job->paletteUs, t0);
+    }
+}
+
+// 分段线性插值 (线性插值模式)
+static void RenderRows_Linear(const sRenderJob* job, uint16_t* pFrame, uint16_t rowStart, uint16_t rowEnd)
+{
+    idwLinearPaletteRows(&linear[job->view.zoomIdx], job->pImage, pFrame, &job->palette, rowStart, rowEnd);
+}
+
+// 高斯模糊后的定点双线性缩放
+static void RenderRows_Bilinear(const sRenderJob* job, uint16_t* pFrame, uint16_t rowStart, uint16_t rowEnd)
+{
+    idwScalePaletteRows(&hqScaler[job->view.zoomIdx], gaussImage16, pFrame, &job->palette, rowStart, rowEnd);
+}
+
+// 双三次插值
+static void RenderRows_Bicubic(const sRenderJob* job, uint16_t* pFrame, uint16_t rowStart, uint16_t rowEnd)
+{
+    idwBicubicPaletteRows(&bicubic[job->view.zoomIdx], job->pImage, pFrame, &job->palette, rowStart, rowEnd);
+}
+
+/**
+ * @brief 并行渲染 分段线性插值 + 伪彩色 按LCD行分段
+ *
+ * @param arg sRenderJob
+ * @param start 起始行
+ * @param end 结束行(不包含)
+ */
+static void RenderBand_LinearDraw(void* arg, int start, int end)
+{
+    RenderBandDraw((sRenderJob*)arg, start, end, RenderRows_Linear);
+}
+
+/**
+ * @brief 并行渲染 定点双线性缩放 + 伪彩色 按LCD行分段
+ *
+ * @param arg sRenderJob
+ * @param start 起始行
+ * @param end 结束行(不包含)
+ */
+static void RenderBand_BilinearDraw(void* arg, int start, int end)
+{
+    RenderBandDraw((sRenderJob*)arg, start, end, RenderRows_Bilinear);
+}
+
+/**
+ * @brief 并行渲染 双三次插值 + 伪彩色 按LCD行分段
+ *
+ * @param arg sRenderJob
+ * @param start 起始行
+ * @param end 结束行(不包含)
+ */
+static void RenderBand_BicubicDraw(void* arg, int start, int end)
+{
+    RenderBandDraw((sRenderJob*)arg, start, end, RenderRows_Bicubic);
+}
+
+#if RENDER_PARALLEL_CHECK
+/**
+ * @brief 用单线程重新计算 高斯模糊 + 定点双线性缩放 + 伪彩色 与并行直接写入显存的结果比较
+ *        高斯模糊结果 (1x 时 64x48) 从内部RAM分配 缩放结果逐行计算 只需要一行的缓存
+ *
+ * @param job 本帧的并行渲染参数
+ */
+static void RenderParallelCheck(const sRenderJob* job)
+{
+    const size_t gaussSize = ((job->view.width * 2) * (job->view.height * 2)) * sizeof(int16_t);
+    int16_t* pGauss = heap_caps_malloc(gaussSize, MALLOC_CAP_8BIT);
+    int16_t line[IDW_LINEAR_MAX_WIDTH];
+    uint32_t pixelErrors = 0;
+
+    if (NULL == pGauss) {
+        printf("render parallel check: no memory\r\n");
+        return;
+    }
+
+    idwGauss(job->pImage, job->view.width, job->view.height, 2, pGauss);
+
+    for (int row = 0; row < dispcolor_getHeight(); row++) {
+        idwScaleRows(&hqScaler[job->view.zoomIdx], pGauss, line, row, row + 1);
+
+        for (int col = 0; col < dispcolor_getWidth(); col++) {
+            uint16_t color = palette_color(&job->palette, line[col]);
+
+            color = (color >> 8) | (color << 8); // 显存字节序 -> RGB565
+            if (dispcolor_GetPixel(dispcolor_getWidth() - col - 1, row) != color) {
+                pixelErrors++;
+            }
         }
     }
+
+    printf("render parallel check: gauss %s, %u pixels differ\r\n",
+        memcmp(pGauss, gaussImage16, gaussSize) ? "MISMATCH" : "ok", pixelErrors);
+
+    heap_caps_free(pGauss);
 }
+#endif
 
 /**
  * @brief 绘制右边的伪彩色 色条
@@ -140,7 +549,14 @@ static void DrawPalette(uint16_t X, uint16_t Y, uint16_t Width, uint16_t Height,
 #define PRINTFCHAR "%.1f%s"
     // 绘制颜色尺
     for (int i = 0; i < Height; i++) {
-        uint16_t color = RGB565(pPaletteScale[i].r, pPaletteScale[i].g, pPaletteScale[i].b);
+        uint16_t color;
+        if (AUTOSCALE_HISTOGRAM == settingsParms.AutoScaleMode) {
+            // 直方图均衡 颜色尺按本帧的映射绘制 颜色不是线性分布
+            color = palette_color(&paletteMap, paletteMap.offset + paletteMap.range * i / (Height - 1));
+            color = (color >> 8) | (color << 8);
+        } else {
+            color = RGB565(pPaletteScale[i].r, pPaletteScale[i].g, pPaletteScale[i].b);
+        }
         dispcolor_FillRect(X, Y + Height - i - 1, Width, 1, color);
     }
 
@@ -214,103 +630,63 @@ static void DrawCenterTemp(uint16_t X, uint16_t Y, uint16_t Width, uint16_t Heig
 }
 
 /**
- * @brief 根据不同插值算法 计算标记点的坐标偏移
+ * @brief 热成像坐标 -> LCD坐标 各插值算法都把视口放大到整个LCD 标记在源像素的中心
  *
- * @param pX
+ * @param pView 视口
+ * @param pX 输入热成像坐标 输出LCD坐标
  * @param pY
+ * @return uint8_t 1=在视口内 0=不在视口内
  */
-static void ThermoToImagePosition(int16_t* pX, int16_t* pY)
+static uint8_t ThermoToImagePosition(const sRenderView* pView, int16_t* pX, int16_t* pY)
 {
-    switch (settingsParms.ScaleMode) {
-    case ORIGINAL:
-        *pX = (*pX) * IMAGE_SCALESIZE;
-        *pY = (*pY) * IMAGE_SCALESIZE;
-        break;
+    int16_t x = *pX - pView->x;
+    int16_t y = *pY - pView->y;
 
-    case LINEAR:
-        *pX = (*pX) * IMAGE_SCALESIZE;
-        *pY = (*pY) * IMAGE_SCALESIZE;
-        break;
-
-    case HQ3X_2X:
-        *pX = (*pX) * IMAGE_SCALESIZE;
-        *pY = (*pY) * IMAGE_SCALESIZE;
-        break;
+    if (x < 0 || x >= pView->width || y < 0 || y >= pView->height) {
+        return 0;
     }
+
+    *pX = (pView->width - x - 1) * pView->scale + pView->scale / 2; // 热成像从右到左 要取反
+    *pY = y * pView->scale + pView->scale / 2;
+    return 1;
 }
 
 /**
  * @brief 在热成像上 标记最大 最小 温度值的点
  *
  * @param pMlxData MLX90640数据
+ * @param pView 视口
  */
-static void DrawMarkers(sMlxData* pMlxData)
+static void DrawMarkers(sMlxData* pMlxData, const sRenderView* pView)
 {
     uint8_t lineHalf = 4;
 
     // 绘制* 最大温度
-    int16_t x = THERMALIMAGE_RESOLUTION_WIDTH - pMlxData->maxT_X - 1; // 热成像从右到左 要取反
+    int16_t x = pMlxData->maxT_X;
     int16_t y = pMlxData->maxT_Y;
-    ThermoToImagePosition(&x, &y);
-
-    uint16_t mainColor = RED;
-    dispcolor_DrawLine(x + 1, y - lineHalf + 1, x + 1, y + lineHalf + 1, BLACK); // 阴影黑色
-    dispcolor_DrawLine(x - lineHalf + 1, y + 1, x + lineHalf + 1, y + 1, BLACK);
-    dispcolor_DrawLine(x - lineHalf + 1, y - lineHalf + 1, x + lineHalf + 1, y + lineHalf + 1, BLACK);
-    dispcolor_DrawLine(x - lineHalf + 1, y + lineHalf + 1, x + lineHalf + 1, y - lineHalf + 1, BLACK);
-
-    dispcolor_DrawLine(x, y - lineHalf, x, y + lineHalf, mainColor);
-    dispcolor_DrawLine(x - lineHalf, y, x + lineHalf, y, mainColor);
-    dispcolor_DrawLine(x - lineHalf, y - lineHalf, x + lineHalf, y + lineHalf, mainColor);
-    dispcolor_DrawLine(x - lineHalf, y + lineHalf, x + lineHalf, y - lineHalf, mainColor);
-
-    // 绘制X 最小温度
-    x = THERMALIMAGE_RESOLUTION_WIDTH - pMlxData->minT_X - 1;
-    y = pMlxData->minT_Y;
-    ThermoToImagePosition(&x, &y);
-
-    mainColor = RGB565(0, 200, 245);
-    dispcolor_DrawLine(x - lineHalf + 1, y - lineHalf + 1, x + lineHalf + 1, y + lineHalf + 1, BLACK); // 阴影黑色
-    dispcolor_DrawLine(x - lineHalf + 1, y + lineHalf + 1, x + lineHalf + 1, y - lineHalf + 1, BLACK);
-    dispcolor_DrawLine(x - lineHalf, y - lineHalf, x + lineHalf, y + lineHalf, mainColor); // 蓝色
-    dispcolor_DrawLine(x - lineHalf, y + lineHalf, x + lineHalf, y - lineHalf, mainColor);
-}
-
-/**
- * @brief 在热成像上 标记最大 最小 温度值的点
- * 高斯模糊 双线性插值
- * @param pMlxData
- */
-static void DrawMarkersHQ(sMlxData* pMlxData)
-{
-    uint8_t lineHalf = 4;
-
-    int16_t x = THERMALIMAGE_RESOLUTION_WIDTH - pMlxData->maxT_X - 1;
-    int16_t y = pMlxData->maxT_Y;
-    ThermoToImagePosition(&x, &y);
-
-    // 绘制* 最大温度
-    uint16_t mainColor = RED;
-    dispcolor_DrawLine(x + 1, y - lineHalf + 1, x + 1, y + lineHalf + 1, BLACK);
-    dispcolor_DrawLine(x - lineHalf + 1, y + 1, x + lineHalf + 1, y + 1, BLACK);
-    dispcolor_DrawLine(x - lineHalf + 1, y - lineHalf + 1, x + lineHalf + 1, y + lineHalf + 1, BLACK);
-    dispcolor_DrawLine(x - lineHalf + 1, y + lineHalf + 1, x + lineHalf + 1, y - lineHalf + 1, BLACK);
-
-    dispcolor_DrawLine(x, y - lineHalf, x, y + lineHalf, mainColor);
-    dispcolor_DrawLine(x - lineHalf, y, x + lineHalf, y, mainColor);
-    dispcolor_DrawLine(x - lineHalf, y - lineHalf, x + lineHalf, y + lineHalf, mainColor);
-    dispcolor_DrawLine(x - lineHalf, y + lineHalf, x + lineHalf, y - lineHalf, mainColor);
+    if (ThermoToImagePosition(pView, &x, &y)) {
+        uint16_t mainColor = RED;
+        dispcolor_DrawLine(x + 1, y - lineHalf + 1, x + 1, y + lineHalf + 1, BLACK); // 阴影黑色
+        dispcolor_DrawLine(x - lineHalf + 1, y + 1, x + lineHalf + 1, y + 1, BLACK);
+        dispcolor_DrawLine(x - lineHalf + 1, y - lineHalf + 1, x + lineHalf + 1, y + lineHalf + 1, BLACK);
+        dispcolor_DrawLine(x - lineHalf + 1, y + lineHalf + 1, x + lineHalf + 1, y - lineHalf + 1, BLACK);
+
+        dispcolor_DrawLine(x, y - lineHalf, x, y + lineHalf, mainColor);
+        dispcolor_DrawLine(x - lineHalf, y, x + lineHalf, y, mainColor);
+        dispcolor_DrawLine(x - lineHalf, y - lineHalf, x + lineHalf, y + lineHalf, mainColor);
+        dispcolor_DrawLine(x - lineHalf, y + lineHalf, x + lineHalf, y - lineHalf, mainColor);
+    }
 
     // 绘制X 最小温度
-    x = THERMALIMAGE_RESOLUTION_WIDTH - pMlxData->minT_X - 1;
+    x = pMlxData->minT_X;
     y = pMlxData->minT_Y;
-    ThermoToImagePosition(&x, &y);
-
-    mainColor = RGB565(0, 200, 245);
-    dispcolor_DrawLine(x - lineHalf + 1, y - lineHalf + 1, x + lineHalf + 1, y + lineHalf + 1, BLACK);
-    dispcolor_DrawLine(x - lineHalf + 1, y + lineHalf + 1, x + lineHalf + 1, y - lineHalf + 1, BLACK);
-    dispcolor_DrawLine(x - lineHalf, y - lineHalf, x + lineHalf, y + lineHalf, mainColor);
-    dispcolor_DrawLine(x - lineHalf, y + lineHalf, x + lineHalf, y - lineHalf, mainColor);
+    if (ThermoToImagePosition(pView, &x, &y)) {
+        uint16_t mainColor = RGB565(0, 200, 245);
+        dispcolor_DrawLine(x - lineHalf + 1, y - lineHalf + 1, x + lineHalf + 1, y + lineHalf + 1, BLACK); // 阴影黑色
+        dispcolor_DrawLine(x - lineHalf + 1, y + lineHalf + 1, x + lineHalf + 1, y - lineHalf + 1, BLACK);
+        dispcolor_DrawLine(x - lineHalf, y - lineHalf, x + lineHalf, y + lineHalf, mainColor); // 蓝色
+        dispcolor_DrawLine(x - lineHalf, y + lineHalf, x + lineHalf, y - lineHalf, mainColor);
+    }
 }
 
 /**
@@ -391,14 +767,38 @@ static void DrawBattery(uint16_t X, uint16_t Y)
 static int8_t AllocThermoImageBuffers(void)
 {
     TermoImage16 = heap_caps_malloc((THERMALIMAGE_RESOLUTION_WIDTH * THERMALIMAGE_RESOLUTION_HEIGHT) << 1, MALLOC_CAP_8BIT); // 热成像的原始分辨率
-    TermoHqImage16 = heap_caps_malloc((dispcolor_getWidth() * dispcolor_getHeight()) << 1, MALLOC_CAP_8BIT); // 线性缩放
-    gaussBuff = heap_caps_malloc(((THERMALIMAGE_RESOLUTION_WIDTH * 2) * (THERMALIMAGE_RESOLUTION_HEIGHT * 2)) * sizeof(float), MALLOC_CAP_8BIT /*| MALLOC_CAP_SPIRAM*/); // 高斯缩放
+    viewImage16 = heap_caps_malloc((THERMALIMAGE_RESOLUTION_WIDTH * THERMALIMAGE_RESOLUTION_HEIGHT) << 1, MALLOC_CAP_8BIT); // 数字变焦的视口
+    gaussImage16 = heap_caps_malloc(((THERMALIMAGE_RESOLUTION_WIDTH * 2) * (THERMALIMAGE_RESOLUTION_HEIGHT * 2)) * sizeof(int16_t), MALLOC_CAP_8BIT); // 高斯缩放
 
-    pPaletteImage = heap_caps_malloc(((MAX_TEMP - MIN_TEMP) * IMAGE_SCALESIZE) << 1, MALLOC_CAP_8BIT); // 伪彩色
     pPaletteScale = heap_caps_malloc((THERMALIMAGE_RESOLUTION_HEIGHT * IMAGE_SCALESIZE) << 1, MALLOC_CAP_8BIT); // 右边显示的伪彩色条
 
-    if (!TermoImage16 || !TermoHqImage16 || !gaussBuff || !pPaletteImage || !pPaletteScale)
+    if (!TermoImage16 || !viewImage16 || !gaussImage16 || !pPaletteScale)
         return -1;
+
+    // 所有伪彩色的查表只生成一次 切换伪彩色和自动缩放不再重新生成
+    for (int i = 0; i < COLOR_MAX; i++) {
+        if (NULL == palette_getLut(i))
+            return -1;
+    }
+    if (palette_setMap(&paletteMap, settingsParms.ColorScale, SCALE_DEFAULT_MIN * TEMP_SCALE, SCALE_DEFAULT_MAX * TEMP_SCALE))
+        return -1;
+
+    for (int i = 0; i < ZOOM_COUNT; i++) {
+        const uint8_t viewWidth = THERMALIMAGE_RESOLUTION_WIDTH / ZOOM_LEVELS[i];
+        const uint8_t viewHeight = THERMALIMAGE_RESOLUTION_HEIGHT / ZOOM_LEVELS[i];
+
+        // 高斯模糊 视口2倍 (1x 时 64x48) -> LCD 的双线性缩放表
+        if (idwScalerInit(&hqScaler[i], viewWidth * 2, viewHeight * 2, dispcolor_getWidth(), dispcolor_getHeight()))
+            return -1;
+
+        // 双三次插值 视口 (1x 时 32x24) 放大到 LCD
+        if (idwBicubicInit(&bicubic[i], viewWidth, viewHeight, IMAGE_SCALESIZE * ZOOM_LEVELS[i]))
+            return -1;
+
+        // 分段线性插值 视口放大到 LCD
+        if (idwLinearInit(&linear[i], viewWidth, viewHeight, IMAGE_SCALESIZE * ZOOM_LEVELS[i]))
+            return -1;
+    }
     return 0;
 }
 
@@ -426,6 +826,11 @@ static void drawTitleItem(sMlxData* pMlxData)
         }
     }
 
+    // 数字变焦倍数
+    if (zoomIdx) {
+        dispcolor_printf(offsetX, 4, FONTID_6X8M, WHITE, "Zoom:%dx", ZOOM_LEVELS[zoomIdx]);
+    }
+
     // 绘制刷新率
     // dispcolor_printf(offsetX, 4, FONTID_6X8M, WHITE, "%.1f FPS\r\n", FPS_RATES[settingsParms.MLX90640FPS]); // 这个是热成像的帧率
 
@@ -451,28 +856,69 @@ static void drawBottomItem(sMlxData* pMlxData)
 #endif
 }
 
+#ifdef CONFIG_THERMAL_PROFILER
+/**
+ * @brief 显示各阶段耗时 并定期从串口输出
+ *
+ */
+static void DrawProfiler(void)
+{
+#ifdef CONFIG_THERMAL_PROFILER_OVERLAY
+    sProfilerStats stats;
+
+    for (int i = 0; i < PROF_STAGE_COUNT; i++) {
+        profiler_get_stats(i, &stats);
+        dispcolor_printf_Bg(0, 26 + i * 9, FONTID_6X8M, YELLOW, BLACK, "%-9s%5u/%5uus", profiler_stage_name(i), stats.avgUs, stats.p99Us);
+    }
+#endif
+
+    // 切换插值模式后重新统计 例如 Gauss + Bilinear 的 interp 只包含高斯模糊和定点缩放
+    if (settingsParms.ScaleMode != profilerScaleMode) {
+        profilerScaleMode = settingsParms.ScaleMode;
+        profiler_reset();
+        profilerDumpUs = esp_timer_get_time();
+    }
+
+#if CONFIG_THERMAL_PROFILER_DUMP_PERIOD > 0
+    int64_t now = esp_timer_get_time();
+    if (now - profilerDumpUs >= CONFIG_THERMAL_PROFILER_DUMP_PERIOD * 1000000LL) {
+        if (profilerDumpUs) {
+            printf("profiler: interpolation %s\r\n", SCALE_MODE_NAMES[profilerScaleMode]);
+            profiler_dump();
+            profiler_reset();
+        }
+        profilerDumpUs = now;
+    }
+#endif
+}
+#endif
+
 /**
- * @brief 计算最大温度 最小温度 中间温度
+ * @brief 计算视口内的最大温度 最小温度 中间温度
  *
+ * @param pMlxData
+ * @param pView 视口 没有变焦时是整个热成像
  */
-static void CalcTempFromMLX90640(sMlxData* pMlxData)
+static void CalcTempFromMLX90640(sMlxData* pMlxData, const sRenderView* pView)
 {
     const float* pThermoImage = pMlxData->ThermoImage;
+    const uint8_t cX = pView->x + (pView->width >> 1); // 视口中心右下的像素
+    const uint8_t cY = pView->y + (pView->height >> 1);
 
     // 计算屏幕中心的温度 累加中间4个像素的值
     pMlxData->CenterTemp = //
-        pThermoImage[THERMALIMAGE_RESOLUTION_WIDTH * ((THERMALIMAGE_RESOLUTION_HEIGHT >> 1) - 1) + ((THERMALIMAGE_RESOLUTION_WIDTH >> 1) - 1)] + // (32 * (24 / 2 - 1)) + (32 / 2 - 1)
-        pThermoImage[THERMALIMAGE_RESOLUTION_WIDTH * ((THERMALIMAGE_RESOLUTION_HEIGHT >> 1) - 1) + (THERMALIMAGE_RESOLUTION_WIDTH >> 1)] + // (32 * (24 / 2 - 1)) + (32 / 2)
-        pThermoImage[THERMALIMAGE_RESOLUTION_WIDTH * (THERMALIMAGE_RESOLUTION_HEIGHT >> 1) + ((THERMALIMAGE_RESOLUTION_WIDTH >> 1) - 1)] + // (32 * (24 / 2)) + (32 / 2 - 1)
-        pThermoImage[THERMALIMAGE_RESOLUTION_WIDTH * (THERMALIMAGE_RESOLUTION_HEIGHT >> 1) + (THERMALIMAGE_RESOLUTION_WIDTH >> 1)]; // (32 * (24 / 2)) + (32 / 2)
+        pThermoImage[THERMALIMAGE_RESOLUTION_WIDTH * (cY - 1) + (cX - 1)] + // (32 * (24 / 2 - 1)) + (32 / 2 - 1)
+        pThermoImage[THERMALIMAGE_RESOLUTION_WIDTH * (cY - 1) + cX] + // (32 * (24 / 2 - 1)) + (32 / 2)
+        pThermoImage[THERMALIMAGE_RESOLUTION_WIDTH * cY + (cX - 1)] + // (32 * (24 / 2)) + (32 / 2 - 1)
+        pThermoImage[THERMALIMAGE_RESOLUTION_WIDTH * cY + cX]; // (32 * (24 / 2)) + (32 / 2)
     pMlxData->CenterTemp /= 4;
 
-    // 搜索帧中的最小和最大温度 及坐标
+    // 搜索视口中的最小和最大温度 及坐标
     pMlxData->minT = MAX_TEMP;
     pMlxData->maxT = MIN_TEMP;
 
-    for (uint8_t y = 0; y < THERMALIMAGE_RESOLUTION_HEIGHT; y++) {
-        for (uint8_t x = 0; x < THERMALIMAGE_RESOLUTION_WIDTH; x++) {
+    for (uint8_t y = pView->y; y < pView->y + pView->height; y++) {
+        for (uint8_t x = pView->x; x < pView->x + pView->width; x++) {
             float temp = pThermoImage[y * THERMALIMAGE_RESOLUTION_WIDTH + x]; // 得到像素温度
 
             if (pMlxData->maxT < temp) {
@@ -506,13 +952,26 @@ static void CalcTempFromMLX90640(sMlxData* pMlxData)
 void render_task(void* arg)
 {
     const uint16_t MLX90640PIXSIZE = THERMALIMAGE_RESOLUTION_WIDTH * THERMALIMAGE_RESOLUTION_HEIGHT; // MLX90640总像素大小
-    float minTemp = MAX_TEMP, maxTemp = MIN_TEMP;
 
     // 用于缩放算法、源图像和最终图像的缓冲区
     if (AllocThermoImageBuffers()) {
         goto error;
     }
 
+    // 自动缩放 伪彩色范围的平滑参数
+    const sAutoRangeConfig autoRangeConfig = {
+        .attack = CONFIG_THERMAL_AUTORANGE_ATTACK / 100.0f,
+        .release = CONFIG_THERMAL_AUTORANGE_RELEASE / 100.0f,
+        .deadband = CONFIG_THERMAL_AUTORANGE_DEADBAND / 10.0f,
+        .percentile = CONFIG_THERMAL_AUTORANGE_PERCENTILE,
+    };
+    autorange_init(&autoRange, &autoRangeConfig);
+
+    // 插值和伪彩色分段并行 工作线程在核心0
+    if (workpool_init()) {
+        printf("render: workpool init failed, single core rendering\r\n");
+    }
+
     // 全屏显示黑色
     dispcolor_ClearScreen();
 
@@ -520,29 +979,43 @@ void render_task(void* arg)
     buildPalette();
 
     while (1) {
-        EventBits_t uxBitsToWaitFor = RENDER_MLX90640_NO0 | RENDER_MLX90640_NO1 | RENDER_ShortPress_Up | RENDER_Hold_Up | RENDER_ShortPress_Center | RENDER_Hold_Center | RENDER_ShortPress_Down | RENDER_Hold_Down;
+        EventBits_t uxBitsToWaitFor = RENDER_MLX90640_FRAME | RENDER_ShortPress_Up | RENDER_Hold_Up | RENDER_ShortPress_Center | RENDER_Hold_Center | RENDER_ShortPress_Down | RENDER_Hold_Down;
         EventBits_t bits = xEventGroupWaitBits(pHandleEventGroup, uxBitsToWaitFor, pdFALSE, pdFALSE, portMAX_DELAY);
         xEventGroupClearBits(pHandleEventGroup, bits);
 
-        if ((bits & RENDER_MLX90640_NO0) == RENDER_MLX90640_NO0 || (bits & RENDER_MLX90640_NO1) == RENDER_MLX90640_NO1) {
-            int8_t idx = ((int8_t)bits >> 1) & 1;
-            sMlxData* _pMlxData = &pMlxData[idx];
+        uint32_t frameNo;
+        int64_t frameReadyUs = 0;
+        if ((bits & RENDER_MLX90640_FRAME) == RENDER_MLX90640_FRAME && 0 == mlx90640_getFrame(&renderFrame, &frameNo)) {
+            sMlxData* _pMlxData = &renderFrame;
+            mlx90640_frameConsumed(frameNo);
+            frameReadyUs = _pMlxData->readyUs;
+
+            // 数字变焦的视口
+            sRenderView view;
+            viewUpdate(&view);
 
             // 计算最大温度 最小温度 中间温度
-            CalcTempFromMLX90640(_pMlxData);
-
-            if (settingsParms.AutoScaleMode) {
-                // 自动计算每帧的 最大温度 最小温度 的伪彩色
-                if (_pMlxData->minT != minTemp || _pMlxData->maxT != maxTemp) {
-                    settingsParms.minTempNew = minTemp = _pMlxData->minT;
-                    settingsParms.maxTempNew = maxTemp = _pMlxData->maxT;
-                    RedrawPalette(minTemp, maxTemp);
-                    // printf("%.1f %.1f \r\n", minTemp, maxTemp);
+            PROFILER_BEGIN(PROF_MIN_MAX);
+            CalcTempFromMLX90640(_pMlxData, &view);
+            PROFILER_END(PROF_MIN_MAX);
+
+            if (AUTOSCALE_OFF != settingsParms.AutoScaleMode) {
+                // 自动计算每帧的 最大温度 最小温度 (或分位数) 平滑后超出死区才重新缩放伪彩色
+                float rangeMin = _pMlxData->minT, rangeMax = _pMlxData->maxT;
+                if (autoRange.cfg.percentile) {
+                    autorange_percentile(_pMlxData->ThermoImage, THERMALIMAGE_RESOLUTION_WIDTH, view.x, view.y, view.width, view.height, autoRange.cfg.percentile, &rangeMin, &rangeMax);
+                    rangeMin = rangeMin < MIN_TEMP ? MIN_TEMP : rangeMin;
+                    rangeMax = rangeMax > MAX_TEMP ? MAX_TEMP : rangeMax;
                 }
 
+                if (autorange_update(&autoRange, rangeMin, rangeMax)) {
+                    settingsParms.minTempNew = autoRange.outMin;
+                    settingsParms.maxTempNew = autoRange.outMax;
+                    RedrawPalette(settingsParms.minTempNew, settingsParms.maxTempNew);
+                }
             } else {
-                minTemp = _pMlxData->minT;
-                maxTemp = _pMlxData->maxT;
+                // 重新打开自动缩放时直接使用当前画面的范围
+                autorange_reset(&autoRange);
             }
 
             // 将温度复制到一个整数数组，以简化进一步的计算
@@ -550,26 +1023,58 @@ void render_task(void* arg)
                 TermoImage16[i] = _pMlxData->ThermoImage[i] * TEMP_SCALE;
             }
 
+            if (AUTOSCALE_HISTOGRAM == settingsParms.AutoScaleMode) {
+                // 直方图均衡 温度范围和线性一样平滑 范围内的颜色分布按视口的直方图每帧重新生成
+                palette_setEqualizedMap(&paletteMap, paletteEqLut, settingsParms.ColorScale,
+                    (int16_t)(settingsParms.minTempNew * TEMP_SCALE), (int16_t)(settingsParms.maxTempNew * TEMP_SCALE),
+                    TermoImage16 + view.y * THERMALIMAGE_RESOLUTION_WIDTH + view.x, THERMALIMAGE_RESOLUTION_WIDTH, view.width, view.height);
+            }
+
+            // 变焦时把视口裁剪出来 插值只处理视口内的源像素
+            const int16_t* pViewImage = TermoImage16;
+            if (zoomIdx) {
+                for (uint8_t y = 0; y < view.height; y++) {
+                    memcpy(viewImage16 + y * view.width, TermoImage16 + (view.y + y) * THERMALIMAGE_RESOLUTION_WIDTH + view.x, view.width * sizeof(int16_t));
+                }
+                pViewImage = viewImage16;
+            }
+
             // 显示热图
+            renderJobBegin(&renderJob, pViewImage, &view, &paletteMap);
             switch (settingsParms.ScaleMode) {
-            case ORIGINAL:
-                // 原始 只放大SCALE_SIZE倍
-                DrawImage(TermoImage16, pPaletteImage, PaletteSteps, 0, 0, IMAGE_SCALESIZE, IMAGE_SCALESIZE, minTemp);
+            case ORIGINAL: {
+                // 原始 只放大SCALE_SIZE倍 用绘图函数写入显存
+                uint32_t t0 = bandTimeStart();
+                DrawImage(pViewImage, view.width, view.height, &paletteMap, 0, 0, view.scale, view.scale);
+                bandTimeAdd(renderJob.paletteUs, t0);
                 break;
+            }
 
             case LINEAR:
-                // 线性插值
-                idwOldInterpolate(TermoImage16, THERMALIMAGE_RESOLUTION_WIDTH, THERMALIMAGE_RESOLUTION_HEIGHT, IMAGE_SCALESIZE, TermoHqImage16);
-                DrawHQImage(TermoHqImage16, pPaletteImage, PaletteSteps, 0, 0, dispcolor_getWidth(), dispcolor_getHeight(), minTemp);
+                // 分段线性插值 每段只依赖上下两个源行 一次并行
+                workpool_parallel_for(view.height * view.scale, RenderBand_LinearDraw, &renderJob);
                 break;
 
             case HQ3X_2X:
-                // 高斯模糊 双线性插值
-                idwGauss(TermoImage16, THERMALIMAGE_RESOLUTION_WIDTH, THERMALIMAGE_RESOLUTION_HEIGHT, 2, gaussBuff);
-                idwBilinear(gaussBuff, THERMALIMAGE_RESOLUTION_WIDTH * 2, THERMALIMAGE_RESOLUTION_HEIGHT * 2, TermoHqImage16, dispcolor_getWidth(), dispcolor_getHeight(), IMAGE_SCALESIZE / 2);
-                DrawHQImage(TermoHqImage16, pPaletteImage, PaletteSteps, 0, 0, dispcolor_getWidth(), dispcolor_getHeight(), minTemp);
+                // 高斯模糊 双线性插值 双线性插值要用到相邻的高斯模糊行 所以分两次并行
+                workpool_parallel_for(view.height * 2, RenderBand_Gauss, &renderJob);
+                workpool_parallel_for(dispcolor_getHeight(), RenderBand_BilinearDraw, &renderJob);
+#if RENDER_PARALLEL_CHECK
+                RenderParallelCheck(&renderJob);
+#endif
+                break;
+
+            case BICUBIC:
+                // 双三次插值 各行只依赖源图像 一次并行
+                workpool_parallel_for(view.height * view.scale, RenderBand_BicubicDraw, &renderJob);
                 break;
             }
+            renderJobRecord(&renderJob);
+
+            // 插值结果直接写入了显存 整个画面都要刷新
+            dispcolor_markDirty(0, 0, dispcolor_getWidth(), dispcolor_getHeight());
+
+            PROFILER_BEGIN(PROF_OVERLAY);
 
             // 热图上的最大/最小标记
             if (settingsParms.TempMarkers) {
@@ -577,11 +1082,7 @@ void render_task(void* arg)
                 DrawCenterTemp(0, 0, dispcolor_getWidth(), dispcolor_getHeight(), _pMlxData->CenterTemp);
 
                 // 标记最大 最小 点
-                if (settingsParms.ScaleMode == HQ3X_2X) {
-                    DrawMarkersHQ(_pMlxData);
-                } else {
-                    DrawMarkers(_pMlxData);
-                }
+                DrawMarkers(_pMlxData, &view);
             }
 
             // 绘制标题内容
@@ -592,6 +1093,12 @@ void render_task(void* arg)
 
             // 绘制右边的伪彩色
             DrawPalette(dispcolor_getWidth() - 25, (dispcolor_getHeight() >> 1) - 80, 15, RIGHTPALETTEHEIGHT, settingsParms.minTempNew, settingsParms.maxTempNew);
+
+#ifdef CONFIG_THERMAL_PROFILER
+            // 各阶段耗时
+            DrawProfiler();
+#endif
+            PROFILER_END(PROF_OVERLAY);
         }
 
         if ((bits & RENDER_ShortPress_Up) == RENDER_ShortPress_Up) {
@@ -640,26 +1147,31 @@ void render_task(void* arg)
             }
         }
 
-        // 把显存内容刷新到液晶屏上
-        dispcolor_Update();
+        // 把显存内容刷新到液晶屏上 整屏时复制到行缓存排队发送 最后两段边发送边渲染下一帧 (统计复制 排队和同步发送的耗时)
+        PROFILER_BEGIN(PROF_SPI_FLUSH);
+        dispcolor_UpdateAsync();
+        PROFILER_END(PROF_SPI_FLUSH);
+
+        if (frameReadyUs) {
+            latency_update(frameReadyUs);
+        }
     }
 
 error:
-    if (NULL != pPaletteImage) {
-        heap_caps_free(pPaletteImage);
-        pPaletteImage = NULL;
-    }
     if (NULL != TermoImage16) {
         heap_caps_free(TermoImage16);
         TermoImage16 = NULL;
     }
-    if (NULL != TermoHqImage16) {
-        heap_caps_free(TermoHqImage16);
-        TermoHqImage16 = NULL;
+    if (NULL != viewImage16) {
+        heap_caps_free(viewImage16);
+        viewImage16 = NULL;
+    }
+    if (NULL != gaussImage16) {
+        heap_caps_free(gaussImage16);
+        gaussImage16 = NULL;
     }
-    if (NULL != gaussBuff) {
-        heap_caps_free(gaussBuff);
-        gaussBuff = NULL;
+    for (int i = 0; i < ZOOM_COUNT; i++) {
+        idwScalerFree(&hqScaler[i]);
     }
     vTaskDelete(NULL);
     FatalErrorMsg("Error mlx tasks\r\n");
@@ -43,12 +43,15 @@ void sht31_task(void* arg)
     vTaskDelay(100 / portTICK_RATE_MS);
 
     while (1) {
-        sht31_single_command(SHT31_BOOL_TRUE);
-        vTaskDelay(20 / portTICK_RATE_MS);
-
-        sht31_single_read(&temperature_raw, &temperature, &humidity_raw, &humidity);
-        AddSAFiterRes(pFilter_Temperature, temperature);
-        AddSAFiterRes(pFilter_Humidity, humidity);
+        // 总线忙(没有等到 MLX90640 子页之间的空闲窗口)时跳过本次采样
+        if (0 == sht31_single_command(SHT31_BOOL_TRUE)) {
+            vTaskDelay(20 / portTICK_RATE_MS);
+
+            if (0 == sht31_single_read(&temperature_raw, &temperature, &humidity_raw, &humidity)) {
+                AddSAFiterRes(pFilter_Temperature, temperature);
+                AddSAFiterRes(pFilter_Humidity, humidity);
+            }
+        }
 
         vTaskDelay(1 * 1000 / portTICK_RATE_MS);
     }
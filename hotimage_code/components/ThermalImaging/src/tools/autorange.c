@@ -0,0 +1,164 @@
+#include "autorange.h"
+#include <string.h>
+
+#define AUTORANGE_MAX_PERCENTILE 10 // 分位数最多去掉两端各 10%
+#define AUTORANGE_MAX_PIXELS 768 // 分位数最多统计的像素个数 (32 x 24)
+
+/**
+ * @brief 初始化自动缩放控制器
+ *
+ * @param pRange
+ * @param pConfig 参数 比例限制在 0~1
+ */
+void autorange_init(sAutoRange* pRange, const sAutoRangeConfig* pConfig)
+{
+    memset(pRange, 0, sizeof(sAutoRange));
+    pRange->cfg = *pConfig;
+
+    if (pRange->cfg.attack <= 0 || pRange->cfg.attack > 1) {
+        pRange->cfg.attack = 1;
+    }
+    if (pRange->cfg.release <= 0 || pRange->cfg.release > 1) {
+        pRange->cfg.release = 1;
+    }
+    if (pRange->cfg.deadband < 0) {
+        pRange->cfg.deadband = 0;
+    }
+    if (pRange->cfg.percentile > AUTORANGE_MAX_PERCENTILE) {
+        pRange->cfg.percentile = AUTORANGE_MAX_PERCENTILE;
+    }
+}
+
+/**
+ * @brief 下次更新直接使用输入的范围 (画面突然变化 例如变焦 打开自动缩放)
+ *
+ * @param pRange
+ */
+void autorange_reset(sAutoRange* pRange)
+{
+    pRange->valid = 0;
+}
+
+/**
+ * @brief 平滑一个边界 向外扩展用 attack 向内收缩用 release
+ *
+ * @param current 当前值
+ * @param target 目标值
+ * @param outward 1=目标在范围外
+ * @param pCfg
+ * @return float
+ */
+static float autorange_follow(float current, float target, uint8_t outward, const sAutoRangeConfig* pCfg)
+{
+    return current + (target - current) * (outward ? pCfg->attack : pCfg->release);
+}
+
+/**
+ * @brief 输入一帧的温度范围
+ *
+ * @param pRange
+ * @param minT 画面的最小温度 (或分位数)
+ * @param maxT 画面的最大温度 (或分位数)
+ * @return uint8_t 1=使用的范围改变了 需要重新缩放伪彩色 结果在 outMin outMax
+ */
+uint8_t autorange_update(sAutoRange* pRange, float minT, float maxT)
+{
+    const sAutoRangeConfig* pCfg = &pRange->cfg;
+
+    pRange->frames++;
+
+    if (!pRange->valid) {
+        pRange->valid = 1;
+        pRange->smoothMin = pRange->outMin = minT;
+        pRange->smoothMax = pRange->outMax = maxT;
+        pRange->rescales++;
+        return 1;
+    }
+
+    pRange->smoothMin = autorange_follow(pRange->smoothMin, minT, minT < pRange->smoothMin, pCfg);
+    pRange->smoothMax = autorange_follow(pRange->smoothMax, maxT, maxT > pRange->smoothMax, pCfg);
+
+    // 传感器噪声只会让平滑后的范围在死区内小幅变化 不重新缩放
+    float dMin = pRange->smoothMin - pRange->outMin;
+    float dMax = pRange->smoothMax - pRange->outMax;
+    if (dMin <= pCfg->deadband && dMin >= -pCfg->deadband && dMax <= pCfg->deadband && dMax >= -pCfg->deadband) {
+        return 0;
+    }
+
+    pRange->outMin = pRange->smoothMin;
+    pRange->outMax = pRange->smoothMax;
+    pRange->rescales++;
+    return 1;
+}
+
+/**
+ * @brief 插入到有序数组 只保留前 size 个
+ *
+ * @param pArr 从小到大
+ * @param pCount 数组中已有的个数
+ * @param size 最多保留的个数
+ * @param value
+ */
+static void autorange_insert(float* pArr, uint16_t* pCount, uint16_t size, float value)
+{
+    uint16_t i = *pCount;
+
+    if (i == size) {
+        if (value >= pArr[size - 1]) {
+            return;
+        }
+        i--;
+    } else {
+        (*pCount)++;
+    }
+
+    for (; i > 0 && pArr[i - 1] > value; i--) {
+        pArr[i] = pArr[i - 1];
+    }
+    pArr[i] = value;
+}
+
+/**
+ * @brief 计算区域内温度的分位数 最小的和最大的 n% 像素当作异常点去掉
+ *
+ * @param pImage 温度图像
+ * @param stride 图像一行的像素个数
+ * @param x 区域左上角
+ * @param y
+ * @param width 区域宽
+ * @param height 区域高
+ * @param percentile 1~10 0=最小最大温度
+ * @param pMin 输出 n% 分位数
+ * @param pMax 输出 (100-n)% 分位数
+ */
+void autorange_percentile(const float* pImage, uint16_t stride, uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint8_t percentile, float* pMin, float* pMax)
+{
+    float low[AUTORANGE_MAX_PIXELS * AUTORANGE_MAX_PERCENTILE / 100 + 1]; // 最小的 k+1 个
+    float high[AUTORANGE_MAX_PIXELS * AUTORANGE_MAX_PERCENTILE / 100 + 1]; // 最大的 k+1 个 (取负数保存)
+    uint16_t lowCount = 0, highCount = 0;
+    uint32_t pixels = (uint32_t)width * height;
+
+    if (percentile > AUTORANGE_MAX_PERCENTILE) {
+        percentile = AUTORANGE_MAX_PERCENTILE;
+    }
+    if (pixels > AUTORANGE_MAX_PIXELS) {
+        pixels = AUTORANGE_MAX_PIXELS;
+    }
+
+    const uint16_t keep = pixels * percentile / 100 + 1; // 第 k+1 小的就是 n% 分位数
+
+    for (uint16_t row = 0; row < height; row++) {
+        const float* pRow = pImage + (y + row) * stride + x;
+        for (uint16_t col = 0; col < width; col++) {
+            autorange_insert(low, &lowCount, keep, pRow[col]);
+            autorange_insert(high, &highCount, keep, -pRow[col]);
+        }
+    }
+
+    if (0 == lowCount) {
+        return;
+    }
+
+    *pMin = low[lowCount - 1];
+    *pMax = -high[highCount - 1];
+}
@@ -0,0 +1,132 @@
+#include "framering.h"
+#include <esp_heap_caps.h>
+#include <string.h>
+
+/**
+ * @brief 分配槽 序号和计数使用零初始化的值 读者在此之前调用 framering_read 会得到 "还没有帧"
+ *
+ * @param pRing 须已清零 (静态变量)
+ * @param slotSize 每帧的字节数
+ * @return int 0=成功 1=内存不足
+ */
+int framering_init(sFrameRing* pRing, size_t slotSize)
+{
+    pRing->pData = heap_caps_calloc(FRAMERING_SLOTS, slotSize, MALLOC_CAP_8BIT);
+    if (NULL == pRing->pData) {
+        return 1;
+    }
+    pRing->slotSize = slotSize;
+
+    return 0;
+}
+
+/**
+ * @brief 开始写入下一帧 返回要写入的槽
+ *
+ * @param pRing
+ * @return void*
+ */
+void* framering_writeBegin(sFrameRing* pRing)
+{
+    uint32_t slot = (atomic_load_explicit(&pRing->publishedFrameNo, memory_order_relaxed) + 1) % FRAMERING_SLOTS;
+
+    uint32_t seq = atomic_load_explicit(&pRing->seq[slot], memory_order_relaxed);
+    atomic_store_explicit(&pRing->seq[slot], seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    return pRing->pData + slot * pRing->slotSize;
+}
+
+/**
+ * @brief 写入完成 发布新的一帧
+ *
+ * @param pRing
+ */
+void framering_publish(sFrameRing* pRing)
+{
+    uint32_t lastFrameNo = atomic_load_explicit(&pRing->publishedFrameNo, memory_order_relaxed);
+    uint32_t frameNo = lastFrameNo + 1;
+    uint32_t slot = frameNo % FRAMERING_SLOTS;
+
+    uint32_t seq = atomic_load_explicit(&pRing->seq[slot], memory_order_relaxed);
+    atomic_store_explicit(&pRing->seq[slot], seq + 1, memory_order_release);
+
+    // 上一帧主要消费者还没有处理
+    if (0 != lastFrameNo && atomic_load_explicit(&pRing->consumedFrameNo, memory_order_relaxed) != lastFrameNo) {
+        atomic_fetch_add_explicit(&pRing->droppedFrames, 1, memory_order_relaxed);
+    }
+
+    atomic_store_explicit(&pRing->publishedFrameNo, frameNo, memory_order_release);
+}
+
+/**
+ * @brief 读取最新一帧的一部分 保证数据完整 不阻塞生产者
+ *
+ * @param pRing
+ * @param pBuff
+ * @param offset 在一帧中的偏移
+ * @param size
+ * @param pFrameNo 读取到的帧号 可以为NULL
+ * @return uint8_t 0=成功 1=还没有帧
+ */
+uint8_t framering_read(sFrameRing* pRing, void* pBuff, size_t offset, size_t size, uint32_t* pFrameNo)
+{
+    while (1) {
+        // 发布第一帧之后 pData 一定已经分配
+        uint32_t frameNo = atomic_load_explicit(&pRing->publishedFrameNo, memory_order_acquire);
+        if (0 == frameNo) {
+            return 1;
+        }
+
+        uint32_t slot = frameNo % FRAMERING_SLOTS;
+        uint32_t seq1 = atomic_load_explicit(&pRing->seq[slot], memory_order_acquire);
+        if (0 == (seq1 & 1)) {
+            memcpy(pBuff, pRing->pData + slot * pRing->slotSize + offset, size);
+            atomic_thread_fence(memory_order_acquire);
+
+            uint32_t seq2 = atomic_load_explicit(&pRing->seq[slot], memory_order_relaxed);
+            if (seq1 == seq2) {
+                if (pFrameNo) {
+                    *pFrameNo = frameNo;
+                }
+                return 0;
+            }
+        }
+
+        // 复制期间槽被生产者覆盖 重新读取最新帧
+        atomic_fetch_add_explicit(&pRing->readRetries, 1, memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief 主要消费者处理完一帧后调用 用于统计丢帧
+ *
+ * @param pRing
+ * @param frameNo
+ */
+void framering_consumed(sFrameRing* pRing, uint32_t frameNo)
+{
+    atomic_store_explicit(&pRing->consumedFrameNo, frameNo, memory_order_relaxed);
+}
+
+/**
+ * @brief 获取丢帧数 (没有被主要消费者处理就被覆盖的帧)
+ *
+ * @param pRing
+ * @return uint32_t
+ */
+uint32_t framering_getDroppedFrames(sFrameRing* pRing)
+{
+    return atomic_load_explicit(&pRing->droppedFrames, memory_order_relaxed);
+}
+
+/**
+ * @brief 获取读者因为数据被覆盖而重新复制的次数
+ *
+ * @param pRing
+ * @return uint32_t
+ */
+uint32_t framering_getReadRetries(sFrameRing* pRing)
+{
+    return atomic_load_explicit(&pRing->readRetries, memory_order_relaxed);
+}
@@ -0,0 +1,254 @@
+#include "profiler.h"
+
+#ifdef CONFIG_THERMAL_PROFILER
+
+#include "esp_timer.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+
+// 耗时直方图 0~3us 每微秒一格 之后每个倍频程分 4 格 最大约 4 秒
+#define PROFILER_HIST_BUCKETS 84
+
+// 每个阶段的统计 单写者(记录该阶段的任务) 多读者
+// 和帧环形缓存一样用序号(seqlock)保证读者复制到完整的数据 写入期间为奇数
+typedef struct
+{
+    atomic_uint seq; // 序号 奇数=正在写入
+    atomic_uint resetReq; // 读者请求清零 由写者在下次记录时执行
+    uint32_t count; // 样本数
+    uint32_t minUs; // 最小耗时
+    uint32_t maxUs; // 最大耗时
+    uint64_t sumUs; // 耗时累计
+    uint32_t hist[PROFILER_HIST_BUCKETS]; // 耗时直方图
+} sProfilerStage;
+
+static sProfilerStage stages[PROF_STAGE_COUNT];
+
+static profiler_clock_t profilerClock = esp_timer_get_time; // 计时源
+
+static const char* const STAGE_NAMES[PROF_STAGE_COUNT] = {
+    "i2c read",
+    "to calc",
+    "bad pixel",
+    "min/max",
+    "interp",
+    "palette",
+    "overlay",
+    "spi flush",
+};
+
+/**
+ * @brief 耗时对应的直方图格
+ *
+ * @param us
+ * @return int
+ */
+static int histBucket(uint32_t us)
+{
+    if (us < 4) {
+        return us;
+    }
+
+    int msb = 31 - __builtin_clz(us);
+    int idx = (msb - 1) * 4 + ((us >> (msb - 2)) & 3);
+
+    return idx < PROFILER_HIST_BUCKETS ? idx : PROFILER_HIST_BUCKETS - 1;
+}
+
+/**
+ * @brief 直方图格的最大耗时
+ *
+ * @param idx
+ * @return uint32_t
+ */
+static uint32_t histBucketMax(int idx)
+{
+    if (idx < 4) {
+        return idx;
+    }
+
+    int msb = idx / 4 + 1;
+    uint32_t lower = (uint32_t)(4 + (idx & 3)) << (msb - 2);
+
+    return lower + (1u << (msb - 2)) - 1;
+}
+
+/**
+ * @brief 开始修改某个阶段的统计
+ *
+ * @param pStage
+ */
+static void stageWriteBegin(sProfilerStage* pStage)
+{
+    uint32_t seq = atomic_load_explicit(&pStage->seq, memory_order_relaxed);
+    atomic_store_explicit(&pStage->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    if (atomic_exchange_explicit(&pStage->resetReq, 0, memory_order_acquire)) {
+        pStage->count = 0;
+        pStage->minUs = UINT32_MAX;
+        pStage->maxUs = 0;
+        pStage->sumUs = 0;
+        memset(pStage->hist, 0, sizeof(pStage->hist));
+    }
+}
+
+/**
+ * @brief 修改完成
+ *
+ * @param pStage
+ */
+static void stageWriteEnd(sProfilerStage* pStage)
+{
+    uint32_t seq = atomic_load_explicit(&pStage->seq, memory_order_relaxed);
+    atomic_store_explicit(&pStage->seq, seq + 1, memory_order_release);
+}
+
+/**
+ * @brief 替换计时源 在开始计时之前调用
+ *
+ * @param clock 返回微秒 NULL=恢复默认 esp_timer_get_time
+ */
+void profiler_set_clock(profiler_clock_t clock)
+{
+    profilerClock = clock ? clock : esp_timer_get_time;
+}
+
+/**
+ * @brief 当前时间 只用于计算差值 溢出回绕不影响
+ *
+ * @return uint32_t 微秒
+ */
+uint32_t profiler_now(void)
+{
+    return (uint32_t)profilerClock();
+}
+
+/**
+ * @brief 记录一个样本
+ *
+ * @param stage
+ * @param us 耗时
+ */
+void profiler_record(eProfilerStage stage, uint32_t us)
+{
+    sProfilerStage* pStage = &stages[stage];
+
+    stageWriteBegin(pStage);
+
+    if (0 == pStage->count || us < pStage->minUs) {
+        pStage->minUs = us;
+    }
+    if (us > pStage->maxUs) {
+        pStage->maxUs = us;
+    }
+    pStage->count++;
+    pStage->sumUs += us;
+    pStage->hist[histBucket(us)]++;
+
+    stageWriteEnd(pStage);
+}
+
+/**
+ * @brief PROFILER_BEGIN 到现在的耗时记录为一个样本
+ *
+ * @param stage
+ * @param pMark
+ */
+void profiler_end(eProfilerStage stage, const sProfilerMark* pMark)
+{
+    profiler_record(stage, profiler_now() - pMark->us);
+}
+
+/**
+ * @brief 读取某个阶段的统计 不阻塞写者
+ *
+ * @param stage
+ * @param pStats
+ */
+void profiler_get_stats(eProfilerStage stage, sProfilerStats* pStats)
+{
+    sProfilerStage* pStage = &stages[stage];
+    uint32_t count, minUs, maxUs;
+    uint64_t sumUs;
+    uint32_t hist[PROFILER_HIST_BUCKETS];
+
+    while (1) {
+        uint32_t seq1 = atomic_load_explicit(&pStage->seq, memory_order_acquire);
+        if (0 == (seq1 & 1)) {
+            count = pStage->count;
+            minUs = pStage->minUs;
+            maxUs = pStage->maxUs;
+            sumUs = pStage->sumUs;
+            memcpy(hist, pStage->hist, sizeof(hist));
+
+            atomic_thread_fence(memory_order_acquire);
+            if (seq1 == atomic_load_explicit(&pStage->seq, memory_order_relaxed)) {
+                break;
+            }
+        }
+    }
+
+    memset(pStats, 0, sizeof(sProfilerStats));
+    if (0 == count) {
+        return;
+    }
+
+    pStats->count = count;
+    pStats->minUs = minUs;
+    pStats->maxUs = maxUs;
+    pStats->avgUs = sumUs / count;
+
+    // 第 ceil(count * 0.99) 个样本所在的格
+    uint32_t rank = count - count / 100;
+    uint32_t acc = 0;
+    for (int i = 0; i < PROFILER_HIST_BUCKETS; i++) {
+        acc += hist[i];
+        if (acc >= rank) {
+            uint32_t p99 = histBucketMax(i);
+            pStats->p99Us = p99 < maxUs ? p99 : maxUs;
+            break;
+        }
+    }
+}
+
+/**
+ * @brief 请求清零所有阶段的统计 各阶段在下次记录时清零
+ *
+ */
+void profiler_reset(void)
+{
+    for (int i = 0; i < PROF_STAGE_COUNT; i++) {
+        atomic_store_explicit(&stages[i].resetReq, 1, memory_order_release);
+    }
+}
+
+/**
+ * @brief 从串口输出所有阶段的统计
+ *
+ */
+void profiler_dump(void)
+{
+    sProfilerStats stats;
+
+    printf("profiler: %-10s %7s %9s %9s %9s %9s\r\n", "stage", "count", "min(us)", "avg(us)", "p99(us)", "max(us)");
+    for (int i = 0; i < PROF_STAGE_COUNT; i++) {
+        profiler_get_stats(i, &stats);
+        printf("profiler: %-10s %7u %9u %9u %9u %9u\r\n",
+            STAGE_NAMES[i], stats.count, stats.minUs, stats.avgUs, stats.p99Us, stats.maxUs);
+    }
+}
+
+/**
+ * @brief 阶段名称
+ *
+ * @param stage
+ * @return const char*
+ */
+const char* profiler_stage_name(eProfilerStage stage)
+{
+    return (stage < PROF_STAGE_COUNT) ? STAGE_NAMES[stage] : "?";
+}
+
+#endif // CONFIG_THERMAL_PROFILER
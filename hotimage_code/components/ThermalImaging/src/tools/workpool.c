@@ -0,0 +1,93 @@
+#include "workpool.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+#define WORKPOOL_STACK_SIZE (1024 * 4) // 分段线性插值每段的两行水平插值结果放在栈上
+#define WORKPOOL_PRIORITY 5
+#define WORKPOOL_CORE 0 // render_task 在核心1 工作线程放在核心0
+
+typedef struct
+{
+    TaskHandle_t handle;
+    workpool_func_t func;
+    void* arg;
+    int start;
+    int end;
+} sWorker;
+
+static sWorker workers[WORKPOOL_WORKERS];
+static SemaphoreHandle_t doneSemaphore = NULL; // 工作线程完成一段后释放
+
+/**
+ * @brief 工作线程 等待通知后处理分配的一段
+ *
+ * @param arg
+ */
+static void workpool_task(void* arg)
+{
+    sWorker* worker = (sWorker*)arg;
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        worker->func(worker->arg, worker->start, worker->end);
+        xSemaphoreGive(doneSemaphore);
+    }
+}
+
+/**
+ * @brief 创建工作线程
+ *
+ * @return int 0=成功
+ */
+int workpool_init(void)
+{
+    if (NULL != doneSemaphore) {
+        return 0;
+    }
+
+    doneSemaphore = xSemaphoreCreateCounting(WORKPOOL_WORKERS, 0);
+    if (NULL == doneSemaphore) {
+        return 1;
+    }
+
+    for (int i = 0; i < WORKPOOL_WORKERS; i++) {
+        if (pdPASS != xTaskCreatePinnedToCore(workpool_task, "workpool", WORKPOOL_STACK_SIZE, &workers[i], WORKPOOL_PRIORITY, &workers[i].handle, WORKPOOL_CORE)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief 把 [0, count) 平均分段 工作线程和调用者同时处理 全部完成后返回
+ *        同一时间只能有一个调用者 各段之间不能有数据依赖
+ *
+ * @param count
+ * @param func
+ * @param arg
+ */
+void workpool_parallel_for(int count, workpool_func_t func, void* arg)
+{
+    const int parts = WORKPOOL_WORKERS + 1;
+
+    if (NULL == doneSemaphore || count < parts) {
+        func(arg, 0, count);
+        return;
+    }
+
+    for (int i = 0; i < WORKPOOL_WORKERS; i++) {
+        workers[i].func = func;
+        workers[i].arg = arg;
+        workers[i].start = count * i / parts;
+        workers[i].end = count * (i + 1) / parts;
+        xTaskNotifyGive(workers[i].handle);
+    }
+
+    // 调用者处理最后一段
+    func(arg, count * WORKPOOL_WORKERS / parts, count);
+
+    for (int i = 0; i < WORKPOOL_WORKERS; i++) {
+        xSemaphoreTake(doneSemaphore, portMAX_DELAY);
+    }
+}